@@ -1,7 +1,6 @@
 # Demonstrates loading and saving node graphs in Python
 
 import FRRequirements
-import time
 
 # Create some nodes and connect them together
 # Nodes don't currently have rules about how they connect
@@ -42,24 +41,16 @@ threadpool = FRRequirements.ThreadPool()
 threadpool.startThreads(4)
 
 saver = FRRequirements.SaveNodesNode(org)
-threadpool.enqueue(saver)
-
-# You probably don't really need 3 seconds for this save
-# You can check saver.treeSaveComplete() to see if the
-# entire graph has been saved or you can go off and do
-# other things and check later.
-time.sleep(3)
+# enqueue hands back a TaskHandle. Waiting on it blocks until the
+# saver and every task it split the save into have finished.
+threadpool.enqueue(saver).wait()
 
 loader = FRRequirements.PqNodeFactory(org.idString())
-threadpool.enqueue(loader)
-
-# You probably also don't need 3 seconds to load it.
-# loader.graphLoaded() will give you some idea if your
-# graph has been loaded, but it might not be entirely
-# populated yet. You can also threadpool.workerStatus()
-# to see if any of the threads are still working.
 
-time.sleep(3)
+# Same thing for loading. Once wait returns the whole graph is
+# loaded. If you'd rather go off and do other things, hang on to
+# the handle and check done() or waitFor() later.
+threadpool.enqueue(loader).wait()
 loadedOrg = loader.getNode()
 
 print("org uuid:       ", org.idString())
@@ -0,0 +1,232 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fr::RequirementsManager {
+
+  // What a task's handle gets when the task was cancelled
+  class TaskCancelled : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+   * Something to run when a token is cancelled, for as long as this
+   * object's around. Destroying it unregisters the callback, and if
+   * the callback's running on another thread right then it waits
+   * for it to finish, so it's safe to destroy this and then get rid
+   * of whatever the callback touches.
+   */
+
+  class CancelCallback {
+    std::unique_ptr<std::stop_callback<std::function<void()>>> _callback;
+
+  public:
+    CancelCallback() = default;
+
+    CancelCallback(std::stop_token token, std::function<void()> callback) :
+      _callback(std::make_unique<std::stop_callback<std::function<void()>>>(std::move(token), std::move(callback))) {
+    }
+
+    void reset() {
+      _callback.reset();
+    }
+  };
+
+  /**
+   * Cooperative cancellation for tasks. Copies of a token all share
+   * the same state, so cancelling one cancels them all. ThreadPool
+   * gives every task a running task enqueues its parent's token, so
+   * cancelling a PqNodeFactory's token cancels all of its loaders too.
+   *
+   * Cancelling doesn't stop anything by itself. Queued tasks with a
+   * cancelled token get skipped instead of run, the database tasks
+   * cancel the query they have in flight, and long running tasks can
+   * check cancelled() every so often.
+   *
+   * A token can have a deadline, in which case it cancels itself
+   * when the deadline passes.
+   *
+   * A default-constructed token can't be cancelled.
+   */
+
+  class CancellationToken {
+  public:
+    using Type = CancellationToken;
+    using Clock = std::chrono::steady_clock;
+
+  private:
+
+    struct State {
+      std::stop_source source;
+      Clock::time_point deadline = Clock::time_point::max();
+    };
+
+    /**
+     * One thread for the whole process that cancels tokens when
+     * their deadlines pass.
+     */
+    class DeadlineTimer {
+      std::mutex _mutex;
+      std::condition_variable _condition;
+      std::multimap<Clock::time_point, std::weak_ptr<State>> _deadlines;
+      bool _stop = false;
+      std::thread _thread;
+
+      void loop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stop) {
+          if (_deadlines.empty()) {
+            _condition.wait(lock);
+            continue;
+          }
+          auto next = _deadlines.begin()->first;
+          if (Clock::now() < next) {
+            _condition.wait_until(lock, next);
+            continue;
+          }
+          std::vector<std::shared_ptr<State>> expired;
+          auto now = Clock::now();
+          while (!_deadlines.empty() && _deadlines.begin()->first <= now) {
+            if (auto state = _deadlines.begin()->second.lock()) {
+              expired.push_back(state);
+            }
+            _deadlines.erase(_deadlines.begin());
+          }
+          // Cancel callbacks can take a while (a query cancel is a
+          // round trip to the server), so don't hold anybody up
+          lock.unlock();
+          for (auto& state : expired) {
+            state->source.request_stop();
+          }
+          lock.lock();
+        }
+      }
+
+    public:
+
+      ~DeadlineTimer() {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stop = true;
+        }
+        _condition.notify_one();
+        if (_thread.joinable()) {
+          _thread.join();
+        }
+      }
+
+      static DeadlineTimer& instance() {
+        static DeadlineTimer timer;
+        return timer;
+      }
+
+      void add(Clock::time_point deadline, std::weak_ptr<State> state) {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (!_thread.joinable()) {
+            _thread = std::thread([this]() { loop(); });
+          }
+          _deadlines.emplace(deadline, std::move(state));
+        }
+        _condition.notify_one();
+      }
+    };
+
+    std::shared_ptr<State> _state;
+
+    explicit CancellationToken(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+  public:
+
+    CancellationToken() = default;
+
+    // A token that's only cancelled when you cancel it
+    static CancellationToken create() {
+      return CancellationToken(std::make_shared<State>());
+    }
+
+    static CancellationToken withDeadline(Clock::time_point deadline) {
+      auto state = std::make_shared<State>();
+      state->deadline = deadline;
+      DeadlineTimer::instance().add(deadline, state);
+      return CancellationToken(state);
+    }
+
+    static CancellationToken withTimeout(std::chrono::milliseconds timeout) {
+      return withDeadline(Clock::now() + timeout);
+    }
+
+    // False for a default-constructed token
+    bool valid() const {
+      return static_cast<bool>(_state);
+    }
+
+    void cancel() const {
+      if (_state) {
+        _state->source.request_stop();
+      }
+    }
+
+    // True once it's been cancelled or its deadline has passed
+    bool cancelled() const {
+      return _state &&
+        (_state->source.stop_requested() || Clock::now() >= _state->deadline);
+    }
+
+    void throwIfCancelled() const {
+      if (cancelled()) {
+        throw TaskCancelled("Task was cancelled");
+      }
+    }
+
+    // time_point::max() if there isn't one
+    Clock::time_point deadline() const {
+      return _state ? _state->deadline : Clock::time_point::max();
+    }
+
+    /**
+     * Run callback when this is cancelled, on whichever thread
+     * cancels it. If it's already cancelled the callback runs right
+     * away. It stops being called once the CancelCallback you get
+     * back is destroyed.
+     */
+    CancelCallback onCancel(std::function<void()> callback) const {
+      if (!_state) {
+        return {};
+      }
+      if (Clock::now() >= _state->deadline) {
+        // Don't wait for the timer to get around to it
+        cancel();
+      }
+      return CancelCallback(_state->source.get_token(), std::move(callback));
+    }
+  };
+
+}
@@ -60,17 +60,6 @@ namespace fr::RequirementsManager {
         
   protected:
 
-    void traverse(std::function<void(Node::PtrType)> eachNodeFn, std::unordered_map<std::string, Node::PtrType> &visited) override {
-      Parent::traverse(eachNodeFn, visited);
-
-      if (_changeParent && !visited.contains(_changeParent->idString())) {
-        _changeParent->traverse(eachNodeFn, visited);
-      }
-      if (_changeChild && !visited.contains(_changeChild->idString())) {
-        _changeChild->traverse(eachNodeFn, visited);
-      }
-    }
-
     bool _committed = false;
     // Parent node that this one changes. Will be nullptr if this
     // is the ultimate parent node.
@@ -105,10 +94,16 @@ namespace fr::RequirementsManager {
       return _changeChild;
     }
 
-    void traverse(std::function<void(Node::PtrType)> eachNodeFn) override {
-      Parent::traverse(eachNodeFn);
+    // Traversals follow the change chain in both directions
+    void relatedNodes(std::vector<Node::PtrType>& related) override {
+      if (_changeParent) {
+        related.push_back(_changeParent);
+      }
+      if (_changeChild) {
+        related.push_back(_changeChild);
+      }
     }
-    
+
     // Return changeParent node. You need to check this for nullptr
     // prior to trying to use it.
     PtrType getChangeParent() {
@@ -0,0 +1,263 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <fr/RequirementsManager/TaskNode.h>
+#include <fr/RequirementsManager/ThreadPool.h>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Something a coroutine task can co_await that finishes on its
+   * own time -- a query on a non-blocking connection, a connection
+   * coming free in a pool and so on.
+   *
+   * start gets called once the coroutine has suspended. Call done
+   * exactly once when the operation's finished, from whatever
+   * thread you like (including from inside start). Whatever the
+   * coroutine gets back from co_await has to be stashed in the
+   * operation before done is called.
+   *
+   * cancel gets called (from whatever thread cancelled the task's
+   * token) if the task's cancelled while it's waiting. Finish early
+   * if you can. done still has to be called exactly once either way.
+   */
+
+  class AsyncOp {
+  public:
+    using PtrType = std::shared_ptr<AsyncOp>;
+
+    virtual ~AsyncOp() {}
+    virtual void start(std::function<void()> done) = 0;
+    virtual void cancel() {}
+  };
+
+  /**
+   * The return type of a CoroutineTask's body. It doesn't run until
+   * CoroutineTask resumes it, and anything it throws comes back out
+   * of CoroutineTask::run.
+   */
+
+  class TaskCoroutine {
+  public:
+
+    struct promise_type {
+      // What the coroutine's waiting on while it's suspended
+      AsyncOp::PtrType pending;
+      std::exception_ptr error;
+
+      TaskCoroutine get_return_object() {
+        return TaskCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+
+      void unhandled_exception() {
+        error = std::current_exception();
+      }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+  private:
+    Handle _handle;
+
+  public:
+
+    TaskCoroutine() = default;
+    explicit TaskCoroutine(Handle handle) : _handle(handle) {}
+    TaskCoroutine(const TaskCoroutine&) = delete;
+    TaskCoroutine& operator=(const TaskCoroutine&) = delete;
+
+    TaskCoroutine(TaskCoroutine&& other) : _handle(std::exchange(other._handle, {})) {}
+
+    TaskCoroutine& operator=(TaskCoroutine&& other) {
+      if (this != &other) {
+        if (_handle) {
+          _handle.destroy();
+        }
+        _handle = std::exchange(other._handle, {});
+      }
+      return *this;
+    }
+
+    ~TaskCoroutine() {
+      if (_handle) {
+        _handle.destroy();
+      }
+    }
+
+    bool valid() const {
+      return static_cast<bool>(_handle);
+    }
+
+    bool done() const {
+      return !_handle || _handle.done();
+    }
+
+    // Run until the next co_await that has to wait or the end.
+    // Returns what it's waiting on, or nullptr once it's finished.
+    AsyncOp::PtrType resume() {
+      _handle.resume();
+      if (_handle.done()) {
+        if (auto error = _handle.promise().error) {
+          _handle.promise().error = nullptr;
+          std::rethrow_exception(error);
+        }
+        return nullptr;
+      }
+      return std::exchange(_handle.promise().pending, nullptr);
+    }
+  };
+
+  /**
+   * co_await this from a TaskCoroutine to wait on op. Op has to be
+   * an AsyncOp with a ready method (true if there's no need to
+   * suspend at all) and a result method that returns whatever
+   * co_await should.
+   */
+
+  template <typename Op>
+  struct AsyncAwaiter {
+    std::shared_ptr<Op> op;
+
+    bool await_ready() {
+      return op->ready();
+    }
+
+    void await_suspend(TaskCoroutine::Handle handle) {
+      // Don't start it here -- it could finish and resume us on
+      // another thread before we're done suspending. CoroutineTask
+      // starts it once resume has returned.
+      handle.promise().pending = op;
+    }
+
+    decltype(auto) await_resume() {
+      return op->result();
+    }
+  };
+
+  /**
+   * A task whose body is a coroutine. Every time the body co_awaits
+   * something that isn't ready, the worker thread goes back to the
+   * pool to run something else, and once the thing it was waiting on
+   * finishes the task goes back on the queue (with ThreadPool::resume)
+   * to pick up where it left off. So a handful of workers can have
+   * hundreds of these in flight at once.
+   *
+   * The task's TaskHandle stays open across suspensions and covers
+   * anything the body enqueues, same as for any other task.
+   *
+   * If you call run on one of these that isn't in a threadpool, it
+   * just blocks on each co_await in turn.
+   */
+
+  template <typename WorkerType>
+  class CoroutineTask : public TaskNode<WorkerType> {
+    TaskCoroutine _coroutine;
+    // Cancels the op we're suspended on if our token's cancelled
+    CancelCallback _cancelWaiting;
+
+  protected:
+    // The coroutine. It's called once, the first time the task runs.
+    virtual TaskCoroutine body() = 0;
+
+  public:
+    using Type = CoroutineTask<WorkerType>;
+    using PtrType = std::shared_ptr<Type>;
+    using Parent = TaskNode<WorkerType>;
+
+    CoroutineTask() {}
+    virtual ~CoroutineTask() {}
+
+    std::string getNodeType() const override {
+      return "CoroutineTask";
+    }
+
+    void run() override {
+      // Whatever we were waiting on is done
+      _cancelWaiting.reset();
+      if (!_coroutine.valid()) {
+        _coroutine = body();
+      }
+      auto owner = this->getOwner();
+      auto op = _coroutine.resume();
+      if (!owner) {
+        while (op) {
+          std::mutex waitMutex;
+          std::condition_variable waitCondition;
+          bool finished = false;
+          auto cancelWaiting = this->getCancellation().onCancel([op]() { op->cancel(); });
+          op->start([&]() {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            finished = true;
+            waitCondition.notify_one();
+          });
+          std::unique_lock<std::mutex> lock(waitMutex);
+          waitCondition.wait(lock, [&finished]() { return finished; });
+          lock.unlock();
+          cancelWaiting.reset();
+          op = _coroutine.resume();
+        }
+        return;
+      }
+      if (op) {
+        if (this->cancelled()) {
+          // Don't start waiting on something we'd only cancel
+          abandon();
+          throw TaskCancelled("Task was cancelled");
+        }
+        // Set up before start, while nobody else can be running us
+        _cancelWaiting = this->getCancellation().onCancel([op]() { op->cancel(); });
+        // Keep our handle open while we're suspended. The resumed
+        // run gets a release of its own when it returns.
+        if (auto completion = this->getCompletion()) {
+          completion->hold();
+        }
+        auto self = std::static_pointer_cast<TaskNode<WorkerType>>(this->shared_from_this());
+        // Nothing after this can touch the task -- it could already
+        // be running again on another thread.
+        op->start([owner, self]() {
+          owner->resume(self);
+        });
+      }
+    }
+
+    // Cancelled while we were suspended. Destroying the coroutine
+    // cleans up its frame, so any connection it was holding goes
+    // back to its pool.
+    void abandon() override {
+      _cancelWaiting.reset();
+      _coroutine = TaskCoroutine();
+    }
+
+    // True once the body has run to the end
+    bool finished() const {
+      return _coroutine.valid() && _coroutine.done();
+    }
+  };
+
+}
@@ -0,0 +1,220 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <fr/RequirementsManager/UuidSet.h>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Finds nodes by UUID in one of a node's up or down lists without
+   * scanning the whole list. Node keeps one of these next to each
+   * list, so up and down are still plain vectors.
+   *
+   * Lists of up to threshold nodes just get scanned -- comparing
+   * sixteen bytes a node is faster than hashing at that size, and
+   * most nodes never have more than a handful of links. Past that
+   * the index keeps a hash map from UUID to position.
+   *
+   * Only sync and erased change the index, and Node only calls
+   * those when it's changing the list anyway. find just reads, so
+   * lookups are as safe to do from several threads at once as
+   * reading the list is. Anything find can't trust the map for --
+   * entries pushed onto the end since the last sync, or a list
+   * that's been replaced or shrunk, or a node in it changing its
+   * id -- it scans for instead, until the next sync catches up.
+   *
+   * Assigning a list with the same or fewer entries into one that
+   * already has room for them looks the same as nothing happening,
+   * so that (or anything else besides adding to the end) needs a
+   * call to reset. Node::setUp and setDown do that for you.
+   *
+   * Removing an entry doesn't fix up the positions of the entries
+   * after it. They can only have moved towards the front, by at
+   * most one place per removal, so find looks back that far from
+   * where the map says, and the whole map is rebuilt once enough
+   * removals have piled up.
+   *
+   * Every node the map has an entry for knows it's in here (see
+   * Node::indexedBy), so when one gets a new id (init, setUuid or a
+   * load) it can flag this index as stale. Only the indexes that
+   * actually have the node are affected.
+   *
+   * PtrType is always Node::PtrType. It's a template so Node.h can
+   * use this without this header needing Node. Node makes it a
+   * friend so it can tell the nodes it indexes.
+   */
+
+  template <typename PtrType>
+  class EdgeIndex {
+  public:
+    using Type = EdgeIndex<PtrType>;
+    using List = std::vector<PtrType>;
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+    // Lists this long or shorter are just scanned
+    static constexpr size_t threshold = 16;
+    // Removals before the map gets rebuilt
+    static constexpr size_t maxDrift = 64;
+
+  private:
+    std::unique_ptr<std::unordered_map<boost::uuids::uuid, size_t, UuidHash>> _positions;
+    // The list storage the map was built for, and how much of it
+    // is in the map
+    const PtrType* _data = nullptr;
+    size_t _indexed = 0;
+    // Removals since every position in the map was exact
+    size_t _removed = 0;
+    // Set by a node in the map when its id changes. Nodes hang on
+    // to it weakly, so it outlives the map while they're around.
+    std::shared_ptr<std::atomic<bool>> _stale;
+
+    void rebuild(const List& list) {
+      if (_positions) {
+        _positions->clear();
+      } else {
+        _positions = std::make_unique<std::unordered_map<boost::uuids::uuid, size_t, UuidHash>>();
+      }
+      _positions->reserve(list.size());
+      _data = list.data();
+      _indexed = 0;
+      _removed = 0;
+      // Anything that went stale is about to be looked at again
+      if (_stale) {
+        _stale->store(false, std::memory_order_relaxed);
+      } else {
+        _stale = std::make_shared<std::atomic<bool>>(false);
+      }
+    }
+
+    static size_t scan(const boost::uuids::uuid& id, const List& list, size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        if (list[i] && list[i]->id == id) {
+          return i;
+        }
+      }
+      return npos;
+    }
+
+  public:
+
+    EdgeIndex() = default;
+
+    // A copy's for a different list, so it starts over
+    EdgeIndex(const EdgeIndex&) {}
+
+    EdgeIndex& operator=(const EdgeIndex&) {
+      reset();
+      return *this;
+    }
+
+    // Forget everything. It'll be rebuilt at the next sync.
+    void reset() {
+      _positions.reset();
+      _data = nullptr;
+      _indexed = 0;
+      _removed = 0;
+    }
+
+    /**
+     * Bring the map up to date with list, building it if list has
+     * got long enough to need one. Call before changing list.
+     */
+    void sync(const List& list) {
+      if (list.size() <= threshold) {
+        if (_positions) {
+          reset();
+        }
+        return;
+      }
+      if (!current(list) || _removed > maxDrift) {
+        rebuild(list);
+      }
+      for (; _indexed < list.size(); ++_indexed) {
+        if (list[_indexed]) {
+          // Before reading the id, so a change after this flags us
+          list[_indexed]->indexedBy(_stale);
+          (*_positions)[list[_indexed]->id] = _indexed;
+        }
+      }
+    }
+
+    // True if the map still describes the front of list, so find
+    // can use it. False for short lists, which don't have one.
+    bool current(const List& list) const {
+      return _positions && list.data() == _data && list.size() >= _indexed &&
+        !_stale->load(std::memory_order_acquire);
+    }
+
+    /**
+     * Position of the node with id in list, or npos. Once the index
+     * is stale (see current) this scans the list, and it keeps doing
+     * that until the next sync. Node only syncs when it adds to or
+     * removes from the list. A list that's only read after one of its
+     * nodes gets a new id stays slow until then, or until someone
+     * calls Node::reindex.
+     */
+    size_t find(const boost::uuids::uuid& id, const List& list) const {
+      if (list.size() <= threshold || !current(list)) {
+        return scan(id, list, 0, list.size());
+      }
+      auto found = _positions->find(id);
+      if (found != _positions->end()) {
+        // Removals can have moved it back past the end
+        auto hint = std::min(found->second, list.size() - 1);
+        auto lowest = hint > _removed ? hint - _removed : 0;
+        for (size_t i = hint + 1; i-- > lowest;) {
+          if (list[i] && list[i]->id == id) {
+            return i;
+          }
+        }
+      }
+      // Not in the map (or removed since), but it might have been
+      // pushed on since the last sync
+      return scan(id, list, _indexed, list.size());
+    }
+
+    bool contains(const boost::uuids::uuid& id, const List& list) const {
+      return find(id, list) != npos;
+    }
+
+    // Call after erasing the entry at position from list
+    void erased(size_t position, const List& list) {
+      if (!_positions) {
+        return;
+      }
+      if (list.data() != _data || position >= _indexed) {
+        reset();
+        return;
+      }
+      // Positions after this one are off by one more now. The
+      // entry for the one that's gone is dropped at the next
+      // rebuild.
+      --_indexed;
+      ++_removed;
+    }
+  };
+
+}
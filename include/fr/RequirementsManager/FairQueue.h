@@ -0,0 +1,301 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * A set of FIFO queues, one per group, that hands out items
+   * round-robin across the groups instead of in the order they
+   * arrived. ThreadPool uses this so one request that fans out
+   * into fifty thousand tasks doesn't make every request behind it
+   * wait for all fifty thousand.
+   *
+   * Each group can have a weight and a limit. A group with weight
+   * 3 gets three items per turn to everyone else's one. A group
+   * with a limit never has more than that many items out (popped
+   * and not yet passed to finished) at once; its items just wait
+   * until one of the ones that are out finishes. A limit of 0
+   * means no limit.
+   *
+   * There are Lanes separate round robins (ThreadPool uses one per
+   * TaskPriority), but the weight, limit and count of items out are
+   * per group across all of them.
+   *
+   * This doesn't do any locking. ThreadPool only touches it with
+   * its work mutex held.
+   */
+
+  template <typename Item, size_t Lanes = 1>
+  class FairQueue {
+  public:
+    using Type = FairQueue<Item, Lanes>;
+
+    struct Settings {
+      size_t weight = 1;
+      size_t limit = 0;
+    };
+
+  private:
+
+    struct Group {
+      std::array<std::deque<Item>, Lanes> items;
+      // Items taken this turn, per lane
+      std::array<size_t, Lanes> credit{};
+      std::array<bool, Lanes> inRing{};
+      // Popped and not finished yet. Only counted for groups with a
+      // limit.
+      size_t out = 0;
+    };
+
+    std::unordered_map<std::string, Group> _groups;
+    std::unordered_map<std::string, Settings> _settings;
+    // Groups with something in that lane they're allowed to hand out
+    std::array<std::deque<std::string>, Lanes> _ring;
+    size_t _size = 0;
+    // Items in groups that are at their limit
+    size_t _blocked = 0;
+
+    const Settings& settings(const std::string& name) const {
+      static const Settings defaults;
+      auto found = _settings.find(name);
+      return found == _settings.end() ? defaults : found->second;
+    }
+
+    bool atLimit(const std::string& name, const Group& group) const {
+      auto limit = settings(name).limit;
+      return limit > 0 && group.out >= limit;
+    }
+
+    size_t queued(const Group& group) const {
+      size_t ret = 0;
+      for (auto& items : group.items) {
+        ret += items.size();
+      }
+      return ret;
+    }
+
+    // Put group back in every ring it has items for
+    void schedule(const std::string& name, Group& group) {
+      for (size_t lane = 0; lane < Lanes; ++lane) {
+        if (!group.inRing[lane] && !group.items[lane].empty()) {
+          group.inRing[lane] = true;
+          group.credit[lane] = 0;
+          _ring[lane].push_back(name);
+        }
+      }
+    }
+
+    // Take group out of every ring and count what it has queued as
+    // blocked
+    void block(const std::string& name, Group& group) {
+      for (size_t lane = 0; lane < Lanes; ++lane) {
+        if (group.inRing[lane]) {
+          auto& ring = _ring[lane];
+          ring.erase(std::find(ring.begin(), ring.end(), name));
+          group.inRing[lane] = false;
+        }
+      }
+      _blocked += queued(group);
+    }
+
+    // Forget groups with nothing queued and nothing out so the map
+    // doesn't grow with every request we ever see
+    void tidy(const std::string& name) {
+      auto found = _groups.find(name);
+      if (found != _groups.end() && found->second.out == 0 && queued(found->second) == 0) {
+        _groups.erase(found);
+      }
+    }
+
+  public:
+
+    void push(const std::string& name, Item item, size_t lane = 0) {
+      auto& group = _groups[name];
+      group.items[lane].push_back(std::move(item));
+      ++_size;
+      if (atLimit(name, group)) {
+        ++_blocked;
+      } else if (!group.inRing[lane]) {
+        group.inRing[lane] = true;
+        group.credit[lane] = 0;
+        _ring[lane].push_back(name);
+      }
+    }
+
+    // The item pop(lane) would return, or nullptr if there isn't one
+    const Item* front(size_t lane = 0) const {
+      if (_ring[lane].empty()) {
+        return nullptr;
+      }
+      return &_groups.at(_ring[lane].front()).items[lane].front();
+    }
+
+    /**
+     * Take the next item from lane. Returns false if there's
+     * nothing in that lane that's allowed out right now. name is
+     * set to the item's group -- pass it to finished once you're
+     * done with the item.
+     */
+    bool pop(Item& item, std::string& name, size_t lane = 0) {
+      if (_ring[lane].empty()) {
+        return false;
+      }
+      name = _ring[lane].front();
+      auto& group = _groups.at(name);
+      item = std::move(group.items[lane].front());
+      group.items[lane].pop_front();
+      --_size;
+      if (settings(name).limit > 0) {
+        ++group.out;
+      }
+      ++group.credit[lane];
+      bool limited = atLimit(name, group);
+      if (limited || group.items[lane].empty() || group.credit[lane] >= settings(name).weight) {
+        _ring[lane].pop_front();
+        group.inRing[lane] = false;
+        group.credit[lane] = 0;
+      }
+      if (limited) {
+        // It goes back in when something finishes
+        block(name, group);
+      } else if (!group.items[lane].empty() && !group.inRing[lane]) {
+        // Used up its turn, so it goes to the back
+        group.inRing[lane] = true;
+        _ring[lane].push_back(name);
+      }
+      tidy(name);
+      return true;
+    }
+
+    /**
+     * Throw out the newest item in lane from whichever group has the
+     * most items in it, so the group that's flooding the queue is
+     * the one that pays. Returns false if the lane's empty.
+     */
+    bool dropNewest(Item& item, size_t lane = 0) {
+      auto biggest = _groups.end();
+      for (auto it = _groups.begin(); it != _groups.end(); ++it) {
+        if (!it->second.items[lane].empty() &&
+            (biggest == _groups.end() || it->second.items[lane].size() > biggest->second.items[lane].size())) {
+          biggest = it;
+        }
+      }
+      if (biggest == _groups.end()) {
+        return false;
+      }
+      auto name = biggest->first;
+      auto& group = biggest->second;
+      item = std::move(group.items[lane].back());
+      group.items[lane].pop_back();
+      --_size;
+      if (atLimit(name, group)) {
+        --_blocked;
+      } else if (group.items[lane].empty() && group.inRing[lane]) {
+        auto& ring = _ring[lane];
+        ring.erase(std::find(ring.begin(), ring.end(), name));
+        group.inRing[lane] = false;
+      }
+      tidy(name);
+      return true;
+    }
+
+    /**
+     * An item from group name that was popped is done. Returns true
+     * if that let the group hand out items again.
+     */
+    bool finished(const std::string& name) {
+      auto found = _groups.find(name);
+      if (found == _groups.end() || found->second.out == 0) {
+        return false;
+      }
+      auto& group = found->second;
+      bool wasLimited = atLimit(name, group);
+      --group.out;
+      bool released = wasLimited && !atLimit(name, group) && queued(group) > 0;
+      if (released) {
+        _blocked -= queued(group);
+        schedule(name, group);
+      }
+      tidy(name);
+      return released;
+    }
+
+    // Only affects items popped after this
+    void setSettings(const std::string& name, Settings groupSettings) {
+      groupSettings.weight = std::max<size_t>(groupSettings.weight, 1);
+      auto found = _groups.find(name);
+      bool wasLimited = found != _groups.end() && atLimit(name, found->second);
+      if (groupSettings.weight == 1 && groupSettings.limit == 0) {
+        _settings.erase(name);
+      } else {
+        _settings[name] = groupSettings;
+      }
+      if (found == _groups.end()) {
+        return;
+      }
+      bool limited = atLimit(name, found->second);
+      if (wasLimited && !limited) {
+        _blocked -= queued(found->second);
+        schedule(name, found->second);
+      } else if (!wasLimited && limited) {
+        block(name, found->second);
+      }
+    }
+
+    Settings getSettings(const std::string& name) const {
+      return settings(name);
+    }
+
+    // True if any group has a limit
+    bool hasLimits() const {
+      for (auto& [name, groupSettings] : _settings) {
+        if (groupSettings.limit > 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Items queued in every lane, including blocked ones
+    size_t size() const {
+      return _size;
+    }
+
+    bool empty() const {
+      return _size == 0;
+    }
+
+    // Items queued in groups that are at their limit
+    size_t blocked() const {
+      return _blocked;
+    }
+
+    // Number of groups with something queued or out
+    size_t groups() const {
+      return _groups.size();
+    }
+  };
+
+}
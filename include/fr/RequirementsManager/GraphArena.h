@@ -0,0 +1,246 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Memory for one graph's worth of nodes. Loading a big graph used
+   * to mean a separate heap allocation for every node, scattered
+   * wherever the heap had room. Nodes allocated from an arena are
+   * packed next to each other in a few big blocks, in the order
+   * they were created, and the blocks all go back to the heap at
+   * once.
+   *
+   * Individual deallocations are ignored. The blocks are freed when
+   * the arena is destroyed, and every node allocated from it holds
+   * a reference to it, so that's when the last of its nodes goes
+   * away. Dropping the graph drops the arena.
+   *
+   * Only the nodes themselves (and their shared_ptr control blocks)
+   * live in the arena. Their up and down lists and strings are
+   * plain std::vectors and std::strings that the bindings and the
+   * serializers all rely on, so those still come from the heap.
+   *
+   * Allocating locks a mutex, so the loaders can share an arena.
+   * Nodes get into an arena one of three ways:
+   *
+   *  - makeNodeIn or makeNode (NodeAllocator uses these)
+   *  - plain new, while a Scope for the arena is active on this
+   *    thread. Node has its own operator new for this, so graphs
+   *    cereal loads in a Scope go in the arena.
+   *  - the Python constructors, inside a "with GraphArena()" block
+   */
+
+  class GraphArena : public std::pmr::memory_resource {
+  public:
+    using Type = GraphArena;
+    using PtrType = std::shared_ptr<Type>;
+    static constexpr size_t defaultBlockSize = 64 * 1024;
+
+  private:
+    std::mutex _mutex;
+    std::pmr::monotonic_buffer_resource _resource;
+    size_t _allocated = 0;
+    // Arenas that were current before enter was called
+    std::vector<PtrType> _outer;
+
+    static PtrType& currentSlot() {
+      thread_local PtrType current;
+      return current;
+    }
+
+    // What Node's operator new puts in front of a node
+    struct alignas(std::max_align_t) Tag {
+      PtrType arena;
+      size_t size;
+    };
+
+  protected:
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _allocated += bytes;
+      return _resource.allocate(bytes, alignment);
+    }
+
+    // It all goes when the arena does
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+
+    explicit GraphArena(size_t blockSize = defaultBlockSize) : _resource(blockSize) {}
+
+    GraphArena(const GraphArena&) = delete;
+    GraphArena& operator=(const GraphArena&) = delete;
+
+    static PtrType create(size_t blockSize = defaultBlockSize) {
+      return std::make_shared<Type>(blockSize);
+    }
+
+    // Bytes handed out so far
+    size_t allocated() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _allocated;
+    }
+
+    // The arena nodes created with new or makeNode go in on this
+    // thread, or null for the heap
+    static PtrType current() {
+      return currentSlot();
+    }
+
+    /**
+     * Makes arena the current one on this thread until it goes out
+     * of scope, then puts back whatever was current before.
+     */
+    class Scope {
+      PtrType _previous;
+
+    public:
+      explicit Scope(PtrType arena) : _previous(std::exchange(currentSlot(), std::move(arena))) {}
+
+      ~Scope() {
+        currentSlot() = std::move(_previous);
+      }
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * Scope for languages that don't have destructors to hang it on.
+     * enter makes arena current on this thread and leave puts back
+     * whatever was current before. They nest, but the enters and
+     * leaves for an arena need to happen on one thread.
+     */
+    static void enter(const PtrType& arena) {
+      arena->_outer.push_back(std::exchange(currentSlot(), arena));
+    }
+
+    static void leave(const PtrType& arena) {
+      if (arena->_outer.empty()) {
+        return;
+      }
+      currentSlot() = std::move(arena->_outer.back());
+      arena->_outer.pop_back();
+    }
+
+    /**
+     * Node's operator new and delete. The memory comes from the
+     * current arena if there is one, and either way it starts with a
+     * Tag saying where it came from, so delete can tell and the
+     * arena stays around as long as the node does.
+     */
+    static void* allocateTagged(size_t size) {
+      auto arena = current();
+      auto total = sizeof(Tag) + size;
+      void* block = arena ?
+        arena->allocate(total, alignof(Tag)) :
+        ::operator new(total);
+      auto tag = ::new (block) Tag{std::move(arena), total};
+      return tag + 1;
+    }
+
+    static void deallocateTagged(void* memory) noexcept {
+      if (!memory) {
+        return;
+      }
+      auto tag = static_cast<Tag*>(memory) - 1;
+      // Hang on to the arena until we're done with its memory
+      auto arena = std::move(tag->arena);
+      auto total = tag->size;
+      tag->~Tag();
+      if (arena) {
+        arena->deallocate(tag, total, alignof(Tag));
+      } else {
+        ::operator delete(tag);
+      }
+    }
+  };
+
+  /**
+   * A standard allocator that allocates from a GraphArena and keeps
+   * it alive. allocate_shared keeps a copy of the allocator in the
+   * shared_ptr's control block, so a node made with one holds on to
+   * its arena.
+   */
+
+  template <typename T>
+  class ArenaAllocator {
+    template <typename U>
+    friend class ArenaAllocator;
+
+    GraphArena::PtrType _arena;
+
+  public:
+    using value_type = T;
+
+    explicit ArenaAllocator(GraphArena::PtrType arena) : _arena(std::move(arena)) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other._arena) {}
+
+    T* allocate(size_t count) {
+      return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* memory, size_t count) {
+      _arena->deallocate(memory, count * sizeof(T), alignof(T));
+    }
+
+    const GraphArena::PtrType& arena() const {
+      return _arena;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+      return _arena == other._arena;
+    }
+  };
+
+  /**
+   * make_shared that puts the node and its control block in arena
+   * next to each other, or on the heap if arena is null.
+   */
+  template <typename T, typename... Args>
+  std::shared_ptr<T> makeNodeIn(const GraphArena::PtrType& arena, Args&&... args) {
+    if (arena) {
+      return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+    }
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+
+  // makeNodeIn the current arena
+  template <typename T, typename... Args>
+  std::shared_ptr<T> makeNode(Args&&... args) {
+    return makeNodeIn<T>(GraphArena::current(), std::forward<Args>(args)...);
+  }
+
+}
@@ -64,6 +64,9 @@ namespace fr::RequirementsManager {
     using Parent = Node;
     using PtrType = std::shared_ptr<Type>;
 
+    // Fields in DbSpecificData<GraphNode>::columns order, for markDirty
+    enum class Field { Title };
+
     GraphNode() = default;
     virtual ~GraphNode() = default;
 
@@ -73,6 +76,7 @@ namespace fr::RequirementsManager {
 
     void setTitle(const std::string& title) {
       _title = title;
+      markDirty(Field::Title);
     }
 
     std::string getTitle() const {
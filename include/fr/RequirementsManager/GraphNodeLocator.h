@@ -17,6 +17,7 @@
 #pragma once
 
 #include <fr/RequirementsManager/GraphNode.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
 #include <memory>
 #include <pqxx/pqxx>
 #include <unordered_map>
@@ -40,13 +41,13 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<GraphNodeLocator>;
 
   private:
-    pqxx::connection _connection;
-    pqxx::work _transaction;
+    std::shared_ptr<database::PqConnectionPool> _pool;
 
   public:
     MapType nodes;
 
-    GraphNodeLocator() : _transaction(_connection) {}
+    GraphNodeLocator(std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault()) :
+      _pool(pool) {}
     ~GraphNodeLocator() {}
 
     // Query queries the graph node database table and
@@ -54,8 +55,10 @@ namespace fr::RequirementsManager {
     void query() {
       // Always load it fresh
       nodes.clear();
+      auto connection = _pool->acquire();
+      pqxx::work transaction(*connection);
       std::string cmd("select id, title from graph_node");
-      pqxx::result res = _transaction.exec(cmd);
+      pqxx::result res = transaction.exec(cmd);
       for (auto const &row : res) {
         auto id = row[0].as<std::string>();
         auto title = row[1].as<std::string>();
@@ -17,8 +17,10 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <fr/RequirementsManager/GraphNodeLocator.h>
+#include <fr/RequirementsManager/ParallelTraversal.h>
 #include <fr/RequirementsManager/PqDatabase.h>
 #include <fr/RequirementsManager/PqNodeFactory.h>
 #include <fr/RequirementsManager/ThreadPool.h>
@@ -26,8 +28,10 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 #include <pistache/common.h>
 #include <pistache/endpoint.h>
 #include <pistache/http.h>
@@ -63,11 +67,37 @@ namespace fr::RequirementsManager {
     Pistache::Http::Endpoint _server;
     // Server port
     int _port;
+    // How many tasks the threadpool will queue up and what it
+    // does once it has that many. See setQueueCapacity.
+    size_t _queueCapacity;
+    OverflowPolicy _overflowPolicy;
+    // What we tell clients to wait when we turn them away
+    std::chrono::seconds _retryAfter;
+    // How long a graph load gets before we give up on it. 0 means
+    // forever.
+    std::chrono::milliseconds _requestTimeout;
+    // Threadpool that only ever marks big POSTed graphs. See
+    // setParallelMarking.
+    std::shared_ptr<ThreadPool<WorkerThreadType>> _traversalPool;
+    // POSTs with more nodes than this get marked on _traversalPool
+    size_t _parallelThreshold;
+    unsigned _traversalThreads;
+    // Give each graph we load or receive its own GraphArena
+    bool _useArenas;
+    // Set if the threadpool should size itself. See setElastic.
+    std::optional<ElasticSettings> _elastic;
 
     void error(Pistache::Http::ResponseWriter& response, const std::string& wat, Pistache::Http::Code code = Pistache::Http::Code::Bad_Request) {
       response.send(code, wat);
     }
 
+    // Threadpool's full. Tell the client to come back later.
+    void unavailable(Pistache::Http::ResponseWriter& response, const QueueFullError& e) {
+      std::cout << "GraphServer turning a request away: " << e.what() << std::endl;
+      response.headers().addRaw(Pistache::Http::Header::Raw("Retry-After", std::to_string(_retryAfter.count())));
+      error(response, "Server busy, try again later", Pistache::Http::Code::Service_Unavailable);
+    }
+
     // Try to retrieve the URL given the HTTP request
     std::string url(const Pistache::Http::Request& request) {
       // See if we have an X-Forwarded-Proto header. If we have
@@ -127,26 +157,22 @@ namespace fr::RequirementsManager {
       // factories that we can assign to requests and then
       // placed back in the vector once they've completed.
       auto factory = std::make_shared<PqNodeFactory<WorkerThreadType>>(id);
-      // Now we need to be vewwwwwy caweful about the order
-      // we do things here or we're gonna have a bad time
-
-      // Synchronization stuff so we can block until the factory
-      // is truly done processing.
-      std::condition_variable waitcondition;
-      std::mutex waitmutex;
-      bool processingComplete = false;
-      factory->done.connect([&waitcondition, &processingComplete](const std::string& id) {
-        processingComplete = true;
-        waitcondition.notify_one();
-      });
-      // Now we can submit the factory to the threadpool for processing
-      _threadpool->enqueue(factory);
-      // Und now ve vait!
-      std::unique_lock lock(waitmutex);
-      // If we don't return processingComplete here, the condition could wake up
-      // due to some other signal. This will solidly return only when the factory
-      // processing is complete.
-      waitcondition.wait(lock, [&processingComplete](){return processingComplete;});
+      // Somebody's waiting on this one. Its loaders inherit this.
+      factory->setPriority(TaskPriority::Interactive);
+      // Once the client's given up there's no point tying up
+      // workers and database connections on its graph. The loaders
+      // get the same token, and running queries get cancelled on
+      // the server.
+      if (_requestTimeout.count() > 0) {
+        factory->setCancellation(CancellationToken::withTimeout(_requestTimeout));
+      }
+      if (_useArenas) {
+        factory->setArena(GraphArena::create());
+      }
+      // The handle isn't done until the factory and every loader it
+      // enqueued have finished, so once wait returns the graph is
+      // fully populated.
+      _threadpool->enqueue(factory).wait();
       return(factory->getNode());
     }
 
@@ -155,14 +181,21 @@ namespace fr::RequirementsManager {
      * whether the UUID existed in the database previously or not.
      * This should be OK.
      *
-     * Note that nodes have a changed flag, but currently this is
-     * ignored and all nodes are written to the database. At
-     * some point I'm probably going to want to fix that so that
-     * only nodes you changed explicitly get saved, but I'll
-     * need to update all the node APIs so that all the setters
-     * change that flag to true if they get called and I'm going
-     * to wait until I want to do a large-ish refactor before
-     * I do that.
+     * The setters record which fields they changed and the
+     * up/down methods record which edges changed, and all of
+     * that comes across in the serialized graph. Nodes that came
+     * out of the database only get those changes written. Nodes
+     * that didn't (or that came from a client old enough not to
+     * send the dirty tracking) get written in full.
+     *
+     * That means the client's tracking is trusted. A node that
+     * says it's persisted, with no dirtyFields and no edgeChanges,
+     * is taken to be unchanged and isn't written at all. A client
+     * that edits nodes some other way than through the setters
+     * (or builds its own JSON) has to either set those, or send
+     * persisted as false to get the node written in full. Skipped
+     * nodes get logged so it's not a total mystery when that
+     * goes wrong.
      *
      * I don't actually have to block here, so I'm not gonna.
      * Once we've created a SaveNodesNode and dispatched it
@@ -170,20 +203,98 @@ namespace fr::RequirementsManager {
      * to wait around.
      */
 
+    // How many skipped nodes a POST lists by id. A big graph with
+    // one edit in it skips nearly everything.
+    static constexpr size_t skippedListed = 10;
+
+    // Say which nodes a POST isn't going to write
+    void logSkipped(size_t count, const std::vector<std::string>& listed) {
+      if (count == 0) {
+        return;
+      }
+      std::cout << "GraphServer (POST) not writing " << count
+                << " node(s) that are persisted with no recorded changes:";
+      for (auto& id : listed) {
+        std::cout << " " << id;
+      }
+      if (count > listed.size()) {
+        std::cout << " ...";
+      }
+      std::cout << std::endl;
+    }
+
+    /**
+     * The changed flag doesn't get serialized, so set it on anything
+     * in graph that has something to save. Each node only looks at
+     * itself, so this is safe to split between workers, but most
+     * POSTs are small and it's not worth the trip. We walk the graph
+     * right here, and if there's a _traversalPool and the graph turns
+     * out to have more than _parallelThreshold nodes, it carries on
+     * from where we got to. That pool doesn't take database work and
+     * doesn't have a capacity, so it won't turn the pass away, and if
+     * it fails anyway we walk the whole thing again here. Marking a
+     * node twice is harmless.
+     */
+    void markChanged(const std::shared_ptr<Node>& graph) {
+      std::mutex skippedMutex;
+      size_t skipped = 0;
+      std::vector<std::string> listed;
+      auto mark = [&](const std::shared_ptr<Node>& node) {
+        if (!node->persisted || node->dirtyFields || !node->edgeChanges.empty()) {
+          node->changed = true;
+        } else {
+          std::lock_guard<std::mutex> lock(skippedMutex);
+          if (++skipped <= skippedListed) {
+            listed.push_back(node->idString());
+          }
+        }
+      };
+      auto pool = _traversalPool;
+      if (!pool) {
+        graph->walk(TraverseOptions(), mark);
+        logSkipped(skipped, listed);
+        return;
+      }
+      Traversal<Node> serial;
+      std::vector<const Node*> marked;
+      serial.run(graph, [&](const std::shared_ptr<Node>& node) {
+        mark(node);
+        marked.push_back(node.get());
+        return marked.size() >= _parallelThreshold ? TraverseAction::Stop : TraverseAction::Continue;
+      });
+      if (serial.stopped()) {
+        try {
+          ParallelTraversal<WorkerThreadType>(pool).resume(serial.pending(), marked, mark);
+        } catch (std::exception& e) {
+          std::cout << "GraphServer (POST) parallel marking failed, finishing it here: " << e.what() << std::endl;
+          skipped = 0;
+          listed.clear();
+          graph->walk(TraverseOptions(), mark);
+        }
+      }
+      logSkipped(skipped, listed);
+    }
+
     void postGraph(std::shared_ptr<Node> graph) {
       std::cout << "GraphServer (POST)" << std::endl;
-      // Set all graph node changesd flags to true right now to force database
-      // saves
       if (graph) {
-        graph->traverse([](std::shared_ptr<Node> node) {
-          if (node) {
-            node->changed = true;
-          } else {
-            std::cout << "postGraph encountered a null during graph traversal. Ignoring." << std::endl;
+        markChanged(graph);
+        auto saver = std::make_shared<SaveNodesNode<WorkerThreadType>>(graph);
+        // Nobody's waiting on saves and a big graph fans out into a
+        // lot of tasks, so keep them out of the way of reads
+        saver->setPriority(TaskPriority::Bulk);
+        // This throws QueueFullError if the threadpool's full, but
+        // under DropLowest a save can also get thrown out after
+        // we've said OK. At least make some noise about it.
+        _threadpool->enqueue(saver).then([](const TaskHandle& handle) {
+          try {
+            handle.wait();
+          } catch (QueueFullError& e) {
+            std::cout << "GraphServer (POST) save dropped: " << e.what() << std::endl;
+          } catch (std::exception& e) {
+            std::cout << "GraphServer (POST) save failed: " << e.what() << std::endl;
           }
         });
-        auto saver = std::make_shared<SaveNodesNode<WorkerThreadType>>(graph);
-        _threadpool->enqueue(saver);
       } else {
         std::cout << "postGraph received a null node! Ignoring." << std::endl;
       }
@@ -225,10 +336,20 @@ namespace fr::RequirementsManager {
         if (id.empty()) {
           error(response, "Empty/No ID specified");
         } else {
-          auto node = graph(id);
           response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
           response.headers().add<Pistache::Http::Header::AccessControlAllowMethods>("GET, POST, OPTIONS");
           response.headers().add<Pistache::Http::Header::AccessControlAllowHeaders>("Content-Type, Authorization");
+          std::shared_ptr<Node> node;
+          try {
+            node = graph(id);
+          } catch (QueueFullError& e) {
+            unavailable(response, e);
+            return Pistache::Rest::Route::Result::Ok;
+          } catch (TaskCancelled& e) {
+            std::cout << "GraphServer gave up loading " << id << ": " << e.what() << std::endl;
+            error(response, "Timed out loading graph", Pistache::Http::Code::Gateway_Timeout);
+            return Pistache::Rest::Route::Result::Ok;
+          }
           if (!node) {
             std::cout << "Node " << id << " not found" << std::endl;
             error(response, "ID not found", Pistache::Http::Code::Not_Found);
@@ -279,6 +400,9 @@ namespace fr::RequirementsManager {
         try {
           std::stringstream stream(body);
           {
+            // Cereal allocates the nodes with new, which goes in
+            // the arena while this is in scope
+            GraphArena::Scope scope(_useArenas ? GraphArena::create() : nullptr);
             cereal::JSONInputArchive archive(stream);
             archive(node);
           }
@@ -287,7 +411,12 @@ namespace fr::RequirementsManager {
           response.send(Pistache::Http::Code::Bad_Request, "Error deserializing graph");
           return Pistache::Rest::Route::Result::Ok;
         }
-        postGraph(node);
+        try {
+          postGraph(node);
+        } catch (QueueFullError& e) {
+          unavailable(response, e);
+          return Pistache::Rest::Route::Result::Ok;
+        }
         std::cout << "POST Complete" << std::endl;
         response.send(Pistache::Http::Code::Ok, "OK");
         return Pistache::Rest::Route::Result::Ok;
@@ -309,7 +438,14 @@ namespace fr::RequirementsManager {
       _server(Pistache::Address(address, port)),
       _graphEndpoint("graph"),
       _graphsEndpoint("graphs"),
-      _port(port)
+      _port(port),
+      _queueCapacity(0),
+      _overflowPolicy(OverflowPolicy::Reject),
+      _retryAfter(1),
+      _requestTimeout(30000),
+      _parallelThreshold(50000),
+      _traversalThreads(0),
+      _useArenas(false)
     {
       setupRoutes();
     }
@@ -320,6 +456,97 @@ namespace fr::RequirementsManager {
       }
     }
 
+    /**
+     * Don't let more than capacity tasks pile up in the threadpool.
+     * Once there are that many, requests get a 503 (or for
+     * DropLowest, queued saves start getting thrown out to make room
+     * for reads). 0, the default, means no limit. You can call this
+     * before or after start.
+     *
+     * A POST counts as one task, since SaveNodesNode writes the whole
+     * graph in one go in SaveMode::Bulk, the default. In
+     * SaveMode::PerNode it fans out into a task per node and all of
+     * those count, so one huge save can hold off other requests until
+     * it's worked through its backlog.
+     */
+    void setQueueCapacity(size_t capacity, OverflowPolicy policy = OverflowPolicy::Reject) {
+      _queueCapacity = capacity;
+      _overflowPolicy = policy;
+      if (_threadpool) {
+        _threadpool->setOverflowPolicy(policy);
+        _threadpool->setCapacity(capacity);
+      }
+    }
+
+    /**
+     * Let the threadpool grow and shrink with the load instead of
+     * starting a fixed number of threads. Call before start --
+     * start's threadPoolThreads gets ignored.
+     */
+    void setElastic(ElasticSettings settings) {
+      _elastic = settings;
+    }
+
+    // The threadpool, once the server's started. Handy for its
+    // metrics.
+    std::shared_ptr<ThreadPool<WorkerThreadType>> getThreadPool() const {
+      return _threadpool;
+    }
+
+    /**
+     * How long a GET for a graph can take before we cancel the load
+     * and send the client a 504. 0 turns the timeout off. Saves
+     * don't have one -- nobody's waiting on them.
+     */
+    void setRequestTimeout(std::chrono::milliseconds timeout) {
+      _requestTimeout = timeout;
+    }
+
+    std::chrono::milliseconds getRequestTimeout() const {
+      return _requestTimeout;
+    }
+
+    /**
+     * Allocate each graph a request loads or posts in one GraphArena,
+     * which is freed all at once when the request's done with the
+     * graph. Off by default.
+     */
+    void setUseArenas(bool useArenas) {
+      _useArenas = useArenas;
+    }
+
+    bool getUseArenas() const {
+      return _useArenas;
+    }
+
+    /**
+     * POSTed graphs with more than threshold nodes get their changed
+     * flags set by threads workers of their own rather than on the
+     * request's thread. The workers are a second threadpool that
+     * start starts, separate from the database one and not counted
+     * by its capacity or elastic sizing. threads 0, the default,
+     * keeps it all on the request's thread and doesn't start them.
+     * Set this before start.
+     */
+    void setParallelMarking(size_t threshold, unsigned threads) {
+      _parallelThreshold = threshold;
+      _traversalThreads = threads;
+    }
+
+    size_t getParallelThreshold() const {
+      return _parallelThreshold;
+    }
+
+    unsigned getTraversalThreads() const {
+      return _traversalThreads;
+    }
+
+    // Seconds to tell clients to wait in the Retry-After header of a
+    // 503
+    void setRetryAfter(std::chrono::seconds retryAfter) {
+      _retryAfter = retryAfter;
+    }
+
     /**
      * Start the server. The server will kick off a thread so it
      * can run in the background, will allocate endpointThreads threads
@@ -333,7 +560,17 @@ namespace fr::RequirementsManager {
       bool started = false;
       if (!_running) {
         _threadpool = std::make_shared<ThreadPool<WorkerThreadType>>();
-        _threadpool->startThreads(threadPoolThreads);
+        _threadpool->setOverflowPolicy(_overflowPolicy);
+        _threadpool->setCapacity(_queueCapacity);
+        if (_elastic) {
+          _threadpool->startElastic(*_elastic);
+        } else {
+          _threadpool->startThreads(threadPoolThreads);
+        }
+        if (_traversalThreads > 0) {
+          _traversalPool = std::make_shared<ThreadPool<WorkerThreadType>>();
+          _traversalPool->startThreads(_traversalThreads);
+        }
         _serverThread = std::thread([&]() {
           _running = true;
           _shutdown = false;
@@ -360,6 +597,11 @@ namespace fr::RequirementsManager {
         _server.shutdown();
         _serverThread.join();
         _threadpool->join();
+        if (_traversalPool) {
+          _traversalPool->shutdown();
+          _traversalPool->join();
+          _traversalPool.reset();
+        }
         _running = false;
       }
     }
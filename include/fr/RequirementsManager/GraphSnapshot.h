@@ -0,0 +1,481 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <fr/RequirementsManager/Node.h>
+#include <fr/RequirementsManager/Traversal.h>
+#include <fr/RequirementsManager/UuidSet.h>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * A read-only copy of the shape of a graph. Nodes are numbered
+   * 0 to size() - 1 and each node's up and down links are a run of
+   * node numbers in one big array (compressed sparse row, if you
+   * want to look it up.) Walking one doesn't touch a shared_ptr or
+   * a mutex, and everything it needs is in a handful of vectors.
+   *
+   * That makes it a good fit for answering questions about a graph
+   * nobody's changing -- what's under this requirement, can you get
+   * from here to there -- and it serializes to a lot less than the
+   * graph does. It doesn't keep the nodes or any of their fields,
+   * just their ids, types and links. Take a new snapshot if the
+   * graph changes.
+   *
+   * Nodes are numbered in the order Node::traverse visits them, so
+   * the starting node is 0.
+   */
+
+  class GraphSnapshot {
+  public:
+    using Type = GraphSnapshot;
+    using PtrType = std::shared_ptr<Type>;
+    using Index = uint32_t;
+    using TypeTag = uint16_t;
+    static constexpr Index npos = std::numeric_limits<Index>::max();
+    static constexpr TypeTag noType = std::numeric_limits<TypeTag>::max();
+
+  private:
+    std::vector<boost::uuids::uuid> _ids;
+    // Index into _typeNames for each node
+    std::vector<TypeTag> _types;
+    std::vector<std::string> _typeNames;
+    // Node i's links are _up[_upOffsets[i]] to _up[_upOffsets[i + 1]]
+    std::vector<Index> _upOffsets;
+    std::vector<Index> _up;
+    std::vector<Index> _downOffsets;
+    std::vector<Index> _down;
+    // Open addressed table of node numbers, looked up by id
+    std::vector<Index> _slots;
+
+    size_t mask() const {
+      return _slots.size() - 1;
+    }
+
+    void buildLookup() {
+      _slots.assign(std::bit_ceil(std::max<size_t>(_ids.size() * 2, 16)), npos);
+      for (Index i = 0; i < _ids.size(); ++i) {
+        size_t slot = UuidHash()(_ids[i]) & mask();
+        while (_slots[slot] != npos) {
+          slot = (slot + 1) & mask();
+        }
+        _slots[slot] = i;
+      }
+    }
+
+    template <typename Fn>
+    static TraverseAction call(Fn& fn, Index node, size_t depth) {
+      if constexpr (std::is_invocable_v<Fn&, Index, size_t>) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, Index, size_t>>) {
+          fn(node, depth);
+          return TraverseAction::Continue;
+        } else {
+          return fn(node, depth);
+        }
+      } else {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, Index>>) {
+          fn(node);
+          return TraverseAction::Continue;
+        } else {
+          return fn(node);
+        }
+      }
+    }
+
+    template <typename Each>
+    void forEachNeighbour(Index node, EdgeFilter edges, Each&& each) const {
+      if (follows(edges, EdgeFilter::Up)) {
+        for (auto next : up(node)) {
+          each(next);
+        }
+      }
+      if (follows(edges, EdgeFilter::Down)) {
+        for (auto next : down(node)) {
+          each(next);
+        }
+      }
+    }
+
+    void checkIndex(Index node) const {
+      if (node >= size()) {
+        throw std::out_of_range("Node index " + std::to_string(node) + " is not in the snapshot");
+      }
+    }
+
+    // Throw if a loaded snapshot doesn't hang together
+    void validate() const {
+      auto check = [this](const std::vector<Index>& offsets, const std::vector<Index>& edges) {
+        if (offsets.size() != _ids.size() + 1 || offsets.front() != 0 || offsets.back() != edges.size() ||
+            !std::is_sorted(offsets.begin(), offsets.end())) {
+          throw std::runtime_error("Graph snapshot has bad edge offsets");
+        }
+        for (auto edge : edges) {
+          if (edge >= _ids.size()) {
+            throw std::runtime_error("Graph snapshot has an edge to a node it doesn't have");
+          }
+        }
+      };
+      if (_types.size() != _ids.size()) {
+        throw std::runtime_error("Graph snapshot has the wrong number of node types");
+      }
+      for (auto type : _types) {
+        if (type >= _typeNames.size()) {
+          throw std::runtime_error("Graph snapshot has a node with an unknown type");
+        }
+      }
+      check(_upOffsets, _up);
+      check(_downOffsets, _down);
+    }
+
+  public:
+
+    GraphSnapshot() : _upOffsets{0}, _downOffsets{0} {
+      buildLookup();
+    }
+
+    // Snapshot everything reachable from start through up and down
+    // links. Don't change the graph while this is running.
+    static GraphSnapshot freeze(const Node::PtrType& start) {
+      return freeze(std::vector<Node::PtrType>{start});
+    }
+
+    // Snapshot everything reachable from any of roots
+    static GraphSnapshot freeze(const std::vector<Node::PtrType>& roots) {
+      GraphSnapshot snapshot;
+      // The graph holds on to these for us
+      std::vector<Node*> nodes;
+      Traversal<Node> traversal(TraverseOptions{TraverseOrder::DepthFirst, EdgeFilter::UpDown});
+      for (auto& root : roots) {
+        traversal.run(root, [&nodes](const Node::PtrType& node) {
+          nodes.push_back(node.get());
+        });
+      }
+      if (nodes.size() >= npos) {
+        throw std::length_error("Graph is too big to snapshot");
+      }
+
+      std::unordered_map<std::string, TypeTag> tags;
+      snapshot._ids.reserve(nodes.size());
+      snapshot._types.reserve(nodes.size());
+      for (auto node : nodes) {
+        snapshot._ids.push_back(node->id);
+        auto [tag, added] = tags.try_emplace(node->getNodeType(), static_cast<TypeTag>(snapshot._typeNames.size()));
+        if (added) {
+          snapshot._typeNames.push_back(tag->first);
+        }
+        snapshot._types.push_back(tag->second);
+      }
+      snapshot.buildLookup();
+
+      snapshot._upOffsets.reserve(nodes.size() + 1);
+      snapshot._downOffsets.reserve(nodes.size() + 1);
+      auto link = [&snapshot](const std::vector<Node::PtrType>& list, std::vector<Index>& edges) {
+        for (auto& next : list) {
+          if (next) {
+            edges.push_back(snapshot.find(next->id));
+          }
+        }
+      };
+      for (auto node : nodes) {
+        link(node->up, snapshot._up);
+        snapshot._upOffsets.push_back(static_cast<Index>(snapshot._up.size()));
+        link(node->down, snapshot._down);
+        snapshot._downOffsets.push_back(static_cast<Index>(snapshot._down.size()));
+      }
+      return snapshot;
+    }
+
+    size_t size() const {
+      return _ids.size();
+    }
+
+    bool empty() const {
+      return _ids.empty();
+    }
+
+    // Up and down links, counted separately. Every link between two
+    // nodes in the graph shows up in both, once from each end.
+    size_t upEdgeCount() const {
+      return _up.size();
+    }
+
+    size_t downEdgeCount() const {
+      return _down.size();
+    }
+
+    // Node number for id, or npos
+    Index find(const boost::uuids::uuid& id) const {
+      size_t slot = UuidHash()(id) & mask();
+      while (_slots[slot] != npos) {
+        if (_ids[_slots[slot]] == id) {
+          return _slots[slot];
+        }
+        slot = (slot + 1) & mask();
+      }
+      return npos;
+    }
+
+    Index find(const std::string& id) const {
+      try {
+        boost::uuids::string_generator generator;
+        return find(generator(id));
+      } catch (const std::exception&) {
+        return npos;
+      }
+    }
+
+    const boost::uuids::uuid& id(Index node) const {
+      checkIndex(node);
+      return _ids[node];
+    }
+
+    std::string idString(Index node) const {
+      return boost::uuids::to_string(id(node));
+    }
+
+    TypeTag typeTag(Index node) const {
+      checkIndex(node);
+      return _types[node];
+    }
+
+    // What getNodeType returned for the node
+    const std::string& nodeType(Index node) const {
+      return _typeNames[typeTag(node)];
+    }
+
+    // Tag for a node type name, or noType if there aren't any
+    TypeTag tagFor(const std::string& nodeType) const {
+      auto found = std::find(_typeNames.begin(), _typeNames.end(), nodeType);
+      return found == _typeNames.end() ? noType : static_cast<TypeTag>(found - _typeNames.begin());
+    }
+
+    // Every node type in the snapshot, indexed by tag
+    const std::vector<std::string>& typeNames() const {
+      return _typeNames;
+    }
+
+    // Every node's tag, indexed by node number
+    const std::vector<TypeTag>& typeTags() const {
+      return _types;
+    }
+
+    std::span<const Index> up(Index node) const {
+      checkIndex(node);
+      return std::span<const Index>(_up).subspan(_upOffsets[node], _upOffsets[node + 1] - _upOffsets[node]);
+    }
+
+    std::span<const Index> down(Index node) const {
+      checkIndex(node);
+      return std::span<const Index>(_down).subspan(_downOffsets[node], _downOffsets[node + 1] - _downOffsets[node]);
+    }
+
+    /**
+     * Same as Node::walk, but fn gets node numbers (and optionally
+     * depths) instead of nodes. There aren't any related nodes in a
+     * snapshot, so EdgeFilter::Related doesn't do anything. Returns
+     * the number of nodes visited.
+     */
+    template <typename Fn>
+    size_t walk(Index start, const TraverseOptions& options, Fn&& fn) const {
+      checkIndex(start);
+      std::vector<bool> visited(size());
+      size_t count = 0;
+      if (options.order == TraverseOrder::BreadthFirst) {
+        std::deque<std::pair<Index, size_t>> queue;
+        visited[start] = true;
+        queue.push_back({start, 0});
+        while (!queue.empty()) {
+          auto [node, depth] = queue.front();
+          queue.pop_front();
+          ++count;
+          auto action = call(fn, node, depth);
+          if (action == TraverseAction::Stop) {
+            break;
+          }
+          if (action == TraverseAction::Prune || depth >= options.maxDepth) {
+            continue;
+          }
+          forEachNeighbour(node, options.edges, [&](Index next) {
+            if (!visited[next]) {
+              visited[next] = true;
+              queue.push_back({next, depth + 1});
+            }
+          });
+        }
+        return count;
+      }
+
+      std::vector<std::pair<Index, size_t>> stack;
+      stack.push_back({start, 0});
+      while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (visited[node]) {
+          continue;
+        }
+        visited[node] = true;
+        ++count;
+        auto action = call(fn, node, depth);
+        if (action == TraverseAction::Stop) {
+          break;
+        }
+        if (action == TraverseAction::Prune || depth >= options.maxDepth) {
+          continue;
+        }
+        auto first = stack.size();
+        forEachNeighbour(node, options.edges, [&](Index next) {
+          if (!visited[next]) {
+            stack.push_back({next, depth + 1});
+          }
+        });
+        // So the first neighbour comes off the stack first
+        std::reverse(stack.begin() + first, stack.end());
+      }
+      return count;
+    }
+
+    template <typename Fn>
+    size_t walk(Index start, Fn&& fn) const {
+      return walk(start, TraverseOptions(), std::forward<Fn>(fn));
+    }
+
+    // Everything you can get to from start following edges,
+    // including start, nearest first
+    std::vector<Index> reachableFrom(Index start, EdgeFilter edges = EdgeFilter::Down) const {
+      std::vector<Index> ret;
+      walk(start, TraverseOptions{TraverseOrder::BreadthFirst, edges}, [&ret](Index node) {
+        ret.push_back(node);
+      });
+      return ret;
+    }
+
+    // True if there's a path from one node to the other following
+    // edges. A node can always reach itself.
+    bool reachable(Index from, Index to, EdgeFilter edges = EdgeFilter::Down) const {
+      checkIndex(to);
+      bool found = false;
+      walk(from, TraverseOptions{TraverseOrder::BreadthFirst, edges}, [&found, to](Index node) {
+        if (node == to) {
+          found = true;
+          return TraverseAction::Stop;
+        }
+        return TraverseAction::Continue;
+      });
+      return found;
+    }
+
+    /**
+     * Cereal serialization. Works with any of the archives, but the
+     * binary ones are a lot smaller -- ids go in those as their raw
+     * sixteen bytes, where the text ones get the usual strings.
+     * Loading checks that the edges all point somewhere and throws
+     * std::runtime_error if not.
+     */
+    template <class Archive>
+    void save(Archive& ar) const {
+      if constexpr (cereal::traits::is_text_archive<Archive>::value) {
+        std::vector<std::string> ids;
+        ids.reserve(_ids.size());
+        for (auto& id : _ids) {
+          ids.push_back(boost::uuids::to_string(id));
+        }
+        ar(cereal::make_nvp("ids", ids));
+      } else {
+        static_assert(sizeof(boost::uuids::uuid) == 16 && std::is_trivially_copyable_v<boost::uuids::uuid>);
+        cereal::size_type count = _ids.size();
+        ar(cereal::make_size_tag(count));
+        // As bytes, so the portable archive doesn't swap them
+        ar(cereal::binary_data(reinterpret_cast<const uint8_t*>(_ids.data()), _ids.size() * sizeof(boost::uuids::uuid)));
+      }
+      ar(cereal::make_nvp("typeNames", _typeNames));
+      ar(cereal::make_nvp("types", _types));
+      ar(cereal::make_nvp("upOffsets", _upOffsets));
+      ar(cereal::make_nvp("up", _up));
+      ar(cereal::make_nvp("downOffsets", _downOffsets));
+      ar(cereal::make_nvp("down", _down));
+    }
+
+    template <class Archive>
+    void load(Archive& ar) {
+      if constexpr (cereal::traits::is_text_archive<Archive>::value) {
+        std::vector<std::string> ids;
+        ar(cereal::make_nvp("ids", ids));
+        boost::uuids::string_generator generator;
+        _ids.clear();
+        _ids.reserve(ids.size());
+        for (auto& id : ids) {
+          _ids.push_back(generator(id));
+        }
+      } else {
+        cereal::size_type count = 0;
+        ar(cereal::make_size_tag(count));
+        _ids.resize(static_cast<size_t>(count));
+        ar(cereal::binary_data(reinterpret_cast<uint8_t*>(_ids.data()), _ids.size() * sizeof(boost::uuids::uuid)));
+      }
+      ar(cereal::make_nvp("typeNames", _typeNames));
+      ar(cereal::make_nvp("types", _types));
+      ar(cereal::make_nvp("upOffsets", _upOffsets));
+      ar(cereal::make_nvp("up", _up));
+      ar(cereal::make_nvp("downOffsets", _downOffsets));
+      ar(cereal::make_nvp("down", _down));
+      validate();
+      buildLookup();
+    }
+
+    std::string to_json() const {
+      std::stringstream stream;
+      {
+        cereal::JSONOutputArchive archive(stream);
+        archive(cereal::make_nvp("GraphSnapshot", *this));
+      }
+      return stream.str();
+    }
+
+    static GraphSnapshot from_json(const std::string& json) {
+      GraphSnapshot ret;
+      std::stringstream stream(json);
+      {
+        cereal::JSONInputArchive archive(stream);
+        archive(cereal::make_nvp("GraphSnapshot", ret));
+      }
+      return ret;
+    }
+  };
+
+}
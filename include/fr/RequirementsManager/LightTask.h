@@ -0,0 +1,192 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <fr/RequirementsManager/Task.h>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * A move-only void() callable that keeps anything up to Size
+   * bytes inline, so a lambda capturing a few pointers doesn't need
+   * an allocation of its own. Bigger ones go on the heap like
+   * std::function would put them.
+   */
+
+  template <size_t Size = 48>
+  class SmallFunction {
+    struct Ops {
+      void (*call)(void*);
+      // Move the callable from one buffer to another and clean up
+      // the old one
+      void (*move)(void* from, void* to);
+      void (*destroy)(void*);
+    };
+
+    template <typename Fn>
+    struct Inline {
+      static Fn* get(void* storage) {
+        return std::launder(static_cast<Fn*>(storage));
+      }
+
+      static void call(void* storage) {
+        (*get(storage))();
+      }
+
+      static void move(void* from, void* to) {
+        ::new (to) Fn(std::move(*get(from)));
+        get(from)->~Fn();
+      }
+
+      static void destroy(void* storage) {
+        get(storage)->~Fn();
+      }
+
+      static constexpr Ops ops{call, move, destroy};
+    };
+
+    template <typename Fn>
+    struct Boxed {
+      static Fn*& get(void* storage) {
+        return *std::launder(static_cast<Fn**>(storage));
+      }
+
+      static void call(void* storage) {
+        (*get(storage))();
+      }
+
+      static void move(void* from, void* to) {
+        ::new (to) Fn*(get(from));
+      }
+
+      static void destroy(void* storage) {
+        delete get(storage);
+      }
+
+      static constexpr Ops ops{call, move, destroy};
+    };
+
+    template <typename Fn>
+    static constexpr bool fitsInline =
+      sizeof(Fn) <= Size &&
+      alignof(Fn) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<Fn>;
+
+    alignas(std::max_align_t) std::byte _storage[Size];
+    const Ops* _ops = nullptr;
+
+    void take(SmallFunction& other) {
+      if (other._ops) {
+        other._ops->move(other._storage, _storage);
+        _ops = std::exchange(other._ops, nullptr);
+      }
+    }
+
+  public:
+    using Type = SmallFunction<Size>;
+
+    SmallFunction() = default;
+
+    template <typename F>
+    requires (!std::same_as<std::decay_t<F>, SmallFunction> && std::invocable<std::decay_t<F>&>)
+    SmallFunction(F&& fn) {
+      using Fn = std::decay_t<F>;
+      if constexpr (fitsInline<Fn>) {
+        ::new (static_cast<void*>(_storage)) Fn(std::forward<F>(fn));
+        _ops = &Inline<Fn>::ops;
+      } else {
+        ::new (static_cast<void*>(_storage)) Fn*(new Fn(std::forward<F>(fn)));
+        _ops = &Boxed<Fn>::ops;
+      }
+    }
+
+    SmallFunction(const SmallFunction&) = delete;
+    SmallFunction& operator=(const SmallFunction&) = delete;
+
+    SmallFunction(SmallFunction&& other) noexcept {
+      take(other);
+    }
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept {
+      if (this != &other) {
+        reset();
+        take(other);
+      }
+      return *this;
+    }
+
+    ~SmallFunction() {
+      reset();
+    }
+
+    void reset() {
+      if (_ops) {
+        _ops->destroy(_storage);
+        _ops = nullptr;
+      }
+    }
+
+    explicit operator bool() const {
+      return _ops != nullptr;
+    }
+
+    void operator()() {
+      _ops->call(_storage);
+    }
+  };
+
+  /**
+   * A task that just runs a function. It's not a Node, so there's
+   * no UUID to generate, no mutex and no up/down lists, and the
+   * function lives inside the task object unless it's big. Use
+   * these (usually through ThreadPool::submit) for fine-grained
+   * work where a TaskNode per item would cost more than the item.
+   */
+
+  template <typename WorkerType>
+  class LightTask : public Task<WorkerType> {
+    SmallFunction<> _fn;
+
+  public:
+    using Type = LightTask<WorkerType>;
+    using PtrType = std::shared_ptr<Type>;
+    using Parent = Task<WorkerType>;
+
+    template <typename Fn>
+    requires (!std::same_as<std::decay_t<Fn>, LightTask>)
+    LightTask(Fn&& fn) : _fn(std::forward<Fn>(fn)) {}
+
+    virtual ~LightTask() {}
+
+    std::string taskType() const override {
+      return "LightTask";
+    }
+
+    void run() override {
+      if (_fn) {
+        _fn();
+      }
+    }
+  };
+
+}
@@ -24,6 +24,9 @@
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <list>
@@ -31,7 +34,15 @@
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fr/RequirementsManager/EdgeIndex.h>
+#include <fr/RequirementsManager/GraphArena.h>
+#include <fr/RequirementsManager/Traversal.h>
+#include <fr/RequirementsManager/UuidSet.h>
 
 
 namespace fr::RequirementsManager {
@@ -44,42 +55,155 @@ namespace fr::RequirementsManager {
   struct Node : public std::enable_shared_from_this<Node> {
   public:
     using PtrType = std::shared_ptr<Node>;
-    
-  protected:
 
-    // Private function to traverse graph. Public entrypoint does not contain visisted
-    // reference
-    
-    virtual void traverse(std::function<void(PtrType)> eachNodeFn, std::unordered_map<std::string, PtrType> &visited) {
-      // Handle this node
+    /**
+     * One edge that was added to or removed from this node since
+     * it was last loaded or saved. id is the node on the other end
+     * and down says which of our lists it was in.
+     */
+    struct EdgeChange {
+      std::string id;
+      bool down = false;
+      bool added = false;
 
-      // Force init if not already initted
-      if (!this->initted) {
-        this->init();
+      template <class Archive>
+      void serialize(Archive& ar) {
+        ar(cereal::make_nvp("id", id));
+        ar(cereal::make_nvp("down", down));
+        ar(cereal::make_nvp("added", added));
       }
+    };
 
-      if (! visited.contains(this->idString())) {
-        visited[this->idString()] = this->shared_from_this();
-        if (eachNodeFn) {
-          eachNodeFn(this->shared_from_this());
+  private:
+    template <typename>
+    friend class EdgeIndex;
+
+    // Find nodes in up and down without scanning them
+    EdgeIndex<PtrType> _upIndex;
+    EdgeIndex<PtrType> _downIndex;
+    // Some node's EdgeIndex has been keyed on our id, so changing it
+    // has to tell them. _indexedBy has their stale flags. Other
+    // nodes set these while they're indexing us, so they don't go
+    // under our nodeMutex.
+    std::atomic<bool> _inEdgeIndex = false;
+    std::mutex _indexedByMutex;
+    std::vector<std::weak_ptr<std::atomic<bool>>> _indexedBy;
+    // Nodes at the other end of an edge with an entry in
+    // edgeChanges, and how many entries those cover
+    UuidSet _changedUp;
+    UuidSet _changedDown;
+    size_t _changesIndexed = 0;
+
+    EdgeIndex<PtrType>* indexFor(const std::vector<PtrType>& list) {
+      if (&list == &up) {
+        return &_upIndex;
+      }
+      if (&list == &down) {
+        return &_downIndex;
+      }
+      return nullptr;
+    }
+
+    // Position of the node with id in list, or EdgeIndex::npos.
+    // This only reads, the index included.
+    size_t positionIn(const boost::uuids::uuid& id, const std::vector<PtrType>& list) {
+      if (auto index = indexFor(list)) {
+        return index->find(id, list);
+      }
+      for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i] && list[i]->id == id) {
+          return i;
         }
       }
+      return EdgeIndex<PtrType>::npos;
+    }
+
+    // Catch list's index up before we change list
+    void syncIndex(const std::vector<PtrType>& list) {
+      if (auto index = indexFor(list)) {
+        index->sync(list);
+      }
+    }
 
-      // Handle up nodes
-      for (auto upNode : up) {
-        if (! visited.contains(upNode->idString())) {
-          upNode->traverse(eachNodeFn, visited);
+    // An EdgeIndex is about to key us on our id. stale is what to
+    // set if that changes.
+    void indexedBy(const std::shared_ptr<std::atomic<bool>>& stale) {
+      std::lock_guard<std::mutex> lock(_indexedByMutex);
+      _inEdgeIndex.store(true, std::memory_order_relaxed);
+      std::erase_if(_indexedBy, [](const auto& held) { return held.expired(); });
+      for (auto& held : _indexedBy) {
+        if (held.lock() == stale) {
+          return;
         }
       }
+      _indexedBy.push_back(stale);
+    }
 
-      // Handle down nodes
-      for (auto downNode : down) {
-        if (! visited.contains(downNode->idString())) {
-          downNode->traverse(eachNodeFn, visited);
+    // Our id changed, so indexes keyed on the old one are stale.
+    // They pick us up again when they rebuild.
+    void idChanged() {
+      if (!_inEdgeIndex.load(std::memory_order_relaxed)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(_indexedByMutex);
+      for (auto& held : _indexedBy) {
+        if (auto stale = held.lock()) {
+          stale->store(true, std::memory_order_release);
         }
       }
+      _indexedBy.clear();
+      _inEdgeIndex.store(false, std::memory_order_relaxed);
     }
-    
+
+    // Pick up anything that was added to edgeChanges directly, or
+    // start over if it shrank
+    void syncEdgeChanges() {
+      if (edgeChanges.size() < _changesIndexed) {
+        _changedUp.clear();
+        _changedDown.clear();
+        _changesIndexed = 0;
+      }
+      for (; _changesIndexed < edgeChanges.size(); ++_changesIndexed) {
+        auto& change = edgeChanges[_changesIndexed];
+        (change.down ? _changedDown : _changedUp).insert(parseUuid(change.id));
+      }
+    }
+
+    // Anything that isn't a UUID comes back nil, which recordEdge
+    // treats as "might be there, go and look"
+    static boost::uuids::uuid parseUuid(const std::string& id) {
+      try {
+        boost::uuids::string_generator generator;
+        return generator(id);
+      } catch (const std::exception&) {
+        return boost::uuids::nil_uuid();
+      }
+    }
+
+    void recordEdge(const boost::uuids::uuid& uuid, const std::string& id, bool down, bool added) {
+      changed = true;
+      syncEdgeChanges();
+      auto& pending = down ? _changedDown : _changedUp;
+      // Usually there's nothing there and we don't have to look
+      if (pending.contains(uuid)) {
+        for (auto it = edgeChanges.begin(); it != edgeChanges.end(); ++it) {
+          if (it->id == id && it->down == down) {
+            if (it->added != added) {
+              edgeChanges.erase(it);
+              --_changesIndexed;
+              if (!uuid.is_nil()) {
+                pending.erase(uuid);
+              }
+            }
+            return;
+          }
+        }
+      }
+      edgeChanges.push_back({id, down, added});
+      pending.insert(uuid);
+      ++_changesIndexed;
+    }
+
   public:
 
     // Lock nodeMutex before changing values, serializing/deserializing
@@ -101,6 +225,18 @@ namespace fr::RequirementsManager {
     // calling init() to set the UUID or changing a data field
     // in one of the children nodes.
     bool changed = false;
+    // One bit per field that's been set since the node was last
+    // loaded or saved. Each node type numbers its fields with a
+    // Field enum, in the same order as its database columns (not
+    // counting id.)
+    uint64_t dirtyFields = 0;
+    // Edges added or removed since the node was last loaded or
+    // saved. An add and a remove of the same edge cancel out.
+    std::vector<EdgeChange> edgeChanges;
+    // The node came from the database or has been saved to it.
+    // Only these can be saved by writing just the dirty fields and
+    // edge changes, everything else has to be written in full.
+    bool persisted = false;
     // Track if the node has been initted. I could just check the
     // UUID for this but setting a bool when init is called is a bit
     // easier.
@@ -112,6 +248,17 @@ namespace fr::RequirementsManager {
     // entity with the same up/down lists.
     Node(const Node& copy) = default;
     virtual ~Node() = default;
+
+    // Nodes created with plain new (cereal does this when it loads
+    // a graph) go in the current GraphArena, if there is one.
+    // make_shared doesn't use these -- use makeNode for that.
+    static void* operator new(size_t size) {
+      return GraphArena::allocateTagged(size);
+    }
+
+    static void operator delete(void* memory) noexcept {
+      GraphArena::deallocateTagged(memory);
+    }
     
     // Set the id field
     virtual void init() {
@@ -120,18 +267,26 @@ namespace fr::RequirementsManager {
       initted = true;
       boost::uuids::time_generator_v7 generator;
       id = generator();
+      idChanged();
+    }
+
+    // Find a node ID in a vector. Lookups in our own up and down
+    // lists don't have to scan them (see EdgeIndex.) The find
+    // methods don't change anything, so several threads can look
+    // things up in a node at once as long as nobody's changing its
+    // lists.
+    PtrType findIn(const boost::uuids::uuid& id, std::vector<PtrType> &list) {
+      auto position = positionIn(id, list);
+      return position == EdgeIndex<PtrType>::npos ? PtrType() : list[position];
     }
 
-    // Find a node ID in a vector
     PtrType findIn(const std::string& id, std::vector<PtrType> &list) {
-      PtrType ret;
-      for (auto item : list) {
-        if (id == item->idString()) {
-          ret = item;
-          break;
-        }
+      auto uuid = parseUuid(id);
+      if (uuid.is_nil() && id != boost::uuids::to_string(uuid)) {
+        // Not a UUID, so nothing's going to match it
+        return PtrType();
       }
-      return ret;
+      return findIn(uuid, list);
     }
 
     // Find a node ID in our uplist
@@ -139,56 +294,175 @@ namespace fr::RequirementsManager {
       return findIn(id, up);
     }
 
+    PtrType findUp(const boost::uuids::uuid& id) {
+      return findIn(id, up);
+    }
+
     // Find a nide in our downlist
     PtrType findDown(const std::string& id) {
       return findIn(id, down);
     }
 
-    // Add a node to a vector
-    void addNode(PtrType node, std::vector<PtrType> &list) {
-      if (!findIn(node->idString(), list)) {
+    PtrType findDown(const boost::uuids::uuid& id) {
+      return findIn(id, down);
+    }
+
+    // Add a node to a vector. Returns false if it was already there.
+    bool addNode(PtrType node, std::vector<PtrType> &list) {
+      syncIndex(list);
+      if (positionIn(node->id, list) == EdgeIndex<PtrType>::npos) {
         list.push_back(node);
+        return true;
       }
+      return false;
     }
 
     // Add a node to our uplist
     PtrType addUp(PtrType node) {
-      addNode(node, up);
+      if (addNode(node, up)) {
+        recordEdge(node->id, node->idString(), false, true);
+      }
       return node;
     }
 
     // Add a node to our downlist
     PtrType addDown(PtrType node) {
-      addNode(node, down);
+      if (addNode(node, down)) {
+        recordEdge(node->id, node->idString(), true, true);
+      }
       return node;
     }
 
-    // Remove a node from a vector
-    void removeFromList(PtrType node, std::vector<PtrType>& vec) {
-      vec.erase(std::remove_if(vec.begin(),
-                               vec.end(),
-                               [&node](PtrType n){
-                                 return n->idString() == node->idString();
-                               }),
-                vec.end());
+    // Remove a node from a vector. Returns false if it wasn't there.
+    bool removeFromList(PtrType node, std::vector<PtrType>& vec) {
+      auto index = indexFor(vec);
+      syncIndex(vec);
+      bool removed = false;
+      // Normally it's only in there once, but anything can get
+      // pushed on directly
+      for (auto position = positionIn(node->id, vec);
+           position != EdgeIndex<PtrType>::npos;
+           position = positionIn(node->id, vec)) {
+        vec.erase(vec.begin() + position);
+        if (index) {
+          index->erased(position, vec);
+        }
+        removed = true;
+      }
+      return removed;
+    }
+
+    /**
+     * Adding to the end of up, down or edgeChanges directly is fine,
+     * but if you change them any other way (other than through
+     * this class), call this so lookups don't go by stale indexes.
+     * That includes assigning a whole new list -- or use setUp and
+     * setDown, which do it for you.
+     */
+    void reindex() {
+      _upIndex.reset();
+      _downIndex.reset();
+      _changedUp.clear();
+      _changedDown.clear();
+      _changesIndexed = 0;
+    }
+
+    // Replace the up or down list. Unlike assigning to up or down,
+    // this keeps lookups right.
+    void setUp(const std::vector<PtrType>& nodes) {
+      up = nodes;
+      _upIndex.reset();
+    }
+
+    void setDown(const std::vector<PtrType>& nodes) {
+      down = nodes;
+      _downIndex.reset();
+    }
+
+    // Flag field (one of the node type's Field enum values) as
+    // needing to be saved
+    template <typename FieldType>
+    requires std::is_enum_v<FieldType>
+    void markDirty(FieldType field) {
+      dirtyFields |= uint64_t{1} << static_cast<unsigned>(field);
+      changed = true;
+    }
+
+    // True if field has been set since the node was last loaded or saved
+    template <typename FieldType>
+    requires std::is_enum_v<FieldType>
+    bool isDirty(FieldType field) const {
+      return dirtyFields & (uint64_t{1} << static_cast<unsigned>(field));
+    }
+
+    /**
+     * Remember that the edge to id in our down list (or up list if
+     * down is false) was added or removed, so a save can write just
+     * that edge. Removing an edge we added since the last save (or
+     * the other way around) just forgets about it.
+     */
+    void recordEdge(const std::string& id, bool down, bool added) {
+      recordEdge(parseUuid(id), id, down, added);
+    }
+
+    /**
+     * The node matches what's in the database now. The loaders
+     * call this once they've filled a node in and the savers call
+     * it once their transaction has committed.
+     */
+    void clearDirty() {
+      dirtyFields = 0;
+      edgeChanges.clear();
+      _changedUp.clear();
+      _changedDown.clear();
+      _changesIndexed = 0;
+      changed = false;
+      persisted = true;
     }
 
     // Traverse the graph from this node. Pass traverse a lambda to be run
-    // against each visited node.
+    // against each visited node. Nodes that haven't been initted get
+    // initted along the way.
 
     virtual void traverse(std::function<void(PtrType)> eachNodeFn) {
-      std::unordered_map<std::string,PtrType> visited;
+      walk(TraverseOptions(), [&eachNodeFn](const PtrType& node) {
+        if (eachNodeFn) {
+          eachNodeFn(node);
+        }
+      });
+    }
 
-      traverse(eachNodeFn, visited);
+    /**
+     * Traverse with a choice of order, which edges to follow and how
+     * deep to go. fn gets each node (and optionally its depth) and
+     * can return a TraverseAction to prune or stop the traversal.
+     * Returns the number of nodes visited. See Traversal.
+     */
+    template <typename Fn>
+    size_t walk(const TraverseOptions& options, Fn&& fn) {
+      Traversal<Node> traversal(options);
+      return traversal.run(shared_from_this(), std::forward<Fn>(fn));
     }
+
+    /**
+     * Nodes linked to this one other than through up and down.
+     * Traversals follow these too (see EdgeFilter::Related), so a
+     * node type that links to other nodes some other way should add
+     * them here.
+     */
+    virtual void relatedNodes(std::vector<PtrType>& related) {}
     
     // Remove a node from the up list
     void removeUp(PtrType node) {
-      return removeFromList(node, up);
+      if (removeFromList(node, up)) {
+        recordEdge(node->idString(), false, false);
+      }
     }
     
     void removeDown(PtrType node) {
-      return removeFromList(node, down);
+      if (removeFromList(node, down)) {
+        recordEdge(node->idString(), true, false);
+      }
     }
     
     // Returns ID as string. Note init must be called to actually
@@ -204,6 +478,7 @@ namespace fr::RequirementsManager {
       boost::uuids::string_generator generator;
       id = generator(uuid);
       changed = true;
+      idChanged();
     }
 
     // Return Node Type -- The C++ type system is very strong but a lot of it
@@ -229,6 +504,9 @@ namespace fr::RequirementsManager {
       return stream.str();
     }
 
+    // dirtyFields, edgeChanges and persisted came along later than
+    // the rest. JSON and XML written before them still loads -- the
+    // node just comes in as not persisted, so it gets saved in full.
     template <class Archive>
     void save(Archive& ar) const {
       std::lock_guard<std::mutex> lock(nodeMutex);      
@@ -236,6 +514,9 @@ namespace fr::RequirementsManager {
       ar(cereal::make_nvp("upList", up));
       ar(cereal::make_nvp("downList", down));
       ar(cereal::make_nvp("initted", initted));
+      ar(cereal::make_nvp("dirtyFields", dirtyFields));
+      ar(cereal::make_nvp("edgeChanges", edgeChanges));
+      ar(cereal::make_nvp("persisted", persisted));
     }
 
     template <class Archive>
@@ -245,11 +526,30 @@ namespace fr::RequirementsManager {
       std::string uuid_str;
       ar(uuid_str);
       id = generator(uuid_str);
+      idChanged();
       ar(up);
       ar(down);
       ar(initted);
+      bool tracked = true;
+      if constexpr (requires { ar.getNodeName(); }) {
+        // The text archives can tell us what's next. The binary ones
+        // can't, and always have the tracking.
+        auto next = ar.getNodeName();
+        tracked = next && std::string_view(next) == "dirtyFields";
+      }
+      if (tracked) {
+        ar(dirtyFields);
+        ar(edgeChanges);
+        ar(persisted);
+      } else {
+        dirtyFields = 0;
+        edgeChanges.clear();
+        persisted = false;
+      }
+      reindex();
     }
 
   };
   
 }
+
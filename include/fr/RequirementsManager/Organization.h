@@ -39,6 +39,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Organization>::columns order, for markDirty
+    enum class Field { Locked, Name };
+
   private:
     // Lock organization to prevent changes (You can still add/remove nodes though.)
     bool _locked = false;
@@ -63,6 +66,7 @@ namespace fr::RequirementsManager {
       } else {
 	throw std::logic_error("Organization is locked, can't make changes.");
       }
+      markDirty(Field::Name);
     }
     
     std::string getName() const {
@@ -71,10 +75,12 @@ namespace fr::RequirementsManager {
 
     void lock() {
       _locked = true;
+      markDirty(Field::Locked);
     }
 
     void unlock() {
       _locked = false;
+      markDirty(Field::Locked);
     }
 
     template <class Archive>
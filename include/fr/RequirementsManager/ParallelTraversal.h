@@ -0,0 +1,301 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fr/RequirementsManager/Node.h>
+#include <fr/RequirementsManager/Task.h>
+#include <fr/RequirementsManager/ThreadPool.h>
+#include <fr/RequirementsManager/Traversal.h>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Nodes a parallel traversal has claimed. It's split into shards
+   * with a lock each so workers claiming different nodes rarely wait
+   * on each other.
+   *
+   * Nodes go in by address rather than UUID. A node that hasn't been
+   * initted doesn't have its UUID yet, and going by address means
+   * exactly one worker claims it and inits it before anybody looks
+   * at its id.
+   */
+
+  class ConcurrentNodeSet {
+  public:
+    static constexpr size_t shardCount = 64;
+
+  private:
+    struct alignas(64) Shard {
+      std::mutex mutex;
+      std::unordered_set<const void*> nodes;
+    };
+
+    std::array<Shard, shardCount> _shards;
+
+    static size_t shardFor(const void* node) {
+      // Nodes are 16 byte aligned at least, so skip the low bits
+      auto bits = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node) >> 4);
+      return static_cast<size_t>((bits * 0x9e3779b97f4a7c15ull) >> 58);
+    }
+
+  public:
+
+    // True for the first caller to insert node
+    bool insert(const void* node) {
+      auto& shard = _shards[shardFor(node)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return shard.nodes.insert(node).second;
+    }
+
+    bool contains(const void* node) {
+      auto& shard = _shards[shardFor(node)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return shard.nodes.contains(node);
+    }
+
+    size_t size() {
+      size_t ret = 0;
+      for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        ret += shard.nodes.size();
+      }
+      return ret;
+    }
+  };
+
+  struct ParallelTraverseOptions {
+    // Which links to follow. There's no order or depth limit --
+    // with several workers at it, neither would mean much.
+    EdgeFilter edges = EdgeFilter::All;
+    // A task with more than this many nodes waiting hands half of
+    // them to a new task another worker can pick up. Smaller
+    // spreads the work out sooner, bigger means fewer tasks.
+    size_t grain = 256;
+    TaskPriority priority = TaskPriority::Normal;
+  };
+
+  /**
+   * Node::traverse, but with the ThreadPool's workers splitting the
+   * nodes between them. Each task works through a stack of nodes
+   * and claims their neighbours in a ConcurrentNodeSet as it goes,
+   * and when its stack gets bigger than the grain it hands half of
+   * it off in a new task. Every node reachable from the start gets
+   * visited exactly once. Uninitted nodes get initted, same as
+   * traverse.
+   *
+   * The visitor gets each node and can return nothing or a
+   * TraverseAction. Prune keeps the traversal from going past that
+   * node. Stop stops the traversal, although nodes other workers
+   * are already visiting still finish.
+   *
+   * Things to know about the visitor:
+   *
+   *  - It's called from several workers at once, so anything it
+   *    shares between calls (counters, containers, the stream it's
+   *    printing to) needs an atomic or a lock.
+   *  - It never gets the same node twice, so changing the node
+   *    it's given is fine -- setting changed, say. It can read
+   *    other nodes but mustn't change them.
+   *  - Nothing may change up, down or related links anywhere in
+   *    the graph while the traversal's running. Workers are reading
+   *    them.
+   *  - If it throws, the traversal stops and run rethrows the first
+   *    exception once all the workers are done.
+   *  - Visit order isn't anything in particular.
+   *
+   * run blocks until the traversal's done, so don't call it from
+   * inside a task on the same pool -- if every worker ends up
+   * waiting on one, nothing's left to do the work.
+   */
+
+  template <typename WorkerThreadType>
+  class ParallelTraversal {
+  public:
+    using Type = ParallelTraversal<WorkerThreadType>;
+    using PoolType = ThreadPool<WorkerThreadType>;
+
+  private:
+
+    template <typename Fn>
+    struct State {
+      Fn& fn;
+      ParallelTraverseOptions options;
+      std::shared_ptr<PoolType> pool;
+      ConcurrentNodeSet claimed;
+      std::atomic<size_t> visited{0};
+      std::atomic<bool> stopped{false};
+
+      State(Fn& fn, ParallelTraverseOptions options, std::shared_ptr<PoolType> pool) :
+        fn(fn), options(options), pool(std::move(pool)) {}
+    };
+
+    std::shared_ptr<PoolType> _pool;
+    ParallelTraverseOptions _options;
+
+    template <typename Fn>
+    static TraverseAction call(Fn& fn, const Node::PtrType& node) {
+      if constexpr (std::is_void_v<std::invoke_result_t<Fn&, const Node::PtrType&>>) {
+        fn(node);
+        return TraverseAction::Continue;
+      } else {
+        return fn(node);
+      }
+    }
+
+    // Push next on pending if nobody else has claimed it
+    template <typename Fn>
+    static void claim(State<Fn>& state, const Node::PtrType& next, std::vector<Node::PtrType>& pending) {
+      if (next && state.claimed.insert(next.get())) {
+        pending.push_back(next);
+      }
+    }
+
+    template <typename Fn>
+    static void spawn(const std::shared_ptr<State<Fn>>& state, std::vector<Node::PtrType> nodes) {
+      state->pool->submit([state, nodes = std::move(nodes)]() mutable {
+        work(state, std::move(nodes));
+      }, state->options.priority);
+    }
+
+    // One task's share. Everything in pending has already been
+    // claimed for it.
+    template <typename Fn>
+    static void work(const std::shared_ptr<State<Fn>>& state, std::vector<Node::PtrType> pending) {
+      auto& options = state->options;
+      std::vector<Node::PtrType> related;
+      while (!pending.empty() && !state->stopped.load(std::memory_order_relaxed)) {
+        if (pending.size() > options.grain) {
+          // The oldest half, which is likely to be nearer the
+          // start and have the most left under it
+          auto half = pending.size() / 2;
+          std::vector<Node::PtrType> share(std::make_move_iterator(pending.begin()),
+                                           std::make_move_iterator(pending.begin() + half));
+          pending.erase(pending.begin(), pending.begin() + half);
+          spawn(state, std::move(share));
+        }
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        if (!node->initted) {
+          node->init();
+        }
+        TraverseAction action;
+        try {
+          action = call(state->fn, node);
+        } catch (...) {
+          state->stopped = true;
+          throw;
+        }
+        state->visited.fetch_add(1, std::memory_order_relaxed);
+        if (action == TraverseAction::Stop) {
+          state->stopped = true;
+          break;
+        }
+        if (action == TraverseAction::Prune) {
+          continue;
+        }
+        if (follows(options.edges, EdgeFilter::Up)) {
+          for (auto& next : node->up) {
+            claim(*state, next, pending);
+          }
+        }
+        if (follows(options.edges, EdgeFilter::Down)) {
+          for (auto& next : node->down) {
+            claim(*state, next, pending);
+          }
+        }
+        if (follows(options.edges, EdgeFilter::Related)) {
+          related.clear();
+          node->relatedNodes(related);
+          for (auto& next : related) {
+            claim(*state, next, pending);
+          }
+        }
+      }
+    }
+
+  public:
+
+    ParallelTraversal(std::shared_ptr<PoolType> pool, ParallelTraverseOptions options = ParallelTraverseOptions()) :
+      _pool(std::move(pool)), _options(options) {
+      if (!_pool) {
+        throw std::invalid_argument("ParallelTraversal needs a threadpool");
+      }
+      if (_options.grain == 0) {
+        _options.grain = 1;
+      }
+    }
+
+    /**
+     * Visit everything reachable from roots. Returns how many nodes
+     * fn was called for. Throws QueueFullError if the pool won't
+     * take the first task, and rethrows anything fn threw.
+     */
+    template <typename Fn>
+    size_t run(const std::vector<Node::PtrType>& roots, Fn&& fn) {
+      return resume(roots, {}, std::forward<Fn>(fn));
+    }
+
+    /**
+     * Carry on from a traversal that was stopped partway, like a
+     * Traversal whose callback returned Stop. pending are the nodes
+     * it found but didn't visit (Traversal::pending), and visited are
+     * the ones it did, which don't get visited again. Same as run
+     * otherwise.
+     */
+    template <typename Fn>
+    size_t resume(const std::vector<Node::PtrType>& pending, const std::vector<const Node*>& visited, Fn&& fn) {
+      auto state = std::make_shared<State<std::remove_reference_t<Fn>>>(fn, _options, _pool);
+      for (auto node : visited) {
+        state->claimed.insert(node);
+      }
+      std::vector<Node::PtrType> start;
+      for (auto& node : pending) {
+        claim(*state, node, start);
+      }
+      if (start.empty()) {
+        return 0;
+      }
+      // Everything the first task spawns is part of its subtree, so
+      // the handle isn't done until they all are
+      _pool->submit([state, start = std::move(start)]() mutable {
+        work(state, std::move(start));
+      }, _options.priority).wait();
+      return state->visited.load();
+    }
+
+    template <typename Fn>
+    size_t run(const Node::PtrType& start, Fn&& fn) {
+      return run(std::vector<Node::PtrType>{start}, std::forward<Fn>(fn));
+    }
+
+    const ParallelTraverseOptions& options() const {
+      return _options;
+    }
+  };
+
+}
@@ -0,0 +1,192 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Counts durations in power of two buckets of microseconds. Bucket
+   * 0 is anything under a microsecond and bucket i is [2^(i-1),
+   * 2^i) microseconds, with everything past the last bucket piled
+   * into it. That's coarse, but recording is a couple of
+   * instructions and it's plenty to tell a 50us queue wait from a
+   * 20ms query.
+   */
+
+  class LatencyHistogram {
+  public:
+    using Type = LatencyHistogram;
+    static constexpr size_t bucketCount = 32;
+
+  private:
+    std::array<uint64_t, bucketCount> _buckets{};
+    uint64_t _count = 0;
+    std::chrono::nanoseconds _total{0};
+    std::chrono::nanoseconds _max{0};
+
+  public:
+
+    static size_t bucketFor(std::chrono::nanoseconds duration) {
+      auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+      if (micros <= 0) {
+        return 0;
+      }
+      return std::min<size_t>(std::bit_width(static_cast<uint64_t>(micros)), bucketCount - 1);
+    }
+
+    // Everything in bucket is shorter than this
+    static std::chrono::nanoseconds bucketLimit(size_t bucket) {
+      return std::chrono::microseconds(uint64_t{1} << bucket);
+    }
+
+    void record(std::chrono::nanoseconds duration) {
+      ++_buckets[bucketFor(duration)];
+      ++_count;
+      _total += duration;
+      _max = std::max(_max, duration);
+    }
+
+    void merge(const LatencyHistogram& other) {
+      for (size_t i = 0; i < bucketCount; ++i) {
+        _buckets[i] += other._buckets[i];
+      }
+      _count += other._count;
+      _total += other._total;
+      _max = std::max(_max, other._max);
+    }
+
+    uint64_t count() const {
+      return _count;
+    }
+
+    std::chrono::nanoseconds total() const {
+      return _total;
+    }
+
+    std::chrono::nanoseconds max() const {
+      return _max;
+    }
+
+    std::chrono::nanoseconds mean() const {
+      return _count ? _total / static_cast<int64_t>(_count) : std::chrono::nanoseconds(0);
+    }
+
+    /**
+     * Roughly the duration fraction (0 to 1) of the samples were
+     * under -- the top of the bucket that sample lands in, or the
+     * longest sample if that's less.
+     */
+    std::chrono::nanoseconds percentile(double fraction) const {
+      if (_count == 0) {
+        return std::chrono::nanoseconds(0);
+      }
+      auto wanted = static_cast<uint64_t>(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(_count));
+      wanted = std::max<uint64_t>(wanted, 1);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < bucketCount; ++i) {
+        seen += _buckets[i];
+        if (seen >= wanted) {
+          return std::min(bucketLimit(i), _max);
+        }
+      }
+      return _max;
+    }
+
+    const std::array<uint64_t, bucketCount>& buckets() const {
+      return _buckets;
+    }
+  };
+
+  // What ThreadPool saw of one kind of task (see Task::taskType)
+  struct TaskTypeMetrics {
+    // From enqueue (or resume, for coroutine tasks) until a worker
+    // started it
+    LatencyHistogram wait;
+    // How long run took. A coroutine task counts each stretch
+    // between suspensions separately.
+    LatencyHistogram run;
+    uint64_t errors = 0;
+    // Skipped because their cancellation token was cancelled before
+    // they got a worker. These don't count towards run or errors.
+    uint64_t cancelled = 0;
+
+    void merge(const TaskTypeMetrics& other) {
+      wait.merge(other.wait);
+      run.merge(other.run);
+      errors += other.errors;
+      cancelled += other.cancelled;
+    }
+  };
+
+  struct WorkerMetrics {
+    uint64_t tasks = 0;
+    // Time spent running tasks, and time since the worker started
+    // (or the metrics were last reset)
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds elapsed{0};
+
+    double busyRatio() const {
+      return elapsed.count() > 0 ?
+        std::min(1.0, static_cast<double>(busy.count()) / static_cast<double>(elapsed.count())) : 0.0;
+    }
+
+    double idleRatio() const {
+      return 1.0 - busyRatio();
+    }
+  };
+
+  /**
+   * A snapshot of ThreadPool::metrics. Everything cumulative counts
+   * from when the pool was created or resetMetrics was last called.
+   * Tasks run by workers that have since retired still count
+   * towards completed and types, but the workers drop out of
+   * workers.
+   */
+
+  struct PoolMetrics {
+    std::chrono::nanoseconds elapsed{0};
+    uint64_t completed = 0;
+    // Right now, and the most there's been at once
+    size_t queued = 0;
+    size_t blocked = 0;
+    size_t maxQueued = 0;
+    // Waiting at each priority right now, indexed by TaskPriority
+    std::vector<size_t> depths;
+    std::map<std::string, TaskTypeMetrics> types;
+    std::vector<WorkerMetrics> workers;
+    // Workers running now, and how many an elastic pool has added
+    // and retired
+    size_t threads = 0;
+    uint64_t grown = 0;
+    uint64_t retired = 0;
+
+    double tasksPerSecond() const {
+      auto seconds = std::chrono::duration<double>(elapsed).count();
+      return seconds > 0 ? static_cast<double>(completed) / seconds : 0.0;
+    }
+  };
+
+}
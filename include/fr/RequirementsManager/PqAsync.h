@@ -0,0 +1,850 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <deque>
+#include <fcntl.h>
+#include <format>
+#include <fr/RequirementsManager/CoroutineTask.h>
+#include <fr/RequirementsManager/PqStatements.h>
+#include <functional>
+#include <libpq-fe.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace fr::RequirementsManager::database {
+
+  /**
+   * Query parameters for PqAsyncConnection. Everything goes over in
+   * text format, same as pqxx does it, so appending the values from
+   * a DbSpecificData row tuple gives Postgres exactly what the
+   * synchronous code sends. Vectors of strings become array
+   * literals.
+   */
+
+  class PqAsyncParams {
+    std::vector<std::optional<std::string>> _values;
+
+  public:
+
+    PqAsyncParams() = default;
+
+    template <typename... Values>
+    explicit PqAsyncParams(Values&&... values) {
+      (append(std::forward<Values>(values)), ...);
+    }
+
+    void append(const std::string& value) {
+      _values.emplace_back(value);
+    }
+
+    void append(const char* value) {
+      _values.emplace_back(value);
+    }
+
+    void append(bool value) {
+      _values.emplace_back(value ? "t" : "f");
+    }
+
+    template <typename Number>
+    requires (std::integral<Number> && !std::same_as<Number, bool>)
+    void append(Number value) {
+      _values.emplace_back(std::to_string(value));
+    }
+
+    template <typename Value>
+    void append(const std::optional<Value>& value) {
+      if (value) {
+        append(*value);
+      } else {
+        _values.emplace_back(std::nullopt);
+      }
+    }
+
+    void append(const std::vector<std::string>& values) {
+      std::string literal = "{";
+      for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+          literal += ',';
+        }
+        literal += '"';
+        for (char c : values[i]) {
+          if (c == '"' || c == '\\') {
+            literal += '\\';
+          }
+          literal += c;
+        }
+        literal += '"';
+      }
+      literal += '}';
+      _values.emplace_back(std::move(literal));
+    }
+
+    size_t size() const {
+      return _values.size();
+    }
+
+    // The text of value i, or nullptr for NULL
+    const char* value(size_t i) const {
+      return _values[i] ? _values[i]->c_str() : nullptr;
+    }
+  };
+
+  /**
+   * One column of one row of a PqAsyncResult. It does just enough
+   * of what pqxx::field does for DbSpecificData::populate.
+   */
+
+  class PqAsyncField {
+    const PGresult* _result;
+    int _row;
+    int _column;
+
+  public:
+
+    PqAsyncField(const PGresult* result, int row, int column) :
+      _result(result), _row(row), _column(column) {
+    }
+
+    bool is_null() const {
+      return _column < 0 || PQgetisnull(_result, _row, _column);
+    }
+
+    const char* c_str() const {
+      return _column < 0 ? "" : PQgetvalue(_result, _row, _column);
+    }
+
+    std::string_view view() const {
+      return _column < 0 ? std::string_view() :
+        std::string_view(PQgetvalue(_result, _row, _column), PQgetlength(_result, _row, _column));
+    }
+
+    template <typename T>
+    T as() const {
+      if constexpr (std::same_as<T, std::string>) {
+        return std::string(view());
+      } else if constexpr (std::same_as<T, bool>) {
+        auto text = view();
+        return !text.empty() && (text[0] == 't' || text[0] == '1');
+      } else {
+        static_assert(std::integral<T>, "PqAsyncField only converts to strings, bools and integers");
+        T ret{};
+        auto text = view();
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), ret);
+        if (error != std::errc()) {
+          throw std::runtime_error(std::format("Can't convert \"{}\" to a number", text));
+        }
+        return ret;
+      }
+    }
+  };
+
+  class PqAsyncRow {
+    const PGresult* _result;
+    int _row;
+
+  public:
+
+    PqAsyncRow(const PGresult* result, int row) : _result(result), _row(row) {}
+
+    // Columns that aren't in the result come back as NULL
+    PqAsyncField operator[](const char* column) const {
+      return PqAsyncField(_result, _row, PQfnumber(_result, column));
+    }
+
+    PqAsyncField operator[](int column) const {
+      return PqAsyncField(_result, _row, column);
+    }
+  };
+
+  /**
+   * What a query on a PqAsyncConnection gives back. Copies share the
+   * underlying PGresult.
+   */
+
+  class PqAsyncResult {
+    std::shared_ptr<PGresult> _result;
+
+  public:
+
+    class iterator {
+      const PGresult* _result;
+      int _row;
+
+    public:
+      iterator(const PGresult* result, int row) : _result(result), _row(row) {}
+      PqAsyncRow operator*() const { return PqAsyncRow(_result, _row); }
+      iterator& operator++() { ++_row; return *this; }
+      bool operator==(const iterator& other) const { return _row == other._row; }
+    };
+
+    PqAsyncResult() = default;
+    explicit PqAsyncResult(PGresult* result) : _result(result, PQclear) {}
+
+    size_t size() const {
+      return _result ? PQntuples(_result.get()) : 0;
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    PqAsyncRow operator[](size_t row) const {
+      return PqAsyncRow(_result.get(), static_cast<int>(row));
+    }
+
+    iterator begin() const {
+      return iterator(_result.get(), 0);
+    }
+
+    iterator end() const {
+      return iterator(_result.get(), static_cast<int>(size()));
+    }
+
+    // Rows an INSERT, UPDATE or DELETE touched
+    size_t affected_rows() const {
+      if (!_result) {
+        return 0;
+      }
+      const char* count = PQcmdTuples(_result.get());
+      size_t ret = 0;
+      std::from_chars(count, count + std::char_traits<char>::length(count), ret);
+      return ret;
+    }
+  };
+
+  /**
+   * A libpq connection in non-blocking mode. These are separate from
+   * the pqxx connections in PqConnectionPool -- pqxx doesn't let you
+   * at its PGconn, and these have to stay in non-blocking mode for
+   * their whole lives anyway. Connecting is still a blocking call,
+   * but PqAsyncConnectionPool only does that once per connection.
+   *
+   * Like PooledConnection, each one remembers which statements are
+   * prepared on it. Statements come from the same registry
+   * (PqStatements) as the synchronous code uses, and get prepared on
+   * first use.
+   */
+
+  class PqAsyncConnection {
+    std::unique_ptr<PGconn, decltype(&PQfinish)> _connection;
+    // For cancelling whatever's running from another thread
+    std::unique_ptr<PGcancel, decltype(&PQfreeCancel)> _cancel;
+    std::unordered_set<std::string> _prepared;
+
+  public:
+    using Type = PqAsyncConnection;
+    using PtrType = std::unique_ptr<Type>;
+
+    explicit PqAsyncConnection(const std::string& connectionString) :
+      _connection(PQconnectdb(connectionString.c_str()), PQfinish),
+      _cancel(nullptr, PQfreeCancel) {
+      if (!_connection || PQstatus(_connection.get()) != CONNECTION_OK) {
+        throw std::runtime_error(std::format("Couldn't connect to the database: {}",
+                                             _connection ? PQerrorMessage(_connection.get()) : "out of memory"));
+      }
+      if (PQsetnonblocking(_connection.get(), 1) != 0) {
+        throw std::runtime_error("Couldn't put database connection in non-blocking mode");
+      }
+      _cancel.reset(PQgetCancel(_connection.get()));
+    }
+
+    PGconn* get() {
+      return _connection.get();
+    }
+
+    // Connected and not in the middle of anything, so it's safe to
+    // hand to somebody else
+    bool ok() const {
+      return _connection &&
+        PQstatus(_connection.get()) == CONNECTION_OK &&
+        PQtransactionStatus(_connection.get()) == PQTRANS_IDLE;
+    }
+
+    /**
+     * Ask the server to cancel the query that's running on this
+     * connection. Safe to call from any thread. The query fails with
+     * a "canceling statement" error if the server got to it in time.
+     */
+    bool cancel() {
+      char error[256];
+      return _cancel && PQcancel(_cancel.get(), error, sizeof(error));
+    }
+
+    bool isPrepared(const std::string& name) const {
+      return _prepared.contains(name);
+    }
+
+    void markPrepared(const std::string& name) {
+      _prepared.insert(name);
+    }
+  };
+
+  /**
+   * One thread that sits in poll() on the sockets of every
+   * connection with a query in flight. When a query's results have
+   * all arrived it tells the query, which resumes the coroutine that
+   * was waiting on it. It never runs any of our code besides reading
+   * results, so one is plenty for the whole process.
+   */
+
+  class PqReactor {
+  public:
+
+    // Something the reactor can wait on for you
+    class Watched {
+    public:
+      virtual ~Watched() {}
+      virtual PGconn* connection() = 0;
+      // POLLIN or POLLOUT
+      virtual short events() = 0;
+      // The socket's ready. Return true once you're finished.
+      virtual bool onReady() = 0;
+      virtual void finish() = 0;
+    };
+
+  private:
+    std::mutex _mutex;
+    std::vector<std::shared_ptr<Watched>> _adding;
+    int _wake[2];
+    bool _stop = false;
+    std::thread _thread;
+
+    void loop() {
+      std::vector<std::shared_ptr<Watched>> watching;
+      std::vector<pollfd> fds;
+      while (true) {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (_stop) {
+            break;
+          }
+          for (auto& watched : _adding) {
+            watching.push_back(std::move(watched));
+          }
+          _adding.clear();
+        }
+        fds.clear();
+        fds.push_back({_wake[0], POLLIN, 0});
+        for (auto& watched : watching) {
+          fds.push_back({PQsocket(watched->connection()), watched->events(), 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+          continue;
+        }
+        if (fds[0].revents & POLLIN) {
+          char buffer[64];
+          while (read(_wake[0], buffer, sizeof(buffer)) > 0) {
+          }
+        }
+        std::vector<std::shared_ptr<Watched>> finished;
+        size_t kept = 0;
+        for (size_t i = 0; i < watching.size(); ++i) {
+          bool done = false;
+          if (fds[i + 1].revents) {
+            done = watching[i]->onReady();
+          }
+          if (done) {
+            finished.push_back(std::move(watching[i]));
+          } else {
+            watching[kept++] = std::move(watching[i]);
+          }
+        }
+        watching.resize(kept);
+        for (auto& watched : finished) {
+          watched->finish();
+        }
+      }
+    }
+
+  public:
+
+    PqReactor() {
+      if (pipe(_wake) != 0) {
+        throw std::runtime_error("PqReactor couldn't create its wakeup pipe");
+      }
+      fcntl(_wake[0], F_SETFL, O_NONBLOCK);
+      fcntl(_wake[1], F_SETFL, O_NONBLOCK);
+      _thread = std::thread([this]() { loop(); });
+    }
+
+    ~PqReactor() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      wake();
+      _thread.join();
+      close(_wake[0]);
+      close(_wake[1]);
+    }
+
+    static PqReactor& instance() {
+      static PqReactor reactor;
+      return reactor;
+    }
+
+    void watch(std::shared_ptr<Watched> watched) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _adding.push_back(std::move(watched));
+      }
+      wake();
+    }
+
+  private:
+
+    void wake() {
+      char c = 0;
+      [[maybe_unused]] auto written = write(_wake[1], &c, 1);
+    }
+  };
+
+  /**
+   * A prepared statement running on a PqAsyncConnection. If the
+   * statement isn't prepared on that connection yet, it's prepared
+   * first, in the same trip through the reactor. co_await
+   * PqAsyncConnection::exec to get one of these.
+   */
+
+  class PqAsyncQuery : public AsyncOp,
+                       public PqReactor::Watched,
+                       public std::enable_shared_from_this<PqAsyncQuery> {
+    PqAsyncConnection& _connection;
+    std::string _name;
+    PqAsyncParams _params;
+    bool _preparing = false;
+    bool _flushing = false;
+    PqAsyncResult _result;
+    std::string _error;
+    std::function<void()> _done;
+
+    bool send() {
+      auto* connection = _connection.get();
+      int sent;
+      if (_preparing) {
+        sent = PQsendPrepare(connection, _name.c_str(), PqStatements::sql(_name).c_str(), 0, nullptr);
+      } else {
+        std::vector<const char*> values;
+        values.reserve(_params.size());
+        for (size_t i = 0; i < _params.size(); ++i) {
+          values.push_back(_params.value(i));
+        }
+        sent = PQsendQueryPrepared(connection, _name.c_str(), static_cast<int>(values.size()),
+                                   values.data(), nullptr, nullptr, 0);
+      }
+      if (!sent) {
+        _error = PQerrorMessage(connection);
+        return false;
+      }
+      return flush();
+    }
+
+    bool flush() {
+      int flushed = PQflush(_connection.get());
+      if (flushed < 0) {
+        _error = PQerrorMessage(_connection.get());
+        return false;
+      }
+      _flushing = (flushed == 1);
+      return true;
+    }
+
+  public:
+
+    PqAsyncQuery(PqAsyncConnection& connection, const std::string& name, PqAsyncParams params) :
+      _connection(connection),
+      _name(name),
+      _params(std::move(params)),
+      _preparing(!connection.isPrepared(name)) {
+    }
+
+    bool ready() const {
+      return false;
+    }
+
+    // Throws std::runtime_error with the server's message if the
+    // query failed
+    PqAsyncResult result() {
+      if (!_error.empty()) {
+        throw std::runtime_error(_error);
+      }
+      return _result;
+    }
+
+    void start(std::function<void()> done) override {
+      _done = std::move(done);
+      if (!send()) {
+        finish();
+        return;
+      }
+      PqReactor::instance().watch(shared_from_this());
+    }
+
+    // The reactor finishes us once the server's given up on the query
+    void cancel() override {
+      _connection.cancel();
+    }
+
+    PGconn* connection() override {
+      return _connection.get();
+    }
+
+    short events() override {
+      return _flushing ? POLLOUT : POLLIN;
+    }
+
+    bool onReady() override {
+      auto* connection = _connection.get();
+      if (_flushing) {
+        if (!flush()) {
+          return true;
+        }
+        if (_flushing) {
+          return false;
+        }
+      }
+      if (!PQconsumeInput(connection)) {
+        _error = PQerrorMessage(connection);
+        return true;
+      }
+      while (!PQisBusy(connection)) {
+        PGresult* result = PQgetResult(connection);
+        if (!result) {
+          // That's everything for this command
+          if (_preparing && _error.empty()) {
+            _connection.markPrepared(_name);
+            _preparing = false;
+            return !send();
+          }
+          return true;
+        }
+        auto status = PQresultStatus(result);
+        if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK && _error.empty()) {
+          _error = PQresultErrorMessage(result);
+        }
+        if (_preparing) {
+          PQclear(result);
+        } else {
+          _result = PqAsyncResult(result);
+        }
+      }
+      return false;
+    }
+
+    void finish() override {
+      auto done = std::move(_done);
+      done();
+    }
+  };
+
+  inline AsyncAwaiter<PqAsyncQuery> exec(PqAsyncConnection& connection, const std::string& name,
+                                         PqAsyncParams params = PqAsyncParams()) {
+    return {std::make_shared<PqAsyncQuery>(connection, name, std::move(params))};
+  }
+
+  class PqAsyncConnectionPool;
+
+  /**
+   * A connection borrowed from a PqAsyncConnectionPool. It goes back
+   * when this is destroyed.
+   */
+
+  class PqAsyncLease {
+    std::shared_ptr<PqAsyncConnectionPool> _pool;
+    PqAsyncConnection::PtrType _connection;
+
+  public:
+    PqAsyncLease() = default;
+    PqAsyncLease(std::shared_ptr<PqAsyncConnectionPool> pool, PqAsyncConnection::PtrType connection) :
+      _pool(pool), _connection(std::move(connection)) {
+    }
+    PqAsyncLease(const PqAsyncLease&) = delete;
+    PqAsyncLease& operator=(const PqAsyncLease&) = delete;
+    PqAsyncLease(PqAsyncLease&&) = default;
+
+    PqAsyncLease& operator=(PqAsyncLease&& other) {
+      if (this != &other) {
+        reset();
+        _pool = std::move(other._pool);
+        _connection = std::move(other._connection);
+      }
+      return *this;
+    }
+
+    ~PqAsyncLease() {
+      reset();
+    }
+
+    void reset();
+
+    PqAsyncConnection& operator*() {
+      return *_connection;
+    }
+
+    PqAsyncConnection* operator->() {
+      return _connection.get();
+    }
+  };
+
+  /**
+   * A bounded pool of PqAsyncConnections. co_await acquire() gets you
+   * a lease; if every connection is out, the coroutine suspends until
+   * one comes back instead of blocking a worker thread.
+   *
+   * Postgres runs one query at a time per connection, so this is
+   * what actually limits how many coroutine queries are in flight.
+   * Size it for that rather than for the number of worker threads.
+   */
+
+  class PqAsyncConnectionPool : public std::enable_shared_from_this<PqAsyncConnectionPool> {
+  public:
+    using Type = PqAsyncConnectionPool;
+    using PtrType = std::shared_ptr<Type>;
+
+    // co_await this to get a PqAsyncLease
+    class Acquire : public AsyncOp {
+      std::shared_ptr<PqAsyncConnectionPool> _pool;
+      PqAsyncConnection::PtrType _connection;
+      std::exception_ptr _error;
+      std::function<void()> _done;
+
+      friend class PqAsyncConnectionPool;
+
+    public:
+      explicit Acquire(std::shared_ptr<PqAsyncConnectionPool> pool) : _pool(pool) {}
+
+      // Grabs a connection without waiting if one's available
+      bool ready() {
+        try {
+          _connection = _pool->tryTake();
+        } catch (...) {
+          _error = std::current_exception();
+          return true;
+        }
+        return static_cast<bool>(_connection);
+      }
+
+      void start(std::function<void()> done) override {
+        _done = std::move(done);
+        _pool->wait(this);
+      }
+
+      void cancel() override {
+        _pool->abandon(this);
+      }
+
+      PqAsyncLease result() {
+        if (_error) {
+          std::rethrow_exception(_error);
+        }
+        return PqAsyncLease(_pool, std::move(_connection));
+      }
+    };
+
+  private:
+    std::string _connectionString;
+    size_t _maxConnections;
+    std::mutex _mutex;
+    std::vector<PqAsyncConnection::PtrType> _idle;
+    // Acquires waiting for a connection, oldest first. They're kept
+    // alive by the coroutine frame that's waiting on them.
+    std::deque<Acquire*> _waiting;
+    size_t _open = 0;
+
+    // A connection if one's idle or we're allowed to open another
+    PqAsyncConnection::PtrType tryTake() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (!_idle.empty()) {
+        auto connection = std::move(_idle.back());
+        _idle.pop_back();
+        if (connection->ok()) {
+          return connection;
+        }
+        --_open;
+      }
+      if (_open < _maxConnections) {
+        ++_open;
+        lock.unlock();
+        try {
+          return std::make_unique<PqAsyncConnection>(_connectionString);
+        } catch (...) {
+          lock.lock();
+          --_open;
+          throw;
+        }
+      }
+      return nullptr;
+    }
+
+    void wait(Acquire* acquire) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Something might have come back between ready and now
+        if (_idle.empty() && _open >= _maxConnections) {
+          _waiting.push_back(acquire);
+          return;
+        }
+      }
+      try {
+        acquire->_connection = tryTake();
+      } catch (...) {
+        acquire->_error = std::current_exception();
+      }
+      if (acquire->_connection || acquire->_error) {
+        auto done = std::move(acquire->_done);
+        done();
+      } else {
+        wait(acquire);
+      }
+    }
+
+    // Stop waiting on a connection if acquire's still in line
+    void abandon(Acquire* acquire) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = std::find(_waiting.begin(), _waiting.end(), acquire);
+        if (found == _waiting.end()) {
+          // Already got one, or it's about to
+          return;
+        }
+        _waiting.erase(found);
+      }
+      acquire->_error = std::make_exception_ptr(TaskCancelled("Cancelled waiting for a database connection"));
+      auto done = std::move(acquire->_done);
+      done();
+    }
+
+    friend class PqAsyncLease;
+
+    void release(PqAsyncConnection::PtrType connection) {
+      Acquire* waiter = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        bool usable = connection->ok() && _open <= _maxConnections;
+        if (!_waiting.empty() && usable) {
+          waiter = _waiting.front();
+          _waiting.pop_front();
+          waiter->_connection = std::move(connection);
+        } else if (usable) {
+          _idle.push_back(std::move(connection));
+        } else {
+          --_open;
+          if (!_waiting.empty() && _open < _maxConnections) {
+            // There's room to open a replacement for the first waiter
+            waiter = _waiting.front();
+            _waiting.pop_front();
+          }
+        }
+      }
+      if (waiter) {
+        if (!waiter->_connection) {
+          try {
+            waiter->_connection = tryTake();
+          } catch (...) {
+            waiter->_error = std::current_exception();
+          }
+          if (!waiter->_connection && !waiter->_error) {
+            wait(waiter);
+            return;
+          }
+        }
+        auto done = std::move(waiter->_done);
+        done();
+      }
+    }
+
+  public:
+
+    PqAsyncConnectionPool(size_t maxConnections = defaultSize(),
+                          const std::string& connectionString = "") :
+      _connectionString(connectionString),
+      _maxConnections(std::max<size_t>(maxConnections, 1)) {
+    }
+
+    // Default pool size. Each connection is one query in flight.
+    static size_t defaultSize() {
+      return 32;
+    }
+
+    // The pool the coroutine tasks use if you don't hand them one
+    static PtrType getDefault() {
+      std::lock_guard<std::mutex> lock(defaultMutex());
+      auto& pool = defaultPool();
+      if (!pool) {
+        pool = std::make_shared<PqAsyncConnectionPool>();
+      }
+      return pool;
+    }
+
+    static void setDefault(PtrType pool) {
+      std::lock_guard<std::mutex> lock(defaultMutex());
+      defaultPool() = pool;
+    }
+
+    AsyncAwaiter<Acquire> acquire() {
+      return {std::make_shared<Acquire>(shared_from_this())};
+    }
+
+    size_t maxConnections() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _maxConnections;
+    }
+
+    size_t size() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _open;
+    }
+
+    size_t idle() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _idle.size();
+    }
+
+  private:
+
+    static std::mutex& defaultMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+    static PtrType& defaultPool() {
+      static PtrType pool;
+      return pool;
+    }
+  };
+
+  inline void PqAsyncLease::reset() {
+    if (_pool && _connection) {
+      _pool->release(std::move(_connection));
+    }
+    _pool.reset();
+  }
+
+}
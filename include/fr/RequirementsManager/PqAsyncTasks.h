@@ -0,0 +1,286 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/AllNodeTypes.h>
+#include <fr/RequirementsManager/CoroutineTask.h>
+#include <fr/RequirementsManager/Node.h>
+#include <fr/RequirementsManager/PqAsync.h>
+#include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/types/Concepts.h>
+#include <fr/types/Typelist.h>
+#include <fteng/signals.hpp>
+#include <functional>
+#include <string>
+#include <unordered_set>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Coroutine version of PqNodeLoader. Loads the data for one node
+   * with the same prepared statement PqNodeLoader uses, but the
+   * worker thread is free to do other things while the query's in
+   * flight.
+   */
+
+  template <typename WorkerThreadType>
+  class PqAsyncNodeLoader : public CoroutineTask<WorkerThreadType> {
+    using NodeList = AllNodeTypes;
+    using Populate = std::function<void(const database::PqAsyncRow&)>;
+
+    std::shared_ptr<database::PqAsyncConnectionPool> _pool;
+    std::atomic<bool> _loadComplete;
+    std::atomic<bool> _found;
+    Node::PtrType _node;
+
+    // Find the node's type and hand back its load statement and
+    // something that'll populate the node from a row. Returns false
+    // for nodes that don't have a table.
+    template <typename List>
+    bool lookup(std::string& statement, Populate& populate)
+    requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using CurrentType = List::head::type;
+      auto cast = std::dynamic_pointer_cast<CurrentType>(_node);
+      if (cast) {
+        statement = database::Statements<CurrentType>::load();
+        populate = [cast](const database::PqAsyncRow& row) {
+          database::DbSpecificData<CurrentType> specific;
+          specific.populate(cast, row);
+        };
+        return true;
+      }
+      if constexpr (!std::is_void_v<typename List::tail::head::type>) {
+        return lookup<typename List::tail>(statement, populate);
+      }
+      return false;
+    }
+
+  protected:
+
+    TaskCoroutine body() override {
+      std::string statement;
+      Populate populate;
+      if (lookup<NodeList>(statement, populate)) {
+        auto connection = co_await _pool->acquire();
+        auto result = co_await database::exec(*connection, statement,
+                                              database::PqAsyncParams(_node->idString()));
+        connection.reset();
+        for (auto row : result) {
+          populate(row);
+          _found = true;
+        }
+      } else {
+        // Raw nodes don't have anything else to load, same as
+        // DbSpecificData<Node>::load
+        _found = true;
+      }
+      if (_found) {
+        _node->clearDirty();
+      }
+      _loadComplete = true;
+      loaded(_node->idString(), _node);
+    }
+
+  public:
+    using Type = PqAsyncNodeLoader<WorkerThreadType>;
+    using PtrType = std::shared_ptr<Type>;
+    using Parent = CoroutineTask<WorkerThreadType>;
+
+    fteng::signal<void(const std::string&, Node::PtrType)> loaded;
+
+    PqAsyncNodeLoader(Node::PtrType toLoad,
+                      std::shared_ptr<database::PqAsyncConnectionPool> pool = database::PqAsyncConnectionPool::getDefault()) :
+      _pool(pool),
+      _loadComplete(false),
+      _found(false),
+      _node(toLoad) {
+    }
+
+    virtual ~PqAsyncNodeLoader() {}
+
+    std::string getNodeType() const override {
+      return "PqAsyncNodeLoader";
+    }
+
+    bool complete() const {
+      return _loadComplete;
+    }
+
+    bool found() const {
+      return _found;
+    }
+
+    Node::PtrType getNode() const {
+      return _node;
+    }
+  };
+
+  /**
+   * Saves one node with a coroutine. It always does a full upsert
+   * (the same statement SaveNodesNode's PerNode mode uses for new
+   * nodes), which writes the node row, its associations and its type
+   * table row in one statement, so there's no transaction to hold
+   * open across suspensions.
+   */
+
+  template <typename WorkerThreadType>
+  class PqAsyncNodeSaver : public CoroutineTask<WorkerThreadType> {
+    using NodeList = AllNodeTypes;
+
+    std::shared_ptr<database::PqAsyncConnectionPool> _pool;
+    std::atomic<bool> _saveComplete;
+    Node::PtrType _node;
+
+    template <typename List>
+    void lookup(std::string& statement, database::PqAsyncParams& params)
+    requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using CurrentType = List::head::type;
+      auto cast = std::dynamic_pointer_cast<CurrentType>(_node);
+      if (cast) {
+        database::DbSpecificData<CurrentType> specific;
+        std::apply([&params](auto&&... values) {
+          (params.append(values), ...);
+        }, specific.row(cast));
+        database::DbSpecificData<Node>::appendNodeParams(_node, params);
+        statement = database::Statements<CurrentType>::upsert();
+        return;
+      }
+      if constexpr (!std::is_void_v<typename List::tail::head::type>) {
+        lookup<typename List::tail>(statement, params);
+      } else {
+        // Raw node
+        params.append(_node->idString());
+        database::DbSpecificData<Node>::appendNodeParams(_node, params);
+        statement = database::Statements<Node>::upsert();
+      }
+    }
+
+  protected:
+
+    TaskCoroutine body() override {
+      std::string statement;
+      database::PqAsyncParams params;
+      lookup<NodeList>(statement, params);
+      {
+        auto connection = co_await _pool->acquire();
+        co_await database::exec(*connection, statement, std::move(params));
+      }
+      _node->clearDirty();
+      _saveComplete = true;
+      saved(_node->idString(), _node);
+    }
+
+  public:
+    using Type = PqAsyncNodeSaver<WorkerThreadType>;
+    using PtrType = std::shared_ptr<Type>;
+    using Parent = CoroutineTask<WorkerThreadType>;
+
+    fteng::signal<void(const std::string&, Node::PtrType)> saved;
+
+    PqAsyncNodeSaver(Node::PtrType toSave,
+                     std::shared_ptr<database::PqAsyncConnectionPool> pool = database::PqAsyncConnectionPool::getDefault()) :
+      _pool(pool),
+      _saveComplete(false),
+      _node(toSave) {
+    }
+
+    virtual ~PqAsyncNodeSaver() {}
+
+    std::string getNodeType() const override {
+      return "PqAsyncNodeSaver";
+    }
+
+    bool saveComplete() const {
+      return _saveComplete;
+    }
+  };
+
+  /**
+   * Coroutine version of SaveNodesNode. It walks the graph and
+   * enqueues a PqAsyncNodeSaver for every changed node, so the whole
+   * graph can be in flight at once, limited by the size of the
+   * PqAsyncConnectionPool rather than the number of worker threads.
+   * Its TaskHandle is done once every one of those has finished.
+   *
+   * Run outside a threadpool it saves the nodes one at a time.
+   */
+
+  template <typename WorkerThreadType>
+  class PqAsyncSaveNodesNode : public TaskNode<WorkerThreadType> {
+    std::shared_ptr<database::PqAsyncConnectionPool> _pool;
+    Node::PtrType _startingNode;
+    std::atomic<size_t> _saved;
+
+  public:
+    using Type = PqAsyncSaveNodesNode<WorkerThreadType>;
+    using PtrType = std::shared_ptr<Type>;
+    using Parent = TaskNode<WorkerThreadType>;
+
+    fteng::signal<void(const std::string&, Node::PtrType)> complete;
+
+    PqAsyncSaveNodesNode(Node::PtrType startingNode,
+                         std::shared_ptr<database::PqAsyncConnectionPool> pool = database::PqAsyncConnectionPool::getDefault()) :
+      _pool(pool),
+      _startingNode(startingNode),
+      _saved(0) {
+    }
+
+    virtual ~PqAsyncSaveNodesNode() {}
+
+    std::string getNodeType() const override {
+      return "PqAsyncSaveNodesNode";
+    }
+
+    void run() override {
+      if (!_startingNode) {
+        return;
+      }
+      auto owner = this->getOwner();
+      _startingNode->traverse([this, &owner](Node::PtrType node) {
+        if (!node || !node->changed) {
+          return;
+        }
+        auto saver = std::make_shared<PqAsyncNodeSaver<WorkerThreadType>>(node, _pool);
+        saver->setPriority(this->getPriority());
+        saver->saved.connect([this](const std::string& id, Node::PtrType n) {
+          ++_saved;
+          this->complete(id, n);
+        });
+        this->recordChild(saver);
+        if (owner) {
+          owner->enqueue(saver);
+        } else {
+          saver->run();
+        }
+      });
+    }
+
+    // Number of nodes saved so far
+    size_t saved() const {
+      return _saved;
+    }
+  };
+
+}
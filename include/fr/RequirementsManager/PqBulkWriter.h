@@ -0,0 +1,218 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <format>
+#include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/AllNodeTypes.h>
+#include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/RequirementsManager/Node.h>
+#include <fr/types/Concepts.h>
+#include <fr/types/Typelist.h>
+#include <pqxx/pqxx>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fr::RequirementsManager::database {
+
+  /**
+   * PqBulkWriter writes a whole batch of nodes in one transaction
+   * using a handful of statements, no matter how many nodes are
+   * in the batch.
+   *
+   * For every table involved (node plus one table per node type)
+   * it creates a temporary staging table shaped like the real one,
+   * COPYs the rows into it with pqxx::stream_to and then moves them
+   * over with a single INSERT ... SELECT ... ON CONFLICT (id) DO
+   * UPDATE. Associations for the whole batch are COPYed into a
+   * staging table as well and reconciled with node_associations (or
+   * node_edges, depending on edgeStorage) in two statements.
+   *
+   * Staging tables are ON COMMIT DROP, so they go away with the
+   * transaction whether it commits or not. The writer never commits
+   * for you.
+   *
+   * Types are matched by getNodeType against DbSpecificData<T>::name,
+   * recursing through AllNodeTypes the same way PqBatchNodeLoader
+   * does. Nodes that aren't one of those types only get their node
+   * row and associations written.
+   */
+
+  class PqBulkWriter {
+    using NodeList = AllNodeTypes;
+
+    std::vector<Node::PtrType> _nodes;
+    std::unordered_set<std::string> _ids;
+    std::unordered_map<std::string, std::vector<Node::PtrType>> _byType;
+
+    template <typename NodeType>
+    static std::string stagingTable() {
+      return std::format("staging_{}", DbSpecificData<NodeType>::tableName);
+    }
+
+    // Create a staging table for NodeType, COPY rows into it and
+    // upsert them into the real table.
+    template <typename NodeType>
+    void writeTable(const std::vector<Node::PtrType>& nodes, pqxx::work& transaction) {
+      using Specific = DbSpecificData<NodeType>;
+      std::string staging = stagingTable<NodeType>();
+      transaction.exec(std::format("CREATE TEMP TABLE {} (LIKE {}) ON COMMIT DROP",
+                                   staging, Specific::tableName));
+      std::string columns = columnList<NodeType>();
+      {
+        // Table and column names all come from DbSpecificData, so
+        // they don't need quoting
+        auto stream = pqxx::stream_to::raw_table(transaction, staging, columns);
+        Specific specific;
+        for (auto& node : nodes) {
+          auto cast = std::dynamic_pointer_cast<NodeType>(node);
+          if (cast) {
+            std::apply([&stream](auto&&... values) {
+              stream.write_values(values...);
+            }, specific.row(cast));
+          }
+        }
+        stream.complete();
+      }
+      std::string cmd = std::format("INSERT INTO {} ({}) SELECT {} FROM {} ON CONFLICT (id) DO UPDATE SET {}",
+                                    Specific::tableName, columns, columns, staging,
+                                    conflictUpdateList<NodeType>());
+      transaction.exec(cmd);
+    }
+
+    template <typename List>
+    void writeTypes(pqxx::work& transaction)
+    requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using CurrentType = List::head::type;
+      auto found = _byType.find(DbSpecificData<CurrentType>::name);
+      if (found != _byType.end()) {
+        writeTable<CurrentType>(found->second, transaction);
+      }
+      if constexpr (!std::is_void_v<typename List::tail::head::type>) {
+        writeTypes<typename List::tail>(transaction);
+      }
+    }
+
+    // Associations are staged too. Anything a node in the batch
+    // doesn't have any more is deleted and anything new is added;
+    // the ones that didn't change are left alone.
+    void writeAssociations(pqxx::work& transaction) {
+      if (edgeStorage() == EdgeStorage::Normalized) {
+        writeEdges(transaction);
+        return;
+      }
+      transaction.exec("CREATE TEMP TABLE staging_node_associations (LIKE node_associations) ON COMMIT DROP");
+      {
+        auto stream = pqxx::stream_to::raw_table(transaction, "staging_node_associations", "id, association, type");
+        for (auto& node : _nodes) {
+          for (auto& upNode : node->up) {
+            stream.write_values(node->idString(), upNode->idString(), "up");
+          }
+          for (auto& downNode : node->down) {
+            stream.write_values(node->idString(), downNode->idString(), "down");
+          }
+        }
+        stream.complete();
+      }
+      transaction.exec("DELETE FROM node_associations na USING staging_node s "
+                       "WHERE na.id = s.id AND NOT EXISTS ("
+                       "SELECT 1 FROM staging_node_associations x WHERE x.id = na.id "
+                       "AND x.association = na.association AND x.type = na.type)");
+      transaction.exec("INSERT INTO node_associations (id, association, type) "
+                       "SELECT DISTINCT id, association, type FROM staging_node_associations "
+                       "ON CONFLICT DO NOTHING");
+    }
+
+    // Same thing for EdgeStorage::Normalized. Each node in the batch
+    // owns the edges to its children. Edges from its parents are
+    // staged too, but only so they get added if they're missing.
+    void writeEdges(pqxx::work& transaction) {
+      transaction.exec("CREATE TEMP TABLE staging_node_edges (LIKE node_edges) ON COMMIT DROP");
+      {
+        auto stream = pqxx::stream_to::raw_table(transaction, "staging_node_edges", "parent, child");
+        for (auto& node : _nodes) {
+          for (auto& downNode : node->down) {
+            stream.write_values(node->idString(), downNode->idString());
+          }
+          for (auto& upNode : node->up) {
+            // The parent will write this one itself if it's in the batch
+            if (!_ids.contains(upNode->idString())) {
+              stream.write_values(upNode->idString(), node->idString());
+            }
+          }
+        }
+        stream.complete();
+      }
+      transaction.exec("DELETE FROM node_edges e USING staging_node s "
+                       "WHERE e.parent = s.id AND NOT EXISTS ("
+                       "SELECT 1 FROM staging_node_edges x "
+                       "WHERE x.parent = e.parent AND x.child = e.child)");
+      transaction.exec("INSERT INTO node_edges (parent, child) "
+                       "SELECT DISTINCT parent, child FROM staging_node_edges "
+                       "ON CONFLICT DO NOTHING");
+    }
+
+  public:
+    using Type = PqBulkWriter;
+
+    PqBulkWriter() = default;
+    ~PqBulkWriter() = default;
+
+    // Add a node to the batch. Adding the same node twice is harmless.
+    void add(Node::PtrType node) {
+      if (!node || _ids.contains(node->idString())) {
+        return;
+      }
+      _ids.insert(node->idString());
+      _nodes.push_back(node);
+      _byType[node->getNodeType()].push_back(node);
+    }
+
+    const std::vector<Node::PtrType>& nodes() const {
+      return _nodes;
+    }
+
+    size_t size() const {
+      return _nodes.size();
+    }
+
+    bool empty() const {
+      return _nodes.empty();
+    }
+
+    /**
+     * Write everything in the batch. The node table goes first so
+     * anything that refers to it finds its row there. Call commit
+     * on the transaction when this returns.
+     */
+    void write(pqxx::work& transaction) {
+      if (_nodes.empty()) {
+        return;
+      }
+      writeTable<Node>(_nodes, transaction);
+      writeAssociations(transaction);
+      writeTypes<NodeList>(transaction);
+    }
+  };
+
+}
@@ -0,0 +1,441 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pqxx/pqxx>
+#include <fr/RequirementsManager/CancellationToken.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace fr::RequirementsManager::database {
+
+  class PooledConnection;
+
+  /**
+   * A bounded pool of PostgreSQL connections.
+   *
+   * Database tasks used to open their own pqxx::connection in their
+   * constructors, which meant a TCP connect and an authentication
+   * handshake for every node we loaded or saved. Now they borrow a
+   * connection from one of these for the duration of their run method
+   * and hand it back when they're done.
+   *
+   * Connections are opened lazily up to maxConnections. If every
+   * connection is borrowed, acquire blocks until one comes back (or
+   * until the timeout you gave it expires.) Connections that have
+   * been sitting idle longer than the health check interval get a
+   * quick "SELECT 1" before they're handed out, and any connection
+   * that turns out to be broken is thrown away and replaced.
+   *
+   * Each connection also remembers which prepared statements have
+   * been prepared on it, so you can call PooledConnection::prepare
+   * every time you borrow one without paying for a round trip after
+   * the first time.
+   *
+   * The connection string is handed straight to pqxx. Leaving it
+   * empty uses the usual PG* environment variables, which is what
+   * everything in this project did before the pool existed.
+   */
+
+  class PqConnectionPool : public std::enable_shared_from_this<PqConnectionPool> {
+  public:
+    using Type = PqConnectionPool;
+    using PtrType = std::shared_ptr<Type>;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * One pooled connection and the bookkeeping that goes along
+     * with it. This only lives in the pool or in a PooledConnection.
+     */
+    struct Entry {
+      std::unique_ptr<pqxx::connection> connection;
+      // Names of statements already prepared on this connection
+      std::unordered_set<std::string> prepared;
+      // Last time this connection was returned to the pool
+      Clock::time_point lastUsed;
+    };
+
+  private:
+    std::string _connectionString;
+    size_t _maxConnections;
+    std::chrono::milliseconds _healthCheckInterval;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _available;
+    // Connections that are open and not currently borrowed
+    std::vector<std::unique_ptr<Entry>> _idle;
+    // Number of open connections, borrowed or idle
+    size_t _open;
+
+    std::unique_ptr<Entry> connect() {
+      auto entry = std::make_unique<Entry>();
+      if (_connectionString.empty()) {
+        entry->connection = std::make_unique<pqxx::connection>();
+      } else {
+        entry->connection = std::make_unique<pqxx::connection>(_connectionString);
+      }
+      entry->lastUsed = Clock::now();
+      return entry;
+    }
+
+    // Returns true if the connection looks usable. Only pings it
+    // if it's been idle for longer than the health check interval.
+    bool healthy(Entry& entry, std::chrono::milliseconds interval) {
+      if (!entry.connection || !entry.connection->is_open()) {
+        return false;
+      }
+      if (Clock::now() - entry.lastUsed < interval) {
+        return true;
+      }
+      try {
+        pqxx::nontransaction ping(*entry.connection);
+        ping.exec("SELECT 1");
+      } catch (const std::exception&) {
+        return false;
+      }
+      return true;
+    }
+
+    // Called by PooledConnection when it goes out of scope
+    void release(std::unique_ptr<Entry> entry) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (entry->connection && entry->connection->is_open() && _open <= _maxConnections) {
+          entry->lastUsed = Clock::now();
+          _idle.push_back(std::move(entry));
+        } else {
+          // Broken, or the pool was shrunk while this was out
+          --_open;
+        }
+      }
+      _available.notify_one();
+    }
+
+    friend class PooledConnection;
+
+    // Does the actual work for both acquire overloads. Returns an
+    // empty entry if we timed out.
+    std::unique_ptr<Entry> take(const Clock::time_point* deadline);
+
+  public:
+
+    PqConnectionPool(size_t maxConnections = defaultSize(),
+                     const std::string& connectionString = "") :
+      _connectionString(connectionString),
+      _maxConnections(std::max<size_t>(maxConnections, 1)),
+      _healthCheckInterval(std::chrono::seconds(30)),
+      _open(0) {
+    }
+
+    ~PqConnectionPool() = default;
+
+    // Default pool size -- one per hardware thread, but never fewer than 4
+    static size_t defaultSize() {
+      return std::max<size_t>(4, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * The pool the database tasks use if you don't hand them one.
+     * It's created on first use with defaultSize connections.
+     */
+    static PtrType getDefault() {
+      std::lock_guard<std::mutex> lock(defaultMutex());
+      auto& pool = defaultPool();
+      if (!pool) {
+        pool = std::make_shared<PqConnectionPool>();
+      }
+      return pool;
+    }
+
+    // Replace the default pool. Tasks that already have a pool keep it.
+    static void setDefault(PtrType pool) {
+      std::lock_guard<std::mutex> lock(defaultMutex());
+      defaultPool() = pool;
+    }
+
+    /**
+     * Borrow a connection, blocking until one is available.
+     */
+    PooledConnection acquire();
+
+    /**
+     * Borrow a connection, waiting at most timeout for one to
+     * become available. Throws std::runtime_error if it times out.
+     */
+    PooledConnection acquire(std::chrono::milliseconds timeout);
+
+    /**
+     * Ping every idle connection and discard any that don't
+     * answer. acquire does this for you on a per-connection
+     * basis, but you can call it periodically if you want to
+     * find out about database trouble before a request does.
+     * Returns the number of connections that were discarded.
+     */
+    size_t healthCheck() {
+      std::vector<std::unique_ptr<Entry>> checking;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        checking.swap(_idle);
+      }
+      size_t discarded = 0;
+      std::vector<std::unique_ptr<Entry>> good;
+      for (auto& entry : checking) {
+        bool ok = false;
+        try {
+          if (entry->connection->is_open()) {
+            pqxx::nontransaction ping(*entry->connection);
+            ping.exec("SELECT 1");
+            ok = true;
+          }
+        } catch (const std::exception&) {
+          ok = false;
+        }
+        if (ok) {
+          entry->lastUsed = Clock::now();
+          good.push_back(std::move(entry));
+        } else {
+          ++discarded;
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _open -= discarded;
+        for (auto& entry : good) {
+          _idle.push_back(std::move(entry));
+        }
+      }
+      _available.notify_all();
+      return discarded;
+    }
+
+    // Maximum number of connections this pool will open
+    size_t maxConnections() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _maxConnections;
+    }
+
+    /**
+     * Resize the pool. Growing takes effect immediately. Shrinking
+     * closes idle connections right away and closes borrowed ones
+     * as they're returned.
+     */
+    void setMaxConnections(size_t maxConnections) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maxConnections = std::max<size_t>(maxConnections, 1);
+        while (_open > _maxConnections && !_idle.empty()) {
+          _idle.pop_back();
+          --_open;
+        }
+      }
+      _available.notify_all();
+    }
+
+    // Connections that have sat idle longer than this get pinged before use
+    void setHealthCheckInterval(std::chrono::milliseconds interval) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _healthCheckInterval = interval;
+    }
+
+    // Number of open connections (borrowed plus idle)
+    size_t size() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _open;
+    }
+
+    // Number of open connections nobody is using right now
+    size_t idle() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _idle.size();
+    }
+
+    // Number of connections currently borrowed
+    size_t inUse() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _open - _idle.size();
+    }
+
+  private:
+
+    static std::mutex& defaultMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+    static PtrType& defaultPool() {
+      static PtrType pool;
+      return pool;
+    }
+  };
+
+  /**
+   * A connection borrowed from a PqConnectionPool. It goes back to
+   * the pool when this object is destroyed, so create your
+   * pqxx::work *after* this and let it go out of scope first.
+   *
+   * This holds a shared pointer to the pool, so the pool will stay
+   * around at least as long as any of its connections are out.
+   */
+
+  class PooledConnection {
+    std::shared_ptr<PqConnectionPool> _pool;
+    std::unique_ptr<PqConnectionPool::Entry> _entry;
+
+  public:
+    PooledConnection(std::shared_ptr<PqConnectionPool> pool,
+                     std::unique_ptr<PqConnectionPool::Entry> entry) :
+      _pool(pool),
+      _entry(std::move(entry)) {
+    }
+
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+    PooledConnection(PooledConnection&&) = default;
+
+    PooledConnection& operator=(PooledConnection&& other) {
+      if (this != &other) {
+        reset();
+        _pool = std::move(other._pool);
+        _entry = std::move(other._entry);
+      }
+      return *this;
+    }
+
+    ~PooledConnection() {
+      reset();
+    }
+
+    // Give the connection back early
+    void reset() {
+      if (_pool && _entry) {
+        _pool->release(std::move(_entry));
+      }
+      _pool.reset();
+    }
+
+    pqxx::connection& get() {
+      return *_entry->connection;
+    }
+
+    pqxx::connection& operator*() {
+      return get();
+    }
+
+    pqxx::connection* operator->() {
+      return _entry->connection.get();
+    }
+
+    // True if statement name has been prepared on this connection
+    bool isPrepared(const std::string& name) const {
+      return _entry->prepared.contains(name);
+    }
+
+    /**
+     * Prepare sql as name on this connection unless that's
+     * already been done. Safe to call every time you borrow
+     * the connection.
+     */
+    void prepare(const std::string& name, const std::string& sql) {
+      if (!_entry->prepared.contains(name)) {
+        _entry->connection->prepare(name, sql);
+        _entry->prepared.insert(name);
+      }
+    }
+
+    /**
+     * Ask the server to cancel whatever's running on this connection
+     * if token is cancelled while the CancelCallback you get back is
+     * around. Keep it in a scope that ends before the connection goes
+     * back to the pool. The query that was running throws, which the
+     * thread pool turns into TaskCancelled.
+     */
+    CancelCallback cancelOn(const CancellationToken& token) {
+      auto connection = _entry->connection.get();
+      return token.onCancel([connection]() {
+        try {
+          connection->cancel_query();
+        } catch (...) {
+          // Not much we can do about it. The query will just run
+          // to the end.
+        }
+      });
+    }
+  };
+
+  inline std::unique_ptr<PqConnectionPool::Entry> PqConnectionPool::take(const Clock::time_point* deadline) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      if (!_idle.empty()) {
+        auto entry = std::move(_idle.back());
+        _idle.pop_back();
+        auto interval = _healthCheckInterval;
+        // Check health outside the lock, we might need a round trip
+        lock.unlock();
+        if (healthy(*entry, interval)) {
+          return entry;
+        }
+        lock.lock();
+        --_open;
+        continue;
+      }
+      if (_open < _maxConnections) {
+        ++_open;
+        lock.unlock();
+        try {
+          return connect();
+        } catch (...) {
+          lock.lock();
+          --_open;
+          lock.unlock();
+          _available.notify_one();
+          throw;
+        }
+      }
+      if (deadline) {
+        if (_available.wait_until(lock, *deadline) == std::cv_status::timeout &&
+            _idle.empty() && _open >= _maxConnections) {
+          return {};
+        }
+      } else {
+        _available.wait(lock);
+      }
+    }
+  }
+
+  inline PooledConnection PqConnectionPool::acquire() {
+    return PooledConnection(shared_from_this(), take(nullptr));
+  }
+
+  inline PooledConnection PqConnectionPool::acquire(std::chrono::milliseconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    auto entry = take(&deadline);
+    if (!entry) {
+      throw std::runtime_error("Timed out waiting for a database connection");
+    }
+    return PooledConnection(shared_from_this(), std::move(entry));
+  }
+
+}
@@ -20,8 +20,11 @@
 #include <fr/RequirementsManager/AllNodeTypes.h>
 #include <format>
 #include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
 #include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/RequirementsManager/PqStatements.h>
 #include <fr/RequirementsManager/Node.h>
+#include <fr/RequirementsManager/PqBulkWriter.h>
 #include <fr/RequirementsManager/TaskNode.h>
 #include <fr/RequirementsManager/ThreadPool.h>
 #include <fr/types/Concepts.h>
@@ -35,6 +38,22 @@
 
 namespace fr::RequirementsManager {
 
+  /**
+   * How SaveNodesNode writes a graph.
+   *
+   * PerNode creates a SaveNodesNode for every changed node and
+   * enqueues them all, so each node gets its own connection and
+   * transaction. Bulk collects every changed node in the graph and
+   * writes them all in one transaction with PqBulkWriter. Bulk is
+   * the default. Saving a single node (saveThisNodeOnly) always
+   * works the PerNode way.
+   */
+
+  enum class SaveMode {
+    PerNode,
+    Bulk
+  };
+
   /**
    * This is a node that can be used to save nodes
    * into the database. Submit it to a thread pool
@@ -54,10 +73,9 @@ namespace fr::RequirementsManager {
     // here.
     using SpecificSaveableTypes = AllNodeTypes;
 
-    // Set connection parameters up to connect to the database
-    // from outside the application
-    pqxx::connection _connection;
-    pqxx::work _transaction;
+    // Connections are borrowed from here while run is running.
+    // Child savers share it.
+    std::shared_ptr<database::PqConnectionPool> _pool;
         
     /**
      * Indicates that this node has exited its
@@ -80,13 +98,6 @@ namespace fr::RequirementsManager {
      */
     bool _saveThisNodeOnly;
     
-    /**
-     * As we traverse the graph we'll stash the saved node and its
-     * UUID here. That way if we encounter the node elsewhere,
-     * we won't try to traverse it again.
-     */
-    std::unordered_map<std::string, Node::PtrType> _alreadySaved;
-
     /**
      * Starting node -- Save this node and any other associated
      * nodes in its up/down lists if _saveThisNodeOnly is false.
@@ -94,13 +105,15 @@ namespace fr::RequirementsManager {
 
     Node::PtrType _startingNode;
 
+    SaveMode _mode;
+
     /**
      * Try to save specific data in a node shared ptr using the
      * SpecificSaveableTypes list I defined above. This will
      * generate all possible iterations of this list at compile
      * time and just go through the list trying to cast the node
      * to the current type we're examining. If it succeeds it will
-     * return, otherwise it'll try the next type in the list until
+     * return true, otherwise it'll try the next type in the list until
      * it runs out of types. Since I define getNodeType() in all
      * my nodes, I do have the ability to short circuit this based
      * on node type if I need to. I might want to do that if I'm
@@ -109,7 +122,7 @@ namespace fr::RequirementsManager {
      */
     
     template <typename List>
-    constexpr void saveSpecificData(Node::PtrType node)
+    constexpr bool saveSpecificData(Node::PtrType node, pqxx::work& transaction)
       requires
       (fr::types::IsTypelist<List> &&
        fr::types::IsUnique<List>)
@@ -121,89 +134,149 @@ namespace fr::RequirementsManager {
       std::shared_ptr<currentType> tryPtr = std::dynamic_pointer_cast<currentType>(node);
       if (tryPtr) {
         database::DbSpecificData<currentType> specificSaver;
-        if (!database::nodeInTable<currentType>(tryPtr, _transaction)) {
-          specificSaver.insert(tryPtr, _transaction);
-        } else {
-          specificSaver.update(tryPtr, _transaction);
-        }
+        specificSaver.upsert(tryPtr, transaction);
+        return true;
       } else {
         // Try next type if there is one
         if constexpr(!std::is_void_v<typename List::tail::head::type>) {
-          saveSpecificData<typename List::tail>(node);
+          return saveSpecificData<typename List::tail>(node, transaction);
         }
       }
+      return false;
     }
-    
+
     /**
-     * Returns true if the node is in the node table
+     * Same as saveSpecificData, but only writes the node's dirty
+     * fields and edge changes (see DbSpecificData<Node>::updateRow.)
+     * Returns false if the node isn't one of SpecificSaveableTypes
+     * or its row has gone missing from the database.
      */
-    bool nodeInDb(Node::PtrType node) {
-      bool ret = false;
-      std::string query("SELECT id FROM node WHERE id = $1");
-      pqxx::params p{
-        node->idString()
-      };
-      pqxx::result result = _transaction.exec(query, p);
-      ret = (result.size() > 0);
-      return ret;
+    template <typename List>
+    constexpr bool updateSpecificData(Node::PtrType node,
+                                      database::PooledConnection& connection,
+                                      pqxx::work& transaction)
+      requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using currentType = List::head::type;
+
+      std::shared_ptr<currentType> tryPtr = std::dynamic_pointer_cast<currentType>(node);
+      if (tryPtr) {
+        database::DbSpecificData<currentType> specificSaver;
+        return specificSaver.update(tryPtr, connection, transaction);
+      } else {
+        if constexpr(!std::is_void_v<typename List::tail::head::type>) {
+          return updateSpecificData<typename List::tail>(node, connection, transaction);
+        }
+      }
+      return false;
     }
 
-    // If the node exists we'll just clear out the existing node
-    // associations and rewrite them. This will probably be faster
-    // than iterating through the list in the database and only
-    // saving new ones.
-    void clearNodeDBAssociations(Node::PtrType node) {
-      std::string query = std::format("DELETE FROM node_associations WHERE id = '{}'", node->idString());
-      _transaction.exec(query);
+    /**
+     * Nodes that are already in the database and have recorded what
+     * changed about them can be saved by writing just that. Anything
+     * else -- new nodes, and nodes somebody set changed on by hand --
+     * gets written in full.
+     */
+    static bool incremental(const Node::PtrType& node) {
+      return node->persisted && (node->dirtyFields || !node->edgeChanges.empty());
+    }
+
+    // Write only what changed if we can, otherwise all of it
+    void dbUpdateNode(Node::PtrType node,
+                      database::PooledConnection& connection,
+                      pqxx::work& transaction) {
+      if (updateSpecificData<SpecificSaveableTypes>(node, connection, transaction)) {
+        return;
+      }
+      if (node->getNodeType() == "Node") {
+        database::DbSpecificData<Node> nodeSaver;
+        nodeSaver.update(node, connection, transaction);
+        return;
+      }
+      dbSaveNode(node, transaction);
     }
 
     /**
-     * entrypoint for saving to the database. This must determine if the node
-     * is already in the database and update it if it is. If the node is
-     * to be updated rather than saved, its relationships should be cleared
-     * from the database first and then re-saved, as node relationships
-     * could have been removed from the node.
+     * entrypoint for saving to the database. Every node type saves
+     * with a single INSERT ... ON CONFLICT (id) DO UPDATE that also
+     * writes the node row and rewrites its associations (see
+     * DbSpecificData<Node>::upsertRow), so we don't need to ask the
+     * database whether the node is already there first.
      *
      * dbSaveNode will not save nodes whose "changed" flag is false.
      * it will save node relationships but will not traverse into
      * other nodes (run does that part.)
      */
-    void dbSaveNode(Node::PtrType node) {
-      /**
-       * Since base nodes don't have any unique information,
-       * I don't have to do anything to the node table if
-       * the node is already in the table. I just rewrite the
-       * associations in case any of them changed.
-       */
-
-      if (nodeInDb(node)) {
-        clearNodeDBAssociations(node);
+    void dbSaveNode(Node::PtrType node, pqxx::work& transaction) {
+      if (!saveSpecificData<SpecificSaveableTypes>(node, transaction)) {
+        // Raw node, or something we don't have a table for
+        database::DbSpecificData<Node> nodeSaver;
+        nodeSaver.upsert(node, transaction);
       }
-      
-      // Save any node-specific data in the database
-      saveSpecificData<SpecificSaveableTypes>(node);
-      
     };
 
     /**
-     * Handle traversal, creation of SaveNodesNodes and enqueueing them
-     * into the threadpool. Each enqueued saveNodesNode will be
-     * set to save just that one node.
-     *
-     * TODO: Remove traverse and use Node::traverse instead.
+     * Gather every changed node reachable from _startingNode, following
+     * the same links Node::traverse does, and write them all in one
+     * transaction. New nodes go through PqBulkWriter; nodes that were
+     * loaded or saved before only get their changes written. The
+     * changed flags are only cleared once the transaction has
+     * committed.
+     */
+    void bulkSave() {
+      database::PqBulkWriter writer;
+      std::vector<Node::PtrType> updates;
+      _startingNode->walk(TraverseOptions(), [&](const Node::PtrType& node) {
+        if (incremental(node)) {
+          updates.push_back(node);
+        } else if (node->changed) {
+          writer.add(node);
+        }
+      });
+
+      if (!writer.empty() || !updates.empty()) {
+        // The writer doesn't use prepared statements, so only pay
+        // for preparing them if there are updates
+        auto connection = updates.empty() ? _pool->acquire() : database::PqStatements::acquire(_pool);
+        pqxx::work transaction(*connection);
+        writer.write(transaction);
+        for (auto& node : updates) {
+          dbUpdateNode(node, connection, transaction);
+        }
+        transaction.commit();
+      }
+
+      std::vector<Node::PtrType> saved(writer.nodes());
+      saved.insert(saved.end(), updates.begin(), updates.end());
+      for (auto& node : saved) {
+        node->clearDirty();
+      }
+      _saveComplete = true;
+      for (auto& node : saved) {
+        if (node != _startingNode) {
+          this->complete(node->idString(), node);
+        }
+      }
+      this->complete(_startingNode->idString(), _startingNode);
+    }
+
+    /**
+     * Create a SaveNodesNode to save just node and enqueue it in the
+     * threadpool, if node needs saving.
      */
 
-    void traverse(Node::PtrType node) {
+    void enqueueSave(Node::PtrType node) {
       auto owner = this->getOwner();
       if (!owner) {
         // This can happen if run is called directly rather
         // than from a threadpool object.
         std::cout << "WARNING: Owner is Null" << std::endl;
       }
-      // set up to save this node
-      _alreadySaved[node->idString()] = node;
       if (node->changed) {
-        auto saver = std::make_shared<SaveNodesNode<WorkerThreadType>>(node, true);
+        auto saver = std::make_shared<SaveNodesNode<WorkerThreadType>>(node, true, _pool, _mode);
+        saver->setPriority(this->getPriority());
 
         // Subscribe to saver complete signal and forward it back to the parent (this)
         // object.
@@ -211,45 +284,15 @@ namespace fr::RequirementsManager {
           this->complete(id, n);
         });
         
+        // Record this worker as work done in this object if we're
+        // keeping an audit trail. I don't actually *have* to do
+        // this, but it allows me to examine what this object did
+        // at a later date.
+        this->recordChild(saver);
         // Only enqueue work if we're in a thread pool
         if (owner) {
           owner->enqueue(saver);
         }
-        // Record this worker as work done in this object.
-        // I don't actually *have* to do this, but it allows me
-        // to examine what this object did at a later date.
-        this->down.push_back(saver);
-      }
-
-      for (auto upNode : node->up) {
-        if (!_alreadySaved.contains(upNode->idString())) {
-          _alreadySaved[upNode->idString()] = upNode;
-          traverse(upNode);
-        }
-      }
-
-      for (auto downNode : node->down) {
-        if (!_alreadySaved.contains(downNode->idString())) {
-          _alreadySaved[downNode->idString()] = downNode;
-          traverse(downNode);
-        }
-      }
-
-      // Check and see if this is a commitable node and if so
-      // save additional nodes associated with those
-
-      auto commitable = std::dynamic_pointer_cast<CommitableNode>(node);
-      if (commitable) {
-        auto parent = commitable->getChangeParent();
-        if (parent && !_alreadySaved.contains(parent->idString())) {
-          _alreadySaved[parent->idString()] = parent;;
-          traverse(parent);
-        }
-        auto child = commitable->getChangeChild();
-        if (child && !_alreadySaved.contains(child->idString())) {
-          _alreadySaved[child->idString()] = child;
-          traverse(child);
-        }
       }
     }
     
@@ -265,11 +308,14 @@ namespace fr::RequirementsManager {
     fteng::signal<void(const std::string&, Node::PtrType)> complete;
 
     SaveNodesNode(Node::PtrType startingNode,
-                  bool saveThisNodeOnly = false) :
-      _transaction(_connection),
+                  bool saveThisNodeOnly = false,
+                  std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault(),
+                  SaveMode mode = SaveMode::Bulk) :
+      _pool(pool),
       _saveComplete(false),
       _saveThisNodeOnly(saveThisNodeOnly),
-      _startingNode(startingNode) {
+      _startingNode(startingNode),
+      _mode(mode) {
     }
 
     virtual ~SaveNodesNode() = default;
@@ -283,34 +329,40 @@ namespace fr::RequirementsManager {
         this->init();
       }
 
-      if (_startingNode->changed) {
+      if (_mode == SaveMode::Bulk && !_saveThisNodeOnly) {
+        bulkSave();
+        return;
+      }
 
-        // Set the changed flag on the object to be saved to false.
-        // This isn't technically true until commit is called,
-        // but I want the object to be stored in the database in that
-        // state. At some point if it's worth doing, I'll code up
-        // a memento for this that I can roll back if we get an
-        // exception or error before commit is called.
-        _startingNode->changed = false;
-        
-        dbSaveNode(_startingNode);
-        _alreadySaved[_startingNode->idString()] = _startingNode;
+      if (_startingNode->changed) {
+        {
+          // Only hold on to a connection for as long as we're
+          // actually writing. The transaction has to go away
+          // before the connection goes back to the pool.
+          auto connection = database::PqStatements::acquire(_pool);
+          pqxx::work transaction(*connection);
+          if (incremental(_startingNode)) {
+            dbUpdateNode(_startingNode, connection, transaction);
+          } else {
+            dbSaveNode(_startingNode, transaction);
+          }
+          transaction.commit();
+        }
+        // Not dirty any more now that it's committed
+        _startingNode->clearDirty();
       }
 
       if (!_saveThisNodeOnly) {
         // Traverse the entire node tree and create and enqueue
         // individual SaveNodesNodes with _saveThisNodeOnly enabled
-        // if the node is not in the already saved list and the node
-        // is marked "changed"
-        for (auto node : _startingNode->up) {
-          traverse(node);
-        }
-        for (auto node : _startingNode->down) {
-          traverse(node);
-        }
+        // for every other node that's marked "changed"
+        _startingNode->walk(TraverseOptions(), [this](const Node::PtrType& node) {
+          if (node != _startingNode) {
+            enqueueSave(node);
+          }
+        });
       }
       
-      _transaction.commit();
       _saveComplete = true;
 
       this->complete(_startingNode->idString(), _startingNode);
@@ -320,9 +372,22 @@ namespace fr::RequirementsManager {
       return _saveComplete;
     }
 
+    SaveMode getSaveMode() const {
+      return _mode;
+    }
+
+    // Only takes effect if called before the saver runs
+    void setSaveMode(SaveMode mode) {
+      _mode = mode;
+    }
+
     // Indicates that all objects saved as part of this
-    // object have saved
+    // object have saved. If we went through a threadpool our
+    // handle knows, otherwise it's down to the audit trail.
     bool treeSaveComplete() {
+      if (this->getCompletion()) {
+        return this->handle().done();
+      }
       bool ret = _saveComplete;
       if (!_saveThisNodeOnly) {
         for (auto node : this->down) {
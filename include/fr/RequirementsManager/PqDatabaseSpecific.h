@@ -16,11 +16,23 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
 #include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
+#include <iomanip>
 #include <pqxx/pqxx>
 #include <format>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 /**
  * I'm storing structures here that can be queried to
@@ -35,10 +47,49 @@
  * The non-specialized thing isn't inherited
  * and doesn't inherit from anything else and that's
  * also fine.
+ *
+ * Each specialization's populate method copies one
+ * row from its table into a node. load uses it for
+ * a single node and PqBatchNodeLoader uses it for
+ * every row of a "WHERE id = ANY($1)" query. It takes
+ * any row type that looks enough like a pqxx::row, so
+ * the coroutine loaders can hand it rows that came
+ * straight from libpq (see PqAsync.h).
+ *
+ * They also list their table's columns in columns and
+ * return a node's values for those columns, in the same
+ * order, from row. The bulk saver in PqBulkWriter.h
+ * streams those tuples straight into COPY.
  */
 
 namespace fr::RequirementsManager::database {
 
+  /**
+   * The nodes keep dates as time_t but a few of the tables store
+   * them in TIMESTAMP columns. These convert between the two
+   * (in UTC) so we're not handing Postgres an integer where it
+   * wants a date.
+   */
+
+  inline std::string toTimestamp(time_t stamp) {
+    std::tm tm{};
+    gmtime_r(&stamp, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    return buffer;
+  }
+
+  template <typename Field>
+  time_t fromTimestamp(const Field& field) {
+    if (field.is_null()) {
+      return 0;
+    }
+    std::tm tm{};
+    std::istringstream in(field.template as<std::string>());
+    in >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return timegm(&tm);
+  }
+
   /**
    * This is the notfound type
    */
@@ -49,12 +100,12 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "NOTFOUND";
     static constexpr char tableName[] = "NOTFOUND";
 
-    void insert(Node::PtrType n, pqxx::work& transaction) {
-      throw std::logic_error("Attempted to insert an unknown node type (type not specialized in PqDatabaseSpecific.h)");
+    void upsert(Node::PtrType n, pqxx::work& transaction) {
+      throw std::logic_error("Attempted to save an unknown node type (type not specialized in PqDatabaseSpecific.h)");
     }
 
-    void update(Node::PtrType n, pqxx::work& transaction) {
-      throw std::logic_error("Attempted to update an unknown node type (type not specialized in PqDatabaseSpecific.h)");
+    bool update(Node::PtrType n, PooledConnection& connection, pqxx::work& transaction) {
+      throw std::logic_error("Attempted to save an unknown node type (type not specialized in PqDatabaseSpecific.h)");
     }
 
     /**
@@ -77,12 +128,467 @@ namespace fr::RequirementsManager::database {
     }
   };
 
+  /**
+   * Comma separated list of NodeType's columns, for building
+   * INSERT and SELECT statements out of columns.
+   */
+
+  template <typename NodeType>
+  std::string columnList() {
+    std::string ret;
+    for (auto column : DbSpecificData<NodeType>::columns) {
+      if (!ret.empty()) {
+        ret += ", ";
+      }
+      ret += column;
+    }
+    return ret;
+  }
+
+  /**
+   * The SET part of an ON CONFLICT (id) DO UPDATE for NodeType.
+   * Every column but id gets overwritten with the incoming value.
+   */
+
+  template <typename NodeType>
+  std::string conflictUpdateList() {
+    std::string ret;
+    for (auto column : DbSpecificData<NodeType>::columns) {
+      if (column == "id") {
+        continue;
+      }
+      if (!ret.empty()) {
+        ret += ", ";
+      }
+      ret += std::format("{} = EXCLUDED.{}", column, column);
+    }
+    return ret;
+  }
+
+  /**
+   * How edges are kept in the database.
+   *
+   * Mirrored is the original layout. Every node writes one
+   * node_associations row per entry in its up and down lists, so an
+   * edge between a parent and a child is stored (and deleted) twice,
+   * once from each end.
+   *
+   * Normalized keeps one row per edge in node_edges, keyed on
+   * (parent, child). A node owns the rows for its down list and only
+   * adds the rows for its up list if the parent hasn't already
+   * written them. Loads work out up and down from which end of the
+   * edge the node is on. CreateTables migration 3 creates node_edges
+   * and fills it from node_associations, so run that before
+   * switching over.
+   *
+   * The mode comes from the RM_EDGE_STORAGE environment variable
+   * ("mirrored" or "normalized") the first time anyone asks for it,
+   * and can be changed afterwards with setEdgeStorage. Statements
+   * for both modes are prepared on every connection, so changing it
+   * at runtime is safe as long as nobody's in the middle of a save.
+   */
+
+  enum class EdgeStorage { Mirrored, Normalized };
+
+  inline std::atomic<EdgeStorage>& edgeStorageSetting() {
+    static std::atomic<EdgeStorage> setting = [] {
+      const char* env = std::getenv("RM_EDGE_STORAGE");
+      if (env && std::string_view(env) == "normalized") {
+        return EdgeStorage::Normalized;
+      }
+      return EdgeStorage::Mirrored;
+    }();
+    return setting;
+  }
+
+  inline EdgeStorage edgeStorage() {
+    return edgeStorageSetting().load();
+  }
+
+  inline void setEdgeStorage(EdgeStorage storage) {
+    edgeStorageSetting().store(storage);
+  }
+
+  /**
+   * Prepared statement names and SQL. Every statement the node
+   * types run on a hot path is prepared once per connection under
+   * the name returned here (see PqStatements.h, which prepares them
+   * all when a database task first borrows a connection.) Callers
+   * pass the name to exec with pqxx::prepped, so Postgres doesn't
+   * parse and plan the SQL again and we don't format it again.
+   *
+   * Names are built from the type's tableName, so they're stable
+   * between runs and easy to find in pg_prepared_statements.
+   */
+
+  template <typename NodeType>
+  struct Statements;
+
+  /**
+   * Statements that belong to the node and node_associations tables
+   * rather than to any one node type.
+   */
+
+  template <>
+  struct Statements<Node> {
+
+    /**
+     * The node row and the node's associations, written with
+     * data-modifying CTEs so they can go out in the same statement
+     * as the type table's upsert. $1 is the node id. The node type,
+     * association ids and association types are $first, $first + 1
+     * and $first + 2.
+     *
+     * Sibling CTEs run in no particular order, so the DELETE and the
+     * INSERT must never touch the same rows. The DELETE only removes
+     * associations the node doesn't have any more. The INSERT skips
+     * the ones that are already there (that relies on the primary
+     * key CreateTables adds in migration 2).
+     */
+    static std::string nodeCtes(size_t first) {
+      return std::format(
+        "WITH upsert_node AS ("
+        "INSERT INTO node (id, node_type) VALUES ($1, ${}) "
+        "ON CONFLICT (id) DO UPDATE SET node_type = EXCLUDED.node_type), "
+        "current_associations AS ("
+        "SELECT DISTINCT association, type FROM unnest(${}::uuid[], ${}::association_type[]) "
+        "AS a(association, type)), "
+        "clear_associations AS ("
+        "DELETE FROM node_associations na WHERE na.id = $1 AND NOT EXISTS ("
+        "SELECT 1 FROM current_associations c "
+        "WHERE c.association = na.association AND c.type = na.type)), "
+        "write_associations AS ("
+        "INSERT INTO node_associations (id, association, type) "
+        "SELECT $1, association, type FROM current_associations "
+        "ON CONFLICT DO NOTHING) ",
+        first, first + 1, first + 2);
+    }
+
+    /**
+     * nodeCtes for EdgeStorage::Normalized. $first is the node type,
+     * $first + 1 the ids in the node's down list and $first + 2 the
+     * ids in its up list.
+     *
+     * The node owns the edges where it's the parent, so those are
+     * reconciled the same way nodeCtes does it. Edges where it's the
+     * child belong to the parent and are only added, never removed.
+     * If the parent is saved too (it usually is) those INSERTs are
+     * no-ops.
+     */
+    static std::string nodeEdgeCtes(size_t first) {
+      return std::format(
+        "WITH upsert_node AS ("
+        "INSERT INTO node (id, node_type) VALUES ($1, ${}) "
+        "ON CONFLICT (id) DO UPDATE SET node_type = EXCLUDED.node_type), "
+        "current_children AS ("
+        "SELECT DISTINCT child FROM unnest(${}::uuid[]) AS c(child)), "
+        "clear_children AS ("
+        "DELETE FROM node_edges e WHERE e.parent = $1 AND NOT EXISTS ("
+        "SELECT 1 FROM current_children c WHERE c.child = e.child)), "
+        "write_children AS ("
+        "INSERT INTO node_edges (parent, child) "
+        "SELECT $1, child FROM current_children ON CONFLICT DO NOTHING), "
+        "write_parents AS ("
+        "INSERT INTO node_edges (parent, child) "
+        "SELECT DISTINCT parent, $1 FROM unnest(${}::uuid[]) AS p(parent) "
+        "ON CONFLICT DO NOTHING) ",
+        first, first + 1, first + 2);
+    }
+
+    // Whichever of the above the current edgeStorage wants
+    static std::string nodeCtes(size_t first, EdgeStorage storage) {
+      return storage == EdgeStorage::Normalized ? nodeEdgeCtes(first) : nodeCtes(first);
+    }
+
+    // Suffix for the names of statements that differ by EdgeStorage
+    static std::string storageSuffix(EdgeStorage storage) {
+      return storage == EdgeStorage::Normalized ? "_normalized" : "";
+    }
+
+    // Raw nodes don't have a type table, so it's just the node
+    // row and its associations.
+    static const std::string& upsert() {
+      static const std::string mirrored("node_upsert");
+      static const std::string normalized("node_upsert_normalized");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    static const std::string& remove() {
+      static const std::string name("node_remove");
+      return name;
+    }
+
+    static const std::string& removeAssociations() {
+      static const std::string mirrored("node_remove_associations");
+      static const std::string normalized("node_remove_edges");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    /**
+     * Edges added to or removed from $1 since it was last saved
+     * (Node::edgeChanges.) $2 is the ids on the other end and $3
+     * says whether each one is up or down from $1. Both storage
+     * modes take the same parameters.
+     */
+    static const std::string& addEdges() {
+      static const std::string mirrored("node_associations_add");
+      static const std::string normalized("node_edges_add");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    static const std::string& removeEdges() {
+      static const std::string mirrored("node_associations_delete");
+      static const std::string normalized("node_edges_delete");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    // node_type for one id
+    static const std::string& nodeType() {
+      static const std::string name("node_type");
+      return name;
+    }
+
+    // Associations for one id, as (association, type) rows in
+    // either storage mode
+    static const std::string& associations() {
+      static const std::string mirrored("node_associations_load");
+      static const std::string normalized("node_edges_load");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    /**
+     * Every node reachable from $1 (see reachableCte) along with its
+     * type and its associations. The normalized version reports its
+     * edges as up and down rows too, so callers can't tell which
+     * storage mode they came out of.
+     */
+    static const std::string& skeleton() {
+      static const std::string mirrored("node_skeleton");
+      static const std::string normalized("node_skeleton_normalized");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    /**
+     * Every node reachable from the ids seed selects, following
+     * edges in both directions, as a CTE named reachable. UNION
+     * (rather than UNION ALL) is what keeps this from running
+     * forever on a cyclic graph.
+     *
+     * With normalized storage the recursive term can only mention
+     * reachable once, so both directions go in a LATERAL subquery
+     * on r.id. Both of its branches use the indexes on node_edges.
+     */
+    static std::string reachableCte(const std::string& seed, EdgeStorage storage) {
+      if (storage == EdgeStorage::Normalized) {
+        return std::format(
+          "WITH RECURSIVE reachable(id) AS ("
+          " SELECT {}"
+          " UNION"
+          " SELECT x.id FROM reachable r CROSS JOIN LATERAL ("
+          "  SELECT child FROM node_edges WHERE parent = r.id"
+          "  UNION ALL"
+          "  SELECT parent FROM node_edges WHERE child = r.id"
+          " ) AS x(id)"
+          ") ", seed);
+      }
+      return std::format(
+        "WITH RECURSIVE reachable(id) AS ("
+        " SELECT {}"
+        " UNION"
+        " SELECT na.association FROM node_associations na"
+        " JOIN reachable r ON na.id = r.id"
+        ") ", seed);
+    }
+
+    /**
+     * (id, node_type) for every node reachable from any of the ids
+     * in the array $1. RemoveNodesNode uses this to find everything
+     * it has to delete without loading the graph.
+     */
+    static const std::string& reachable() {
+      static const std::string mirrored("node_reachable");
+      static const std::string normalized("node_reachable_normalized");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    // node rows for every id in the array $1
+    static const std::string& removeBatch() {
+      static const std::string name("node_remove_batch");
+      return name;
+    }
+
+    // Edges touching any id in the array $1
+    static const std::string& removeAssociationsBatch() {
+      static const std::string mirrored("node_remove_associations_batch");
+      static const std::string normalized("node_remove_edges_batch");
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    // Edges touching $1, as (association, type) rows
+    static constexpr char edgeRows[] =
+      "SELECT child, 'down'::association_type FROM node_edges WHERE parent = $1 "
+      "UNION ALL "
+      "SELECT parent, 'up'::association_type FROM node_edges WHERE child = $1";
+
+    static std::vector<std::pair<std::string, std::string>> all() {
+      return {
+        {"node_upsert", nodeCtes(2) + "SELECT 1"},
+        {"node_upsert_normalized", nodeEdgeCtes(2) + "SELECT 1"},
+        {remove(), "DELETE FROM node WHERE id = $1"},
+        {"node_remove_associations", "DELETE FROM node_associations WHERE id = $1 OR association = $1"},
+        {"node_remove_edges", "DELETE FROM node_edges WHERE parent = $1 OR child = $1"},
+        {"node_associations_add",
+         "INSERT INTO node_associations (id, association, type) "
+         "SELECT $1, x.association, x.type "
+         "FROM unnest($2::uuid[], $3::association_type[]) AS x(association, type) "
+         "ON CONFLICT DO NOTHING"},
+        {"node_associations_delete",
+         "DELETE FROM node_associations na "
+         "USING unnest($2::uuid[], $3::association_type[]) AS x(association, type) "
+         "WHERE na.id = $1 AND na.association = x.association AND na.type = x.type"},
+        {"node_edges_add",
+         "INSERT INTO node_edges (parent, child) "
+         "SELECT CASE WHEN x.type = 'down' THEN $1::uuid ELSE x.association END, "
+         "CASE WHEN x.type = 'down' THEN x.association ELSE $1::uuid END "
+         "FROM unnest($2::uuid[], $3::association_type[]) AS x(association, type) "
+         "ON CONFLICT DO NOTHING"},
+        {"node_edges_delete",
+         "DELETE FROM node_edges e "
+         "USING unnest($2::uuid[], $3::association_type[]) AS x(association, type) "
+         "WHERE (x.type = 'down' AND e.parent = $1::uuid AND e.child = x.association) "
+         "OR (x.type = 'up' AND e.parent = x.association AND e.child = $1::uuid)"},
+        {nodeType(), "SELECT node_type FROM node WHERE id = $1"},
+        {"node_associations_load", "SELECT association, type FROM node_associations WHERE id = $1"},
+        {"node_edges_load", edgeRows},
+        {"node_skeleton",
+         reachableCte("$1::uuid", EdgeStorage::Mirrored) +
+         "SELECT r.id, n.node_type, na.association, na.type "
+         "FROM reachable r "
+         "JOIN node n ON n.id = r.id "
+         "LEFT JOIN node_associations na ON na.id = r.id"},
+        {"node_skeleton_normalized",
+         reachableCte("$1::uuid", EdgeStorage::Normalized) +
+         "SELECT r.id, n.node_type, e.association, e.type "
+         "FROM reachable r "
+         "JOIN node n ON n.id = r.id "
+         "LEFT JOIN LATERAL ("
+         " SELECT child, 'down'::association_type FROM node_edges WHERE parent = r.id"
+         " UNION ALL"
+         " SELECT parent, 'up'::association_type FROM node_edges WHERE child = r.id"
+         ") AS e(association, type) ON true"},
+        {"node_reachable",
+         reachableCte("unnest($1::uuid[])", EdgeStorage::Mirrored) +
+         "SELECT r.id, n.node_type FROM reachable r JOIN node n ON n.id = r.id"},
+        {"node_reachable_normalized",
+         reachableCte("unnest($1::uuid[])", EdgeStorage::Normalized) +
+         "SELECT r.id, n.node_type FROM reachable r JOIN node n ON n.id = r.id"},
+        {"node_remove_batch", "DELETE FROM node WHERE id = ANY($1::uuid[])"},
+        {"node_remove_associations_batch",
+         "DELETE FROM node_associations "
+         "WHERE id = ANY($1::uuid[]) OR association = ANY($1::uuid[])"},
+        {"node_remove_edges_batch",
+         "DELETE FROM node_edges "
+         "WHERE parent = ANY($1::uuid[]) OR child = ANY($1::uuid[])"}
+      };
+    }
+  };
+
+  /**
+   * Statements for a node type's own table. The upsert also writes
+   * the node row and associations (see Statements<Node>::nodeCtes),
+   * with the type's columns first, in DbSpecificData<NodeType>::columns
+   * order.
+   */
+
+  template <typename NodeType>
+  struct Statements {
+    using Specific = DbSpecificData<NodeType>;
+
+    // Depends on edgeStorage, since the node CTEs do
+    static const std::string& upsert() {
+      static const std::string mirrored = std::string(Specific::tableName) + "_upsert";
+      static const std::string normalized = mirrored + Statements<Node>::storageSuffix(EdgeStorage::Normalized);
+      return edgeStorage() == EdgeStorage::Normalized ? normalized : mirrored;
+    }
+
+    static const std::string& load() {
+      static const std::string name = std::string(Specific::tableName) + "_load";
+      return name;
+    }
+
+    static const std::string& loadBatch() {
+      static const std::string name = std::string(Specific::tableName) + "_load_batch";
+      return name;
+    }
+
+    static const std::string& remove() {
+      static const std::string name = std::string(Specific::tableName) + "_remove";
+      return name;
+    }
+
+    // Rows for every id in the array $1
+    static const std::string& removeBatch() {
+      static const std::string name = std::string(Specific::tableName) + "_remove_batch";
+      return name;
+    }
+
+    static std::string upsertSql(EdgeStorage storage) {
+      constexpr size_t count = Specific::columns.size();
+      std::string values;
+      for (size_t i = 1; i <= count; ++i) {
+        values += std::format("{}${}", (i > 1 ? ", " : ""), i);
+      }
+      return Statements<Node>::nodeCtes(count + 1, storage) +
+        std::format("INSERT INTO {} ({}) VALUES ({}) ON CONFLICT (id) DO UPDATE SET {}",
+                    Specific::tableName, columnList<NodeType>(), values,
+                    conflictUpdateList<NodeType>());
+    }
+
+    // Bits in Node::dirtyFields that belong to one of this type's columns
+    static constexpr uint64_t fieldMask() {
+      constexpr size_t fields = Specific::columns.size() - 1;
+      return fields >= 64 ? ~uint64_t{0} : (uint64_t{1} << fields) - 1;
+    }
+
+    /**
+     * UPDATE for just the columns whose bits are set in dirty. These
+     * aren't in all() since there can be one per combination of
+     * columns. DbSpecificData<Node>::updateRow prepares them on a
+     * connection the first time that connection needs one.
+     */
+    static std::string update(uint64_t dirty) {
+      return std::format("{}_update_{:x}", Specific::tableName, dirty);
+    }
+
+    static std::string updateSql(uint64_t dirty) {
+      std::string set;
+      size_t param = 2;
+      for (size_t i = 1; i < Specific::columns.size(); ++i) {
+        if (dirty & (uint64_t{1} << (i - 1))) {
+          set += std::format("{}{} = ${}", (set.empty() ? "" : ", "), Specific::columns[i], param++);
+        }
+      }
+      return std::format("UPDATE {} SET {} WHERE id = $1", Specific::tableName, set);
+    }
+
+    static std::vector<std::pair<std::string, std::string>> all() {
+      return {
+        {std::string(Specific::tableName) + "_upsert", upsertSql(EdgeStorage::Mirrored)},
+        {std::string(Specific::tableName) + "_upsert_normalized", upsertSql(EdgeStorage::Normalized)},
+        {load(), std::format("SELECT * FROM {} WHERE id = $1", Specific::tableName)},
+        {loadBatch(), std::format("SELECT * FROM {} WHERE id = ANY($1::uuid[])", Specific::tableName)},
+        {remove(), std::format("DELETE FROM {} WHERE id = $1", Specific::tableName)},
+        {removeBatch(), std::format("DELETE FROM {} WHERE id = ANY($1::uuid[])", Specific::tableName)}
+      };
+    }
+  };
+
   /************************************************************/
   // Node -- All Other Things Inherit From This, but not virtually.
-  // Since all the other functions' insert,update,load and remove
+  // Since all the other functions' upsert,load and remove
   // methods use the specialized node types, they don't conflict
   // with the base node definitions, BUT we can still call
-  // the parent node methods with Parent::insert et al.
+  // the parent node methods with Parent::remove et al.
   //
   // We don't need to call Parent::load for anything, since
   // the parent class one is a no-op
@@ -94,40 +600,143 @@ namespace fr::RequirementsManager::database {
 
     static constexpr char name[] = "Node";
     static constexpr char tableName[] = "node";
-    
-    void insert(PtrType node, pqxx::work& transaction) {
-      // Insert Node Into node
-      std::string insertCmd("INSERT INTO node (id, node_type) VALUES($1,$2);");
-      pqxx::params p{
-        node->idString(),
-        node->getNodeType()
-      };
-      transaction.exec(insertCmd, p);
 
-      // Write node associations
-      // These get cleared in PqDatabase.h if
-      // the node was already in the database, so
-      // they need to be rewritten if we're inserting
-      // or updating.
-      update(node, transaction);
+    static constexpr std::array<std::string_view, 2> columns{"id", "node_type"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(node->idString(), node->getNodeType());
+    }
+
+    // Parameters for Statements<Node>::nodeCtes, in order. These
+    // depend on the edge storage mode, same as the statement names.
+    // Params is pqxx::params or database::PqAsyncParams.
+    template <typename Params>
+    static void appendNodeParams(Node::PtrType node, Params& p) {
+      p.append(node->getNodeType());
+      if (edgeStorage() == EdgeStorage::Normalized) {
+        std::vector<std::string> children;
+        std::vector<std::string> parents;
+        children.reserve(node->down.size());
+        parents.reserve(node->up.size());
+        for (auto& downNode : node->down) {
+          children.push_back(downNode->idString());
+        }
+        for (auto& upNode : node->up) {
+          parents.push_back(upNode->idString());
+        }
+        p.append(children);
+        p.append(parents);
+        return;
+      }
+      std::vector<std::string> associations;
+      std::vector<std::string> types;
+      associations.reserve(node->up.size() + node->down.size());
+      types.reserve(node->up.size() + node->down.size());
+      for (auto& upNode : node->up) {
+        associations.push_back(upNode->idString());
+        types.push_back("up");
+      }
+      for (auto& downNode : node->down) {
+        associations.push_back(downNode->idString());
+        types.push_back("down");
+      }
+      p.append(associations);
+      p.append(types);
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      // Stream node associations into node_associations
-      pqxx::stream_to stream = pqxx::stream_to::table(transaction,
-            {"public", "node_associations"}, {"id", "association", "type"});
-
-      for (auto upNode : node->up) {
-        stream.write_values(node->idString(), upNode->idString(), "up");
+    /**
+     * Save node, its associations and its row in NodeType's table
+     * with one INSERT ... ON CONFLICT (id) DO UPDATE. row has to be
+     * in DbSpecificData<NodeType>::columns order, which is what the
+     * specializations' row methods return.
+     */
+    template <typename NodeType, typename Row>
+    static void upsertRow(typename NodeType::PtrType node, const Row& row, pqxx::work& transaction) {
+      pqxx::params p;
+      std::apply([&p](auto&&... values) {
+        (p.append(values), ...);
+      }, row);
+      appendNodeParams(node, p);
+      transaction.exec(pqxx::prepped{Statements<NodeType>::upsert()}, p);
+    }
+
+    // Write Node::edgeChanges with Statements<Node>::addEdges and removeEdges
+    static void writeEdgeChanges(Node::PtrType node, pqxx::work& transaction) {
+      std::vector<std::string> added;
+      std::vector<std::string> addedTypes;
+      std::vector<std::string> removed;
+      std::vector<std::string> removedTypes;
+      for (auto& change : node->edgeChanges) {
+        auto& ids = change.added ? added : removed;
+        auto& types = change.added ? addedTypes : removedTypes;
+        ids.push_back(change.id);
+        types.push_back(change.down ? "down" : "up");
+      }
+      if (!removed.empty()) {
+        pqxx::params p{node->idString()};
+        p.append(removed);
+        p.append(removedTypes);
+        transaction.exec(pqxx::prepped{Statements<Node>::removeEdges()}, p);
       }
+      if (!added.empty()) {
+        pqxx::params p{node->idString()};
+        p.append(added);
+        p.append(addedTypes);
+        transaction.exec(pqxx::prepped{Statements<Node>::addEdges()}, p);
+      }
+    }
 
-      for (auto downNode : node->down) {
-        stream.write_values(node->idString(), downNode->idString(), "down");
+    /**
+     * Save only what changed in a node that's already in the
+     * database: the columns flagged in Node::dirtyFields and the
+     * edges in Node::edgeChanges. row is the same full row
+     * upsertRow takes; the columns that aren't dirty are skipped.
+     *
+     * Returns false without writing anything if the node's row
+     * wasn't there to update (someone removed it since we loaded
+     * it). Call upsert for a full save in that case.
+     */
+    template <typename NodeType, typename Row>
+    static bool updateRow(typename NodeType::PtrType node, const Row& row,
+                          PooledConnection& connection, pqxx::work& transaction) {
+      uint64_t dirty = node->dirtyFields & Statements<NodeType>::fieldMask();
+      if (dirty) {
+        pqxx::params p{
+          node->idString()
+        };
+        // Field I is column I + 1, since id comes first
+        [&]<size_t... I>(std::index_sequence<I...>) {
+          ((dirty & (uint64_t{1} << I) ? p.append(std::get<I + 1>(row)) : void()), ...);
+        }(std::make_index_sequence<std::tuple_size_v<Row> - 1>{});
+        auto name = Statements<NodeType>::update(dirty);
+        connection.prepare(name, Statements<NodeType>::updateSql(dirty));
+        pqxx::result res = transaction.exec(pqxx::prepped{name}, p);
+        if (res.affected_rows() == 0) {
+          return false;
+        }
       }
-      stream.complete();
-      transaction.commit();
+      writeEdgeChanges(node, transaction);
+      return true;
     }
 
+    // Raw nodes don't have any fields to update, just edges
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      writeEdgeChanges(node, transaction);
+      return true;
+    }
+
+    /**
+     * Save a raw node. There's no type table for these, so it's
+     * just the node row and its associations.
+     */
+    void upsert(PtrType node, pqxx::work& transaction) {
+      pqxx::params p{
+        node->idString()
+      };
+      appendNodeParams(node, p);
+      transaction.exec(pqxx::prepped{Statements<Node>::upsert()}, p);
+    }
+    
     bool load(PtrType node, pqxx::work& transaction) {
       // This is a no-op in node, because all the required node data
       // gets loaded in the other specific types.
@@ -139,17 +748,12 @@ namespace fr::RequirementsManager::database {
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
-      // Remove all associations for this node
-      std::string rmAssociations("DELETE FROM node_associations WHERE id = $1 OR association = $1");
-      // Remove from node
-      std::string rmNode("DELETE FROM node WHERE id = $1");
       pqxx::params p{
         node->idString()
       };
-      // Run the deletes
-      transaction.exec(rmAssociations,p);
-      transaction.exec(rmNode,p);
-      transaction.commit();
+      // Remove all associations for this node, then the node
+      transaction.exec(pqxx::prepped{Statements<Node>::removeAssociations()}, p);
+      transaction.exec(pqxx::prepped{Statements<Node>::remove()}, p);
     }
   };
 
@@ -166,39 +770,41 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "GraphNode";
     static constexpr char tableName[] = "graph_node";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node,transaction);
-      std::string cmd = std::format("INSERT INTO {} (id,title) VALUES ($1, $2);", tableName);
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "title"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getTitle()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd = std::format("UPDATE {} SET title = $1 WHERE id = $2;", tableName);
-      pqxx::params p{
-        node->getTitle(),
-        node->idString()
-      };
-      transaction.exec(cmd,p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setTitle(row["title"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("select * from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
       if (res.size() > 0) {
         ret = true;
       }
 
       for (auto const &row : res) {
-        node->setTitle(row["title"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
@@ -206,11 +812,10 @@ namespace fr::RequirementsManager::database {
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
       // Delete from specific table where this object lives
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -227,35 +832,39 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Organization";
     static constexpr char tableName[] = "organization";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO organization (id, locked, name) VALUES ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "locked", "name"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->isLocked(),
         node->getName()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE organization SET name = $1, locked = $2 WHERE id = $3;");
-      pqxx::params p{
-        node->getName(),
-        node->isLocked(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setName(row["name"].template as<std::string>());
+      if (row["locked"].template as<bool>()) {
+        node->lock();
+      }
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -266,21 +875,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setName(row["name"].as<std::string>());
-        if (row["locked"].as<bool>()) {
-          node->lock();
-        }
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -297,35 +902,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Product";
     static constexpr char tableName[] = "product";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO product (id,title,description) VALUES ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "title", "description"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getTitle(),
         node->getDescription()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE product SET title = $1, description = $2 WHERE id = $3;");
-      pqxx::params p{
-        node->getTitle(),
-        node->getDescription(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setTitle(row["title"].template as<std::string>());
+      node->setDescription(row["description"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -336,19 +943,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setTitle(row["title"].as<std::string>());
-        node->setDescription(row["description"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
     
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
 
   };
@@ -365,35 +970,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Project";
     static constexpr char tableName[] = "project";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO project (id,name,description) VALUES ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "name", "description"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getName(),
         node->getDescription()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE project SET name = $1, description = $2 WHERE id = $3;");
-      pqxx::params p{
-        node->getName(),
-        node->getDescription(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);         
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setName(row["name"].template as<std::string>());
+      node->setDescription(row["description"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -404,19 +1011,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setName(row["name"].as<std::string>());
-        node->setDescription(row["description"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -433,37 +1038,39 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Requirement";
     static constexpr char tableName[] = "requirement";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO requirement (id, title, text, functional) VALUES ($1, $2, $3, $4);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 4> columns{"id", "title", "text", "functional"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getTitle(),
         node->getText(),
         node->isFunctional()
-      };
-      transaction.exec(cmd,p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE requirement SET title = $1, text = $2, functional = $3 WHERE id = $4;");
-      pqxx::params p{
-        node->getTitle(),
-        node->getText(),
-        node->isFunctional(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
     }
-    
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setTitle(row["title"].template as<std::string>());
+      node->setText(row["text"].template as<std::string>());
+      node->setFunctional(row["functional"].template as<bool>());
+    }
+
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -474,20 +1081,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setTitle(row["title"].as<std::string>());
-        node->setText(row["text"].as<std::string>());
-        node->setFunctional(row["functional"].as<bool>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -504,37 +1108,39 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Story";
     static constexpr char tableName[] = "story";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO story (id, title, goal, benefit) values ($1, $2, $3, $4);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 4> columns{"id", "title", "goal", "benefit"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getTitle(),
         node->getGoal(),
         node->getBenefit()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE story SET title = $1, goal = $2, benefit = $3 WHERE id = $4;");
-      pqxx::params p{
-        node->getTitle(),
-        node->getGoal(),
-        node->getBenefit(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setTitle(row["title"].template as<std::string>());
+      node->setGoal(row["goal"].template as<std::string>());
+      node->setBenefit(row["benefit"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -545,20 +1151,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setTitle(row["title"].as<std::string>());
-        node->setGoal(row["goal"].as<std::string>());
-        node->setBenefit(row["benefit"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
   };
 
@@ -574,33 +1177,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "UseCase";
     static constexpr char tableName[] = "use_case";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO use_case (id,name) VALUES ($1, $2);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "name"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getName()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE use_case SET name = $1 WHERE id = $2;");
-      pqxx::params p{
-        node->getName(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setName(row["name"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -611,18 +1216,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setName(row["name"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -639,33 +1243,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Text";
     static constexpr char tableName[] = "text";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO text (id, text) VALUES ($1, $2);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "text"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getText()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE text SET text = $1 WHERE id = $2;");
-      pqxx::params p {
-        node->getText(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setText(row["text"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -676,18 +1282,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setText(row["text"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -704,33 +1309,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Completed";
     static constexpr char tableName[] = "completed";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO completed (id, description) VALUES ($1, $2);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "description"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getDescription()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE completed SET description = $1 WHERE id = $2;");
-      pqxx::params p{
-        node->getDescription(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setDescription(row["description"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -741,18 +1348,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setDescription(row["description"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -769,35 +1375,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "KeyValue";
     static constexpr char tableName[] = "keyvalue";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO keyvalue (id, key, value) VALUES ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "key", "value"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getKey(),
         node->getValue()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE keyvalue SET key = $1, value = $2 WHERE id = $3;");
-      pqxx::params p{
-        node->getKey(),
-        node->getValue(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setKey(row["key"].template as<std::string>());
+      node->setValue(row["value"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -808,19 +1416,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setKey(row["key"].as<std::string>());
-        node->setValue(row["value"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -837,39 +1443,41 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "TimeEstimate";
     static constexpr char tableName[] = "time_estimate";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO time_estimate (id, text, estimate, started, start) values ($1, $2, $3, $4, $5);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 5> columns{"id", "text", "estimate", "started", "start"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getText(),
         node->getEstimate(),
         node->getStarted(),
-        node->getStartTimestamp()
-      };
-      transaction.exec(cmd, p);
+        toTimestamp(node->getStartTimestamp())
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE time_estimate SET text=$1, estimate=$2, started=$3, start=$4  WHERE id = $5;");
-      pqxx::params p{
-        node->getText(),
-        node->getEstimate(),
-        node->getStarted(),
-        node->getStartTimestamp(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setText(row["text"].template as<std::string>());
+      node->setEstimate(row["estimate"].template as<unsigned long>());
+      node->setStarted(row["started"].template as<bool>());
+      node->setStartTimestamp(fromTimestamp(row["start"]));
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -880,21 +1488,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setText(row["text"].as<std::string>());
-        node->setEstimate(row["estimate"].as<unsigned long>());
-        node->setStarted(row["started"].as<bool>());
-        node->setStartTimestamp(row["start"].as<time_t>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -911,35 +1515,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Effort";
     static constexpr char tableName[] = "effort";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO effort (id, text, effort) values ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "text", "effort"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getText(),
         node->getEffort()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE effort SET text = $1, effort = $2 WHERE id = $3;");
-      pqxx::params p{
-        node->getText(),
-        node->getEffort(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setText(row["text"].template as<std::string>());
+      node->setEffort(row["effort"].template as<unsigned long>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -950,19 +1556,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setText(row["text"].as<std::string>());
-        node->setEffort(row["effort"].as<unsigned long>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -979,33 +1583,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Role";
     static constexpr char tableName[] = "role";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO role (id, who) VALUES ($1, $2);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "who"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getWho()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE role SET who = $1 WHERE id = $2;");
-      pqxx::params p {
-        node->getWho(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setWho(row["who"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1016,18 +1622,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setWho(row["who"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1044,33 +1649,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Actor";
     static constexpr char tableName[] = "actor";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO actor (id, actor) values ($1, $2);");      
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "actor"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getActor()
-      };
-      transaction.exec(cmd,p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE actor SET actor = $1 WHERE id = $2;");
-      pqxx::params p{
-        node->getActor(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setActor(row["actor"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1081,18 +1688,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setActor(row["actor"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
     
   };
@@ -1109,46 +1715,45 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Goal";
     static constexpr char tableName[] = "goal";
 
-    void insert(PtrType node, pqxx::work& transaction) {      
-      std::string cmd("INSERT INTO goal (id, action, outcome, context, target_date,"
-                      "target_date_confidence, alignment) VALUES ($1, $2, $3, $4, $5, $6, $7);");
-      Parent::insert(node, transaction);
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 7> columns{"id", "action", "outcome", "context", "target_date", "target_date_confidence", "alignment"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getAction(),
         node->getOutcome(),
         node->getContext(),
-        node->getTargetDate(),
+        toTimestamp(node->getTargetDate()),
         node->getTargetDateConfidence(),
         node->getAlignment()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE goal SET action = $1, outcome = $2, context = $3, "
-                      "target_date = $4, target_date_confidence = $5, alignment = $6"
-                      "WHERE id = $7;");
-      pqxx::params p{
-        node->getAction(),
-        node->getOutcome(),
-        node->getContext(),
-        node->getTargetDate(),
-        node->getTargetDateConfidence(),
-        node->getAlignment(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setAction(row["action"].template as<std::string>());
+      node->setOutcome(row["outcome"].template as<std::string>());
+      node->setContext(row["context"].template as<std::string>());
+      node->setTargetDate(fromTimestamp(row["target_date"]));
+      node->setTargetDateConfidence(row["target_date_confidence"].template as<std::string>());
+      node->setAlignment(row["alignment"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1159,23 +1764,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setAction(row["action"].as<std::string>());
-        node->setOutcome(row["outcome"].as<std::string>());
-        node->setContext(row["context"].as<std::string>());
-        node->setTargetDate(row["target_date"].as<unsigned long>());
-        node->setTargetDateConfidence(row["target_date_confidence"].as<std::string>());
-        node->setAlignment(row["alignment"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -1192,39 +1791,39 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Purpose";
     static constexpr char tableName[] = "purpose";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO purpose (id, description, deadline, deadline_confidence)"
-                      "VALUES ($1, $2, $3, $4);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 4> columns{"id", "description", "deadline", "deadline_confidence"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getDescription(),
-        node->getDeadline(),
+        toTimestamp(node->getDeadline()),
         node->getDeadlineConfidence()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE purpsoe SET description = $1, deadline = $2,"
-                      "deadline_confidence = $3 WHERE id = $4");
-      pqxx::params p{
-        node->getDescription(),
-        node->getDeadline(),
-        node->getDeadlineConfidence(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setDescription(row["description"].template as<std::string>());
+      node->setDeadline(fromTimestamp(row["deadline"]));
+      node->setDeadlineConfidence(row["deadline_confidence"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1235,20 +1834,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setDescription(row["description"].as<std::string>());
-        node->setDeadline(row["deadline"].as<unsigned long>());
-        node->setDeadlineConfidence(row["deadline_confidence"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1265,35 +1861,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Person";
     static constexpr char tableName[] = "person";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO person (id, first_name, last_name) VALUES ($1, $2, $3);");
-      pqxx::params p {
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "first_name", "last_name"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getFirstName(),
         node->getLastName()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE person SET first_name = $1, last_name = $2 WHERE id = $3;");
-      pqxx::params p {
-        node->getFirstName(),
-        node->getLastName(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setFirstName(row["first_name"].template as<std::string>());
+      node->setLastName(row["last_name"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1304,19 +1902,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setFirstName(row["first_name"].as<std::string>());
-        node->setLastName(row["last_name"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1333,33 +1929,35 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "EmailAddress";
     static constexpr char tableName[] = "email_address";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO email_address (id, address) VALUES ($1, $2);");
-      pqxx::params p {
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 2> columns{"id", "address"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getAddress()
-      };
-      transaction.exec(cmd,p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE email_address set address=$1 WHERE id = $2;");
-      pqxx::params p {
-        node->getAddress(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setAddress(row["address"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1370,18 +1968,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setAddress(row["address"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1398,39 +1995,39 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "PhoneNumber";
     static constexpr char tableName[] = "phone_number";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO phone_number (id, countrycode, number, phone_type"
-                      "VALUES ($1, $2, $3, $4);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 4> columns{"id", "countrycode", "number", "phone_type"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getCountryCode(),
         node->getNumber(),
         node->getPhoneType()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE phone_number SET countrycode = $1, number = $2,"
-                      "phone_type = $3 WHERE id = $4;");
-      pqxx::params p{
-        node->getCountryCode(),
-        node->getNumber(),
-        node->getPhoneType(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setCountryCode(row["countrycode"].template as<std::string>());
+      node->setNumber(row["number"].template as<std::string>());
+      node->setPhoneType(row["phone_type"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1441,20 +2038,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setCountryCode(row["countrycode"].as<std::string>());
-        node->setNumber(row["number"].as<std::string>());
-        node->setPhoneType(row["phone_type"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1471,44 +2065,41 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "InternationalAddress";
     static constexpr char tableName[] = "international_address";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO international_address (id, country_code, address_lines,"
-                      "locality, postal_code) VALUES ($1, $2, $3, $4, $5);");
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 5> columns{"id", "country_code", "address_lines", "locality", "postal_code"};
 
-      pqxx::params p{
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getCountryCode(),
         node->getAddressLines(),
         node->getLocality(),
-        node->getPostalCode()        
-      };
-      transaction.exec(cmd, p);
+        node->getPostalCode()
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE international_address SET country_code = $1, address_lines = $2,"
-                      "locality = $3, postal_code = $4 WHERE id = $5;");
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
 
-      pqxx::params p{
-        node->getCountryCode(),
-        node->getAddressLines(),
-        node->getLocality(),
-        node->getPostalCode(),
-        node->idString()
-      };
-      
-      transaction.exec(cmd, p);
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setCountryCode(row["country_code"].template as<std::string>());
+      // Address lines are just text nodes and will be set up elsewhere.
+      node->setLocality(row["locality"].template as<std::string>());
+      node->setPostalCode(row["postal_code"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1519,21 +2110,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setCountryCode(row["country_code"].as<std::string>());
-        // Address lines are just text nodes and will be set up elsewhere.
-        node->setLocality(row["locality"].as<std::string>());
-        node->setPostalCode(row["postal_code"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
     
   };
@@ -1550,45 +2137,41 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "USAddress";
     static constexpr char tableName[] = "us_address";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO us_address (id, address_lines, city, state, zipcode) "
-                      "VALUES ($1, $2, $3, $4, $5);");
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 5> columns{"id", "address_lines", "city", "state", "zipcode"};
 
-      std::string addressId;
-
-      pqxx::params p{
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getAddressLines(),
         node->getCity(),
         node->getState(),
         node->getZipCode()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE us_address SET address_lines = $1, city = $2, state = $3, "
-                      "zipcode = $4 WHERE id = $5;");
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
 
-      pqxx::params p{
-        node->getAddressLines(),
-        node->getCity(),
-        node->getState(),
-        node->getZipCode(),
-        node->idString()
-      };
-      transaction.exec(cmd,p);
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      // Address lines are just text nodes and will be set up elsewhere.
+      node->setCity(row["city"].template as<std::string>());
+      node->setState(row["state"].template as<std::string>());
+      node->setZipCode(row["zipcode"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1599,21 +2182,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        // Address lines are just text nodes and will be set up elsewhere.
-        node->setCity(row["city"].as<std::string>());
-        node->setState(row["state"].as<std::string>());
-        node->setZipCode(row["zipcode"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1629,35 +2208,37 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Event";
     static constexpr char tableName[] = "event";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd("INSERT INTO event (id, name, description) VALUES ($1, $2, $3);");
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 3> columns{"id", "name", "description"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getName(),
         node->getDescription()
-      };
-      transaction.exec(cmd, p);
+      );
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd("UPDATE event SET name = $1, description = $2 WHERE id = $3");
-      pqxx::params p{
-        node->getName(),
-        node->getDescription(),
-        node->idString()
-      };
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setName(row["name"].template as<std::string>());
+      node->setDescription(row["description"].template as<std::string>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1;", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
 
       if (res.size() > 0) {
         ret = true;
@@ -1668,19 +2249,17 @@ namespace fr::RequirementsManager::database {
       // I can revisit this if database performance proves to be an issue,
       // but I suspect it will not.
       for (auto const &row : res) {
-        node->setName(row["name"].as<std::string>());
-        node->setDescription(row["description"].as<std::string>());
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }    
 
   };
@@ -1696,37 +2275,11 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "RecurringTodo";
     static constexpr char tableName[] = "recurring_todo";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd =
-        std::format("INSERT INTO {} (id, description, created, recurring_interval,"
-                    "seconds_flag, dom_flag, doy_flag) VALUES ($1, $2, $3, $4, $5, $6, $7);",
-                    tableName);
-      pqxx::params p{
-        node->idString(),
-        node->getDescription(),
-        node->getCreated(),
-        node->getRecurringInterval(),
-        node->getSecondsFlag(),
-        node->getDayOfMonthFlag(),
-        node->getDayOfYearFlag()
-      };
-      transaction.exec(cmd, p);
-      transaction.commit();
-    }
-
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd =
-        std::format("UPDATE {} SET "
-                    "description = $2,"
-                    "created = $3,"
-                    "recurring_interval = $4,"
-                    "seconds_flag = $5,"
-                    "dom_flag = $6,"
-                    "doy_flag = $7 "
-                    "WHERE id = $1", tableName);
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 7> columns{"id", "description", "created", "recurring_interval", "seconds_flag", "dom_flag", "doy_flag"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getDescription(),
         node->getCreated(),
@@ -1734,40 +2287,48 @@ namespace fr::RequirementsManager::database {
         node->getSecondsFlag(),
         node->getDayOfMonthFlag(),
         node->getDayOfYearFlag()
-      };
-      transaction.exec(cmd, p);
-      transaction.commit();
+      );
+    }
+
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
+    }
+
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setDescription(row["description"].template as<std::string>());
+      node->setCreated(row["created"].template as<time_t>());
+      node->setRecurringInterval(row["recurring_interval"].template as<time_t>());
+      node->setSecondsFlag(row["seconds_flag"].template as<bool>());
+      node->setDayOfMonthFlag(row["dom_flag"].template as<bool>());
+      node->setDayOfYearFlag(row["doy_flag"].template as<bool>());
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("select * from {} WHERE id = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
       if (res.size() > 0) {
         ret = true;
       }
       for (auto const &row : res) {
-        node->setDescription(row["description"].as<std::string>());
-        node->setCreated(row["created"].as<time_t>());
-        node->setRecurringInterval(row["recurring_interval"].as<time_t>());
-        node->setSecondsFlag(row["seconds_flag"].as<bool>());
-        node->setDayOfMonthFlag(row["dom_flag"].as<bool>());
-        node->setDayOfYearFlag(row["doy_flag"].as<bool>());
-      }      
+        populate(node, row);
+      }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
-      transaction.commit();
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
@@ -1784,13 +2345,11 @@ namespace fr::RequirementsManager::database {
     static constexpr char name[] = "Todo";
     static constexpr char tableName[] = "todo";
 
-    void insert(PtrType node, pqxx::work& transaction) {
-      Parent::insert(node, transaction);
-      std::string cmd = std::format("INSERT INTO {} (id, description, created,"
-                                    "due, completed, date_completed, spawned_from)"
-                                    "VALUES ($1, $2, $3, $4, $5, $6, $7)",
-                                    tableName);
-      pqxx::params p{
+    // Columns in tableName, in the order row returns them
+    static constexpr std::array<std::string_view, 7> columns{"id", "description", "created", "due", "completed", "date_completed", "spawned_from"};
+
+    auto row(PtrType node) {
+      return std::make_tuple(
         node->idString(),
         node->getDescription(),
         node->getCreated(),
@@ -1798,83 +2357,52 @@ namespace fr::RequirementsManager::database {
         node->getCompleted(),
         node->getDateCompleted(),
         boost::uuids::to_string(node->getSpawnedFrom())
-      };
+      );
+    }
 
-      transaction.exec(cmd, p);
+    void upsert(PtrType node, pqxx::work& transaction) {
+      Parent::upsertRow<Type>(node, row(node), transaction);
     }
 
-    void update(PtrType node, pqxx::work& transaction) {
-      Parent::update(node, transaction);
-      std::string cmd =
-        std::format("update {} SET "
-                    "description = $2,"
-                    "created = $3,"
-                    "due = $4,"
-                    "completed = $5,"
-                    "date_completed = $6,"
-                    "spawned_from = $7 "
-                    "WHERE id = $1", tableName);
-      pqxx::params p{
-        node->idString(),
-        node->getDescription(),
-        node->getCreated(),
-        node->getDue(),
-        node->getCompleted(),
-        node->getDateCompleted(),
-        boost::uuids::to_string(node->getSpawnedFrom())
-      };
-      transaction.exec(cmd, p);
+    bool update(PtrType node, PooledConnection& connection, pqxx::work& transaction) {
+      return Parent::updateRow<Type>(node, row(node), connection, transaction);
+    }
+
+    template <typename Row>
+    void populate(PtrType node, const Row& row) {
+      node->setDescription(row["description"].template as<std::string>());
+      node->setCreated(row["created"].template as<time_t>());
+      node->setDue(row["due"].template as<time_t>());
+      node->setCompleted(row["completed"].template as<bool>());
+      node->setDateCompleted(row["date_completed"].template as<time_t>());
+      boost::uuids::string_generator generator;
+      std::string uuid_str = row["spawned_from"].template as<std::string>();
+      node->setSpawnedFrom(generator(uuid_str));
     }
 
     bool load(PtrType node, pqxx::work& transaction) {
       bool ret = false;
-      std::string cmd = std::format("SELECT * from {} WHERE id = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      pqxx::result res = transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{Statements<Type>::load()}, p);
       if (res.size() > 0) {
         ret = true;
       }
       for (auto const &row : res) {
-        node->setDescription(row["description"].as<std::string>());
-        node->setCreated(row["created"].as<time_t>());
-        node->setDue(row["due"].as<time_t>());
-        node->setCompleted(row["completed"].as<bool>());
-        node->setCompleted(row["date_completed"].as<time_t>());
-        boost::uuids::string_generator generator;
-        std::string uuid_str = row["spawned_from"].as<std::string>();
-        node->setSpawnedFrom(generator(uuid_str));
+        populate(node, row);
       }
       return ret;
     }
 
     void remove(PtrType node, pqxx::work& transaction) {
       Parent::remove(node, transaction);
-      std::string cmd = std::format("DELETE from {} WHERE ID = $1", tableName);
       pqxx::params p{
         node->idString()
       };
-      transaction.exec(cmd, p);
+      transaction.exec(pqxx::prepped{Statements<Type>::remove()}, p);
     }
     
   };
-  
-  /**
-   * nodeInTable function checks a specific table (defined in tableName in all
-   * the above specialziations) and checks to see if a given node is in the
-   * table. This dictates whether insert or update gets called to update
-   * the table.
-   */
-  
-  template <typename NodeType>
-  bool nodeInTable(typename NodeType::PtrType node, pqxx::work& transaction) {
-    std::string query = std::format("select id from {} where id = $1", DbSpecificData<NodeType>::tableName);
-    pqxx::params p{
-      node->idString()
-    };
-    pqxx::result result = transaction.exec(query,p);
-    return (result.size() > 0);
-  }
 
 }
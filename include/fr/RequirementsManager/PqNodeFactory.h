@@ -21,7 +21,10 @@
 #include <format>
 #include <fr/RequirementsManager.h>
 #include <fr/RequirementsManager/AllNodeTypes.h>
+#include <fr/RequirementsManager/GraphArena.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
 #include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/RequirementsManager/PqStatements.h>
 #include <fr/RequirementsManager/Node.h>
 #include <fr/RequirementsManager/TaskNode.h>
 #include <fr/RequirementsManager/ThreadPool.h>
@@ -48,11 +51,16 @@ namespace fr::RequirementsManager {
    * just shovel freshly allocated nodes into a loader
    * and have them loaded with the data from the database.
    * You need to look up the UUID to look up the type anyway.
+   *
+   * If you give it a GraphArena, nodes get allocated from that
+   * instead of the heap.
    */
   
   class NodeAllocator {
     using NodeList = AllNodeTypes;
 
+    GraphArena::PtrType _arena;
+
     /**
      * Handles the actual node lookup from public get entrypoint
      */
@@ -67,7 +75,7 @@ namespace fr::RequirementsManager {
       using currentType = List::head::type;
       Node::PtrType workingNode;
       if (nodeType == database::DbSpecificData<currentType>::name) {
-        workingNode = std::make_shared<currentType>();
+        workingNode = makeNodeIn<currentType>(_arena);
         workingNode->setUuid(uuid);           
       } else {
         // Keep iterating down the list. If we hit void, we're at the
@@ -81,7 +89,7 @@ namespace fr::RequirementsManager {
       // in the database, and we'll just return a raw node
       // with the UUID set so you never get a nullptr back.
       if (!workingNode) {
-        workingNode = std::make_shared<Node>();
+        workingNode = makeNodeIn<Node>(_arena);
         workingNode->setUuid(uuid);
       }
       return workingNode;
@@ -95,6 +103,15 @@ namespace fr::RequirementsManager {
     Node::PtrType get(const std::string& nodeType, const std::string& uuid) {
       return getNode<NodeList>(nodeType, uuid);
     }
+
+    // Null goes back to allocating from the heap
+    void setArena(GraphArena::PtrType arena) {
+      _arena = std::move(arena);
+    }
+
+    GraphArena::PtrType getArena() const {
+      return _arena;
+    }
   };
 
   /**
@@ -107,8 +124,8 @@ namespace fr::RequirementsManager {
   template <typename WorkerThreadType>
   class PqNodeLoader : public TaskNode<WorkerThreadType> {
     using NodeList = AllNodeTypes;
-    pqxx::connection _connection;
-    pqxx::work _transaction;
+    // Connection is borrowed from here when run is called
+    std::shared_ptr<database::PqConnectionPool> _pool;
 
     // Indicates this loading task has completed.
     std::atomic<bool> _loadComplete;
@@ -122,7 +139,7 @@ namespace fr::RequirementsManager {
     // Recusively iterate typelist to load a node
 
     template <typename List>
-    constexpr void load()
+    constexpr void load(pqxx::work& transaction)
     requires
       (fr::types::IsTypelist<List> &&
        fr::types::IsUnique<List>)
@@ -131,10 +148,10 @@ namespace fr::RequirementsManager {
       auto cast = std::dynamic_pointer_cast<CurrentType>(_node);
       if (cast) {
         database::DbSpecificData<CurrentType> specificLoader;
-        _found = specificLoader.load(cast, _transaction);
+        _found = specificLoader.load(cast, transaction);
       } else {
         if constexpr (!std::is_void_v<typename List::tail::head::type>) {
-          load<typename List::tail>();
+          load<typename List::tail>(transaction);
         }
       }
     }
@@ -146,10 +163,12 @@ namespace fr::RequirementsManager {
 
     fteng::signal<void(const std::string&, Node::PtrType)> loaded;
 
-    PqNodeLoader(Node::PtrType toLoad) : _transaction(_connection),
-                                         _loadComplete(false),
-                                         _found(false),
-                                         _node(toLoad) {
+    PqNodeLoader(Node::PtrType toLoad,
+                 std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault()) :
+      _pool(pool),
+      _loadComplete(false),
+      _found(false),
+      _node(toLoad) {
     }
     
     virtual ~PqNodeLoader() {}
@@ -159,7 +178,16 @@ namespace fr::RequirementsManager {
     }
 
     void run() override {
-      load<NodeList>();
+      {
+        auto connection = database::PqStatements::acquire(_pool);
+        auto cancel = connection.cancelOn(this->getCancellation());
+        pqxx::work transaction(*connection);
+        load<NodeList>(transaction);
+      }
+      if (_found) {
+        // The setters load called flagged everything as dirty
+        _node->clearDirty();
+      }
       _loadComplete = true;
       loaded(_node->idString(), _node);
     }
@@ -176,13 +204,163 @@ namespace fr::RequirementsManager {
     
   };
 
+  /**
+   * PqBatchNodeLoader loads the data for a group of nodes that are all
+   * the same type with a single "WHERE id = ANY($1)" query against that
+   * type's table. PqNodeFactory hands it every node of a given type in
+   * the graph, so loading a graph costs one data query per node type
+   * rather than one per node.
+   *
+   * The type lookup recurses through AllNodeTypes the same way
+   * PqNodeLoader does, so adding a type to the typelist (and
+   * specializing DbSpecificData for it) is all it takes to get it
+   * batched. Nodes whose type isn't in the list (raw Nodes) don't
+   * have a table, so they're just reported as loaded.
+   *
+   * Like PqNodeLoader, this doesn't touch the up/down lists.
+   */
+
+  template <typename WorkerThreadType>
+  class PqBatchNodeLoader : public TaskNode<WorkerThreadType> {
+    using NodeList = AllNodeTypes;
+    std::shared_ptr<database::PqConnectionPool> _pool;
+
+    // DbSpecificData name of every node in _nodes
+    std::string _batchType;
+    std::vector<Node::PtrType> _nodes;
+
+    std::atomic<bool> _loadComplete;
+    // Number of nodes we found rows for
+    std::atomic<size_t> _found;
+
+    template <typename List>
+    constexpr void load(pqxx::work& transaction)
+    requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using CurrentType = List::head::type;
+      if (_batchType == database::DbSpecificData<CurrentType>::name) {
+        loadBatch<CurrentType>(transaction);
+      } else {
+        if constexpr (!std::is_void_v<typename List::tail::head::type>) {
+          load<typename List::tail>(transaction);
+        }
+      }
+    }
+
+    template <typename NodeType>
+    void loadBatch(pqxx::work& transaction) {
+      using Specific = database::DbSpecificData<NodeType>;
+      std::unordered_map<std::string, typename NodeType::PtrType> byId;
+      std::vector<std::string> ids;
+      byId.reserve(_nodes.size());
+      ids.reserve(_nodes.size());
+      for (auto& node : _nodes) {
+        auto cast = std::dynamic_pointer_cast<NodeType>(node);
+        if (cast) {
+          byId[cast->idString()] = cast;
+          ids.push_back(cast->idString());
+        }
+      }
+      if (ids.empty()) {
+        return;
+      }
+      pqxx::params p{
+        ids
+      };
+      pqxx::result res = transaction.exec(pqxx::prepped{database::Statements<NodeType>::loadBatch()}, p);
+      Specific specificLoader;
+      for (auto const &row : res) {
+        auto found = byId.find(row["id"].as<std::string>());
+        if (found != byId.end()) {
+          specificLoader.populate(found->second, row);
+          // populate goes through the setters, which flag everything
+          // as dirty. It matches the database now.
+          found->second->clearDirty();
+          ++_found;
+        }
+      }
+    }
+
+  public:
+    using Type = PqBatchNodeLoader<WorkerThreadType>;
+    using PtrType = std::shared_ptr<PqBatchNodeLoader<WorkerThreadType>>;
+    using Parent = TaskNode<WorkerThreadType>;
+
+    // Fired once for each node in the batch after the query completes
+    fteng::signal<void(const std::string&, Node::PtrType)> loaded;
+
+    PqBatchNodeLoader(const std::string& batchType,
+                      std::vector<Node::PtrType> toLoad,
+                      std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault()) :
+      _pool(pool),
+      _batchType(batchType),
+      _nodes(std::move(toLoad)),
+      _loadComplete(false),
+      _found(0) {
+    }
+
+    virtual ~PqBatchNodeLoader() {}
+
+    std::string getNodeType() const override {
+      return "PqBatchNodeLoader";
+    }
+
+    void run() override {
+      {
+        auto connection = database::PqStatements::acquire(_pool);
+        auto cancel = connection.cancelOn(this->getCancellation());
+        pqxx::work transaction(*connection);
+        load<NodeList>(transaction);
+      }
+      _loadComplete = true;
+      for (auto& node : _nodes) {
+        loaded(node->idString(), node);
+      }
+    }
+
+    bool complete() const {
+      return _loadComplete;
+    }
+
+    // Number of nodes in the batch that had data in the database
+    size_t found() const {
+      return _found;
+    }
+
+    size_t size() const {
+      return _nodes.size();
+    }
+
+    const std::string& batchType() const {
+      return _batchType;
+    }
+  };
+
+  /**
+   * How PqNodeFactory discovers the shape of the graph.
+   *
+   * Recursive walks node_associations one node at a time, which costs
+   * two round trips per node (one for the node type and one for its
+   * associations.) Skeleton asks the database for every reachable
+   * node and edge in a single WITH RECURSIVE query and wires the
+   * graph up in memory. Skeleton is the default; Recursive is still
+   * around so you can compare the two.
+   */
+
+  enum class LoadMode {
+    Recursive,
+    Skeleton
+  };
+
   /**
    * PqNodeFactory assembles a graph given a Node ID. As it iterates through the
    * list of nodes associated with the given Node ID, it uses NodeAllocator to
-   * allocate them then handles assembling the graph. It dispatches all the
-   * allocated nodes to PqNodeLoader to load the data associated with the
-   * node while the factory works on assembling the graph. Once the graph is
-   * fully assembled, it's handed back to the user.
+   * allocate them then handles assembling the graph. Once the skeleton of the
+   * graph is assembled, the allocated nodes are grouped by type and each group
+   * is handed to a PqBatchNodeLoader to load the data associated with those
+   * nodes. When all the loaders have finished, done is signalled.
    */
 
   template <typename WorkerType>
@@ -193,24 +371,27 @@ namespace fr::RequirementsManager {
     std::mutex _alreadyLoadedMutex;
     // Map used to keep track of which UUIDs we've already loaded
     std::unordered_map<std::string, Node::PtrType> _alreadyLoaded;
+    // Nodes waiting to be loaded, grouped by node type
+    std::unordered_map<std::string, std::vector<Node::PtrType>> _batches;
 
     // Set to true at the end of run
     bool _graphLoaded;
 
     Node::PtrType _startingNode;
 
-    pqxx::connection _connection;
-    pqxx::work _transaction;
+    // The factory borrows one connection for the duration of run
+    // and hands this pool to its loaders.
+    std::shared_ptr<database::PqConnectionPool> _pool;
     NodeAllocator _allocator;
+    LoadMode _mode;
 
     // Look up node type in database
-    std::string getNodeType(const std::string& uuid) {
+    std::string getNodeType(const std::string& uuid, pqxx::work& transaction) {
       std::string ret;
-      std::string cmd("SELECT node_type FROM node where id = $1");
       pqxx::params p{
         uuid
       };
-      pqxx::result res = _transaction.exec(cmd, p);
+      pqxx::result res = transaction.exec(pqxx::prepped{database::Statements<Node>::nodeType()}, p);
       if (res.size()) {
         for (auto const &row : res) {
           ret = row[0].as<std::string>();
@@ -219,8 +400,8 @@ namespace fr::RequirementsManager {
       return ret;
     }
 
-    Node::PtrType startLoading(std::string uuid) {
-      std::string nodeType = getNodeType(uuid);
+    Node::PtrType startLoading(std::string uuid, pqxx::work& transaction) {
+      std::string nodeType = getNodeType(uuid, transaction);
       Node::PtrType ret;
       if (!nodeType.empty()) {
         ret = _allocator.get(nodeType, uuid);
@@ -231,68 +412,130 @@ namespace fr::RequirementsManager {
       return ret;
     }
 
-    // Only add the node if it's not already in the list
-    void addToUpDown(std::vector<Node::PtrType>& upDown, Node::PtrType toAdd) {
-      bool found = false;
-      for (auto& node : upDown) {
-        if (node->idString() == toAdd->idString()) {
-          found = true;
-        }
-      }
-      if (!found) {
-        upDown.push_back(toAdd);
+    // Only add the node if it's not already in the list. This
+    // doesn't go through addUp/addDown -- loading an edge isn't a
+    // change to it.
+    void addToUpDown(Node::PtrType node, bool up, Node::PtrType toAdd) {
+      if (!toAdd) {
+        return;
       }
+      node->addNode(toAdd, up ? node->up : node->down);
     }
     
-    void process(Node::PtrType node) {
-      auto owner = this->getOwner();
-      // Dispatch node to be populated
+    // Queue node up to be loaded. Loaders are created at the end of run,
+    // once we know every node of each type.
+    void dispatch(Node::PtrType node) {
       _alreadyLoaded[node->idString()] = node;
-      auto worker = std::make_shared<PqNodeLoader<WorkerType>>(node);
-
-      // Forward worker loaded signal through the factory
-      worker->loaded.connect([&](const std::string& id, Node::PtrType n) {
-        this->loaded(id, n);        
-        // For done tracking -- workers will get enqueued at the end
-        // of processing after the whole node skeleton has been set up.
-        // At that point, _alreadyLoaded contains all the nodes that need
-        // to be loaded, so we can just erase them as we load them and
-        // when _alreadyLoaded.size() hits 0, we're done.
-        std::lock_guard<std::mutex> lock(_alreadyLoadedMutex);
-        _alreadyLoaded.erase(id);
-        if (graphLoaded()) {
-          done(_loadUuid);
+      _batches[node->getNodeType()].push_back(node);
+    }
+
+    // One loader per node type
+    std::vector<typename PqBatchNodeLoader<WorkerType>::PtrType> createLoaders() {
+      std::vector<typename PqBatchNodeLoader<WorkerType>::PtrType> ret;
+      for (auto& [batchType, nodes] : _batches) {
+        auto worker = std::make_shared<PqBatchNodeLoader<WorkerType>>(batchType, std::move(nodes), _pool);
+        worker->setPriority(this->getPriority());
+        // Forward worker loaded signal through the factory
+        worker->loaded.connect([&](const std::string& id, Node::PtrType n) {
+          this->loaded(id, n);
+          // For done tracking -- _alreadyLoaded contains all the nodes
+          // that need to be loaded, so we can just erase them as we load
+          // them and when _alreadyLoaded.size() hits 0, we're done.
+          std::lock_guard<std::mutex> lock(_alreadyLoadedMutex);
+          _alreadyLoaded.erase(id);
+          if (graphLoaded()) {
+            done(_loadUuid);
+          }
+        });
+        this->recordChild(worker);
+        ret.push_back(worker);
+      }
+      _batches.clear();
+      return ret;
+    }
+
+    // Load the skeleton one association query per node. This keeps its
+    // own stack of nodes to look at rather than recursing, since a
+    // long enough chain of nodes would run us out of stack.
+    void process(Node::PtrType start, pqxx::work& transaction) {
+      dispatch(start);
+      std::vector<Node::PtrType> pending{start};
+      while (!pending.empty()) {
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        // Iterate through the up/down lists from node_association, load
+        // and assemble the associated nodes.
+        pqxx::params p{
+          node->idString()
+        };
+        pqxx::result res = transaction.exec(pqxx::prepped{database::Statements<Node>::associations()}, p);
+        // Build out the skeleton of the nodes -- this sets up the
+        // structure but not the node data
+        for (auto const &row : res) {
+          auto association = row[0].as<std::string>();
+          auto assocType = row[1].as<std::string>();
+          Node::PtrType nextNode;
+          if(_alreadyLoaded.contains(association)) {
+            nextNode = _alreadyLoaded.at(association);
+          } else {
+            nextNode = startLoading(association, transaction);
+            if (nextNode) {
+              dispatch(nextNode);
+              pending.push_back(nextNode);
+            }
+          }
+          addToUpDown(node, assocType == "up", nextNode);
         }
-      });
-      
-      this->down.push_back(worker);
-      // Iterate through the up/down lists from node_association, load
-      // and assemble the associated nodes.
-      std::string cmd("select association,type from node_associations where id = $1;");
+      }
+    }
+
+    /**
+     * Fetch every node reachable from _loadUuid, along with its type
+     * and its associations, in one query (Statements<Node>::skeleton.)
+     * Edges are followed in both directions, just like process does.
+     *
+     * Nodes are allocated and dispatched as they're first seen and
+     * the up/down lists are built once everything has been allocated.
+     */
+    void loadSkeleton(pqxx::work& transaction) {
       pqxx::params p{
-        node->idString()
+        _loadUuid
+      };
+      pqxx::result res = transaction.exec(pqxx::prepped{database::Statements<Node>::skeleton()}, p);
+
+      struct Edge {
+        std::string from;
+        std::string to;
+        bool up;
       };
-      pqxx::result res = _transaction.exec(cmd,p);
-      // Build out the skeleton of the nodes -- this sets up the
-      // structure but not the node data
+      std::vector<Edge> edges;
+      edges.reserve(res.size());
+
       for (auto const &row : res) {
-        auto association = row[0].as<std::string>();
-        auto assocType = row[1].as<std::string>();
-        Node::PtrType nextNode;
-        if(_alreadyLoaded.contains(association)) {
-          nextNode = _alreadyLoaded.at(association);
-        } else {
-          nextNode = startLoading(association);
-          if (nextNode) {
-            process(nextNode);
+        auto id = row[0].as<std::string>();
+        if (!_alreadyLoaded.contains(id)) {
+          auto node = _allocator.get(row[1].as<std::string>(), id);
+          node->initted = true;
+          if (id == _loadUuid) {
+            _startingNode = node;
           }
+          dispatch(node);
         }
-        if (assocType == "up") {
-          addToUpDown(node->up, nextNode);
-        } else {
-          addToUpDown(node->down, nextNode);
+        if (!row[2].is_null()) {
+          edges.push_back({id, row[2].as<std::string>(), row[3].as<std::string>() == "up"});
         }
       }
+
+      for (auto const &edge : edges) {
+        // Associations to nodes that aren't in the node table don't
+        // show up in the join. The recursive mode skips those too.
+        auto to = _alreadyLoaded.find(edge.to);
+        if (to == _alreadyLoaded.end()) {
+          continue;
+        }
+        auto& from = _alreadyLoaded.at(edge.from);
+        addToUpDown(from, edge.up, to->second);
+      }
     }
 
   public:
@@ -300,10 +543,13 @@ namespace fr::RequirementsManager {
     fteng::signal<void(const std::string&, Node::PtrType)> loaded;
     fteng::signal<void(const std::string&)> done;
     
-    PqNodeFactory(const std::string& uuidToLoad) :
+    PqNodeFactory(const std::string& uuidToLoad,
+                  std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault(),
+                  LoadMode mode = LoadMode::Skeleton) :
       _loadUuid(uuidToLoad),
       _graphLoaded(false),
-      _transaction(_connection) {
+      _pool(pool),
+      _mode(mode) {
     }
 
     virtual ~PqNodeFactory() {
@@ -323,22 +569,63 @@ namespace fr::RequirementsManager {
         pool->startThreads(4);
       }
 
-      _startingNode = startLoading(_loadUuid);
-      if (_startingNode) {
-        process(_startingNode);
-      }
-      for (auto worker : this->down) {
-        auto workerNode = std::dynamic_pointer_cast<PqNodeLoader<WorkerType>>(worker);
-        if (workerNode) {
-          this->getOwner()->enqueue(workerNode);
+      {
+        // Give the connection back before the loaders start
+        // asking for theirs.
+        auto connection = database::PqStatements::acquire(_pool);
+        auto cancel = connection.cancelOn(this->getCancellation());
+        pqxx::work transaction(*connection);
+        if (_mode == LoadMode::Skeleton) {
+          loadSkeleton(transaction);
+        } else {
+          _startingNode = startLoading(_loadUuid, transaction);
+          if (_startingNode) {
+            process(_startingNode, transaction);
+          }
         }
       }
+      if (_alreadyLoaded.empty()) {
+        // Nothing by that ID in the database. Nobody else is going
+        // to say we're done, so we'd better.
+        _graphLoaded = true;
+        done(_loadUuid);
+        return;
+      }
+      // The loaders would only be skipped, but if we're out of time
+      // there's no point building them
+      this->throwIfCancelled();
+      for (auto worker : createLoaders()) {
+        this->getOwner()->enqueue(worker);
+      }
     }
 
     Node::PtrType getNode() {
       return _startingNode;
     }
 
+    LoadMode getLoadMode() const {
+      return _mode;
+    }
+
+    // Only takes effect if called before the factory runs
+    void setLoadMode(LoadMode mode) {
+      _mode = mode;
+    }
+
+    /**
+     * Allocate the graph's nodes from arena instead of the heap. The
+     * arena lives as long as any of the nodes do, so you don't need
+     * to hang on to it. Only takes effect if called before the
+     * factory runs.
+     */
+    void setArena(GraphArena::PtrType arena) {
+      _allocator.setArena(std::move(arena));
+    }
+
+    GraphArena::PtrType getArena() const {
+      return _allocator.getArena();
+    }
+
     bool graphLoaded() {
       // We need to check all the workers to see if they're done
       if (!_graphLoaded) {
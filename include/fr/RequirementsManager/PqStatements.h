@@ -0,0 +1,116 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/AllNodeTypes.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
+#include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/types/Concepts.h>
+#include <fr/types/Typelist.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fr::RequirementsManager::database {
+
+  /**
+   * The registry of prepared statements. It walks AllNodeTypes at
+   * compile time and gathers database::Statements<T>::all() for every
+   * type, plus the node-level statements in Statements<Node>.
+   *
+   * Database tasks borrow their connections with PqStatements::acquire
+   * instead of straight from the pool. The first time a connection is
+   * borrowed that way, everything in the registry gets prepared on it;
+   * after that it's one hash lookup per borrow. If you call the
+   * DbSpecificData methods yourself, get your connection the same
+   * way or call prepare on it first.
+   */
+
+  class PqStatements {
+    using NodeList = AllNodeTypes;
+    using StatementList = std::vector<std::pair<std::string, std::string>>;
+
+    template <typename List>
+    static void collect(StatementList& statements)
+    requires
+      (fr::types::IsTypelist<List> &&
+       fr::types::IsUnique<List>)
+    {
+      using CurrentType = List::head::type;
+      for (auto& statement : Statements<CurrentType>::all()) {
+        statements.push_back(std::move(statement));
+      }
+      if constexpr (!std::is_void_v<typename List::tail::head::type>) {
+        collect<typename List::tail>(statements);
+      }
+    }
+
+  public:
+
+    // Every statement name and its SQL. Built once.
+    static const StatementList& all() {
+      static const StatementList statements = [] {
+        StatementList ret = Statements<Node>::all();
+        collect<NodeList>(ret);
+        return ret;
+      }();
+      return statements;
+    }
+
+    // SQL for the statement called name. Throws std::logic_error if
+    // there's no such statement.
+    static const std::string& sql(const std::string& name) {
+      static const std::unordered_map<std::string, std::string> byName = [] {
+        std::unordered_map<std::string, std::string> ret;
+        for (auto& [statementName, statementSql] : all()) {
+          ret.emplace(statementName, statementSql);
+        }
+        return ret;
+      }();
+      auto found = byName.find(name);
+      if (found == byName.end()) {
+        throw std::logic_error("No prepared statement named " + name);
+      }
+      return found->second;
+    }
+
+    // Prepare everything in the registry on connection, unless
+    // that's already been done.
+    static void prepare(PooledConnection& connection) {
+      // The last one in the list only gets prepared once all the
+      // others have been
+      if (connection.isPrepared(all().back().first)) {
+        return;
+      }
+      for (auto& [name, sql] : all()) {
+        connection.prepare(name, sql);
+      }
+    }
+
+    // Borrow a connection from pool with all the statements prepared
+    static PooledConnection acquire(const std::shared_ptr<PqConnectionPool>& pool) {
+      auto connection = pool->acquire();
+      prepare(connection);
+      return connection;
+    }
+  };
+
+}
@@ -44,6 +44,10 @@ namespace fr::RequirementsManager {
     using Type = Product;
     using PtrType = std::shared_ptr<Type>;
     using Parent = CommitableNode;
+
+    // Fields in DbSpecificData<Product>::columns order, for markDirty
+    enum class Field { Title, Description };
+
     
     Product() = default;
     virtual ~Product() = default;
@@ -55,11 +59,13 @@ namespace fr::RequirementsManager {
     void setTitle(const std::string& title) {
       throwIfCommitted();
       _title = title;
+      markDirty(Field::Title);
     }
 
     void setDescription(const std::string& description) {
       throwIfCommitted();
       _description = description;
+      markDirty(Field::Description);
     }
 
     std::string getTitle() const {
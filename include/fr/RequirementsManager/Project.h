@@ -39,6 +39,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Project>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Project>::columns order, for markDirty
+    enum class Field { Name, Description };
+
   private:
     // Project Name
     std::string _name;
@@ -60,10 +63,12 @@ namespace fr::RequirementsManager {
     
     void setName(const std::string &name) {
       _name = name;
+      markDirty(Field::Name);
     }
 
     void setDescription(const std::string &description) {
       _description = description;
+      markDirty(Field::Description);
     }
 
     std::string getName() const {
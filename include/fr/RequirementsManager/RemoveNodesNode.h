@@ -19,7 +19,9 @@
 #include <fr/RequirementsManager/AllNodeTypes.h>
 #include <format>
 #include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/PqConnectionPool.h>
 #include <fr/RequirementsManager/PqDatabaseSpecific.h>
+#include <fr/RequirementsManager/PqStatements.h>
 #include <fr/RequirementsManager/Node.h>
 #include <fr/RequirementsManager/TaskNode.h>
 #include <fr/RequirementsManager/ThreadPool.h>
@@ -35,6 +37,26 @@
 
 namespace fr::RequirementsManager {
 
+  /**
+   * How RemoveNodesNode finds what to remove.
+   *
+   * ByRoot asks the database for everything reachable from the
+   * nodes you gave it (or the ids you added with addRoot) with one
+   * recursive query, then deletes it all with one DELETE per table
+   * involved. The graph doesn't need to be loaded for this and the
+   * number of statements doesn't depend on the size of the graph.
+   * ByRoot is the default.
+   *
+   * Traverse walks the in-memory graph of each node you gave it and
+   * deletes the nodes it finds one at a time. Use it if the graph
+   * in memory has nodes the database doesn't know are connected.
+   */
+
+  enum class RemoveMode {
+    Traverse,
+    ByRoot
+  };
+
   /**
    * This is a node that removes nodes and graphs from a
    * database.
@@ -56,48 +78,142 @@ namespace fr::RequirementsManager {
   template <typename WorkerThreadType>
   class RemoveNodesNode : public TaskNode<WorkerThreadType> {
     using RemovableTypes = AllNodeTypes;
-    pqxx::connection _connection;
-    pqxx::work _transaction;
+    std::shared_ptr<database::PqConnectionPool> _pool;
 
     /**
      * Indicates this node has exited its run method
      */
     bool _removeComplete;
 
+    RemoveMode _mode;
+
+    // Ids added with addRoot
+    std::vector<std::string> _roots;
+
+    // Number of node rows the last run deleted in ByRoot mode
+    size_t _removed;
+
+    // Delete the rows in each type table for the ids in byType
     template <typename List>
-    constexpr void removeData(std::shared_ptr<Node> node)
+    void removeTypes(const std::unordered_map<std::string, std::vector<std::string>>& byType,
+                     pqxx::work& transaction)
+      requires fr::types::IsUnique<List> {
+      using currentType = List::head::type;
+      auto found = byType.find(database::DbSpecificData<currentType>::name);
+      if (found != byType.end()) {
+        pqxx::params p{
+          found->second
+        };
+        transaction.exec(pqxx::prepped{database::Statements<currentType>::removeBatch()}, p);
+      }
+      if constexpr(!std::is_void_v<typename List::tail::head::type>) {
+        removeTypes<typename List::tail>(byType, transaction);
+      }
+    }
+
+    void removeByRoot(pqxx::work& transaction) {
+      std::vector<std::string> roots(_roots);
+      for (auto& node : this->down) {
+        roots.push_back(node->idString());
+      }
+      if (roots.empty()) {
+        return;
+      }
+      pqxx::params p{
+        roots
+      };
+      pqxx::result res = transaction.exec(pqxx::prepped{database::Statements<Node>::reachable()}, p);
+      if (res.empty()) {
+        return;
+      }
+      std::vector<std::string> ids;
+      std::unordered_map<std::string, std::vector<std::string>> byType;
+      ids.reserve(res.size());
+      for (auto const &row : res) {
+        auto id = row[0].as<std::string>();
+        byType[row[1].as<std::string>()].push_back(id);
+        ids.push_back(std::move(id));
+      }
+      removeTypes<RemovableTypes>(byType, transaction);
+      pqxx::params all{
+        ids
+      };
+      transaction.exec(pqxx::prepped{database::Statements<Node>::removeAssociationsBatch()}, all);
+      transaction.exec(pqxx::prepped{database::Statements<Node>::removeBatch()}, all);
+      _removed = ids.size();
+    }
+
+    template <typename List>
+    constexpr void removeData(std::shared_ptr<Node> node, pqxx::work& transaction)
       requires fr::types::IsUnique<List> {
       using currentType = List::head::type;
       std::shared_ptr<currentType> tryPtr = std::dynamic_pointer_cast<currentType>(node);
       if (tryPtr) {
         database::DbSpecificData<currentType> remover;
-        remover.remove(tryPtr, _transaction);
+        remover.remove(tryPtr, transaction);
       } else {
         if constexpr(!std::is_void_v<typename List::tail::head::type>) {
-          removeData<typename List::tail>(node);
+          removeData<typename List::tail>(node, transaction);
         }
       }
     }
     
   public:
 
-    RemoveNodesNode() : _removeComplete(false), _transaction(_connection) {}
+    RemoveNodesNode(std::shared_ptr<database::PqConnectionPool> pool = database::PqConnectionPool::getDefault(),
+                    RemoveMode mode = RemoveMode::ByRoot) :
+      _pool(pool),
+      _removeComplete(false),
+      _mode(mode),
+      _removed(0) {}
     virtual ~RemoveNodesNode() {}
+
+    /**
+     * Remove everything reachable from uuid in the database. You
+     * don't need to load the graph to do this. Only used in ByRoot
+     * mode.
+     */
+    void addRoot(const std::string& uuid) {
+      _roots.push_back(uuid);
+    }
     
     void run() override {
       if (!this->initted) {
         this->init();
       }
 
-      for (auto node : this->down) {
-        node->traverse([&](std::shared_ptr<Node> n){
-          std::cout << "Remove " << n->idString() << std::endl;
-          this->removeData<RemovableTypes>(n);
-        });
+      auto connection = database::PqStatements::acquire(_pool);
+      pqxx::work transaction(*connection);
+      if (_mode == RemoveMode::ByRoot) {
+        removeByRoot(transaction);
+      } else {
+        // One traversal for all of them, so nodes they share only
+        // get removed once
+        Traversal<Node> traversal;
+        for (auto node : this->down) {
+          traversal.run(node, [&](const Node::PtrType& n) {
+            this->removeData<RemovableTypes>(n, transaction);
+          });
+        }
       }
+      transaction.commit();
 
       _removeComplete = true;
     }
+
+    RemoveMode getRemoveMode() const {
+      return _mode;
+    }
+
+    // Only takes effect if called before the remover runs
+    void setRemoveMode(RemoveMode mode) {
+      _mode = mode;
+    }
+
+    // Number of nodes the last ByRoot run removed
+    size_t removed() const {
+      return _removed;
+    }
     
   };
   
@@ -42,6 +42,10 @@ namespace fr::RequirementsManager {
     using Type = Requirement;
     using PtrType = std::shared_ptr<Type>;
     using Parent = CommitableNode;
+
+    // Fields in DbSpecificData<Requirement>::columns order, for markDirty
+    enum class Field { Title, Text, Functional };
+
     template <typename T> friend std::shared_ptr<T> getChangeNode(std::shared_ptr<T> node);
 
   private:
@@ -68,18 +72,21 @@ namespace fr::RequirementsManager {
     void setTitle(const std::string& title) {
       throwIfCommitted();
       _title = title;
+      markDirty(Field::Title);
     }
     // Sets the text of the requirement -- will refuse to do so if the
     // requirement is committed
     void setText(const std::string& text) {
       throwIfCommitted();
       _text = text;
+      markDirty(Field::Text);
     }
     // Sets the functional flag -- will refuse to do so if the requirement
     // is committed
     void setFunctional(bool functional) {
       throwIfCommitted();
       _functional = functional;
+      markDirty(Field::Functional);
     }
 
     // Getters and setters since we want to restrict when we can change the
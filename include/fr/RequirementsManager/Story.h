@@ -40,6 +40,10 @@ namespace fr::RequirementsManager {
     using Type = Story;
     using Parent = CommitableNode;
     using PtrType = std::shared_ptr<Type>;
+
+    // Fields in DbSpecificData<Story>::columns order, for markDirty
+    enum class Field { Title, Goal, Benefit };
+
     
     Story() = default;
     virtual ~Story() = default;
@@ -55,6 +59,7 @@ namespace fr::RequirementsManager {
     void setTitle(const std::string& title) {
       throwIfCommitted();
       _title = title;
+      markDirty(Field::Title);
     }
     
     std::string getGoal() const {
@@ -64,6 +69,7 @@ namespace fr::RequirementsManager {
     void setGoal(const std::string &goal) {
       throwIfCommitted();
       _goal = goal;
+      markDirty(Field::Goal);
     }
 
     std::string getBenefit() const {
@@ -73,6 +79,7 @@ namespace fr::RequirementsManager {
     void setBenefit(const std::string &benefit) {
       throwIfCommitted();
       _benefit = benefit;
+      markDirty(Field::Benefit);
     }
 
     template <class Archive>
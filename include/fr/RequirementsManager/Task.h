@@ -0,0 +1,179 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The part of a task the thread pool actually needs.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <fr/RequirementsManager/CancellationToken.h>
+#include <fr/RequirementsManager/TaskHandle.h>
+
+namespace fr::RequirementsManager {
+
+  template <typename WorkerType>
+  class ThreadPool;
+
+  /**
+   * How urgently a task should run. ThreadPool keeps a queue per
+   * priority and runs Interactive work first, then Normal, then
+   * Bulk. Tasks that have been waiting a while get bumped up (see
+   * ThreadPool::setAgingInterval) so a steady stream of interactive
+   * requests can't starve bulk work forever.
+   */
+
+  enum class TaskPriority {
+    Interactive,
+    Normal,
+    Bulk
+  };
+
+  constexpr size_t taskPriorityCount = 3;
+
+  /**
+   * Anything ThreadPool can run. This is just the scheduling state
+   * -- owner, handle, priority and group -- and a run method.
+   *
+   * TaskNode is one of these that's also a graph Node, which is
+   * handy for the database tasks that want a UUID and a down list
+   * to show what they did. If you don't need that, LightTask (or
+   * ThreadPool::submit) runs a function without any of the Node
+   * overhead.
+   */
+
+  template <typename WorkerType>
+  class Task {
+    // Threadpool this task gets assigned to
+    // Threadpool will set this when the task
+    // is assigned.
+    std::shared_ptr<ThreadPool<WorkerType>> _owner;
+    // Set by the threadpool when the task is enqueued. See TaskHandle.
+    std::shared_ptr<TaskCompletion> _completion;
+    TaskPriority _priority = TaskPriority::Normal;
+    // ThreadPool shares workers out fairly between groups
+    std::string _group;
+    // Invalid unless someone set one or ThreadPool::enqueue passed
+    // down the enqueuing task's
+    CancellationToken _cancellation;
+
+  public:
+    using Type = Task<WorkerType>;
+    using PtrType = std::shared_ptr<Type>;
+
+    Task() {}
+    virtual ~Task() {}
+
+    virtual void run() = 0;
+
+    // ThreadPool::enqueue calls this before the task goes on the
+    // queue
+    virtual void prepare() {}
+
+    /**
+     * The group a task goes in if nobody set one and it isn't
+     * enqueued from inside another task. Every task gets a group of
+     * its own by default.
+     */
+    virtual std::string defaultGroup() {
+      static std::atomic<size_t> next = 0;
+      return "#" + std::to_string(next++);
+    }
+
+    // What ThreadPool::metrics files this task's timings under
+    virtual std::string taskType() const {
+      return "Task";
+    }
+
+    /**
+     * ThreadPool calls this instead of run when the task's token was
+     * cancelled before it got a worker. Let go of anything the task
+     * would have cleaned up in run.
+     */
+    virtual void abandon() {}
+
+    std::shared_ptr<ThreadPool<WorkerType>> getOwner() const {
+      return _owner;
+    }
+
+    void setOwner(std::shared_ptr<ThreadPool<WorkerType>> owner) {
+      _owner = owner;
+    }
+
+    TaskPriority getPriority() const {
+      return _priority;
+    }
+
+    // Takes effect the next time the task is enqueued
+    void setPriority(TaskPriority priority) {
+      _priority = priority;
+    }
+
+    std::string getGroup() const {
+      return _group;
+    }
+
+    /**
+     * Set the group this task is scheduled in. If you don't set one,
+     * ThreadPool::enqueue does: a task enqueued from inside another
+     * task joins that task's group, and anything else starts a group
+     * of its own (see defaultGroup).
+     */
+    void setGroup(const std::string& group) {
+      _group = group;
+    }
+
+    std::shared_ptr<TaskCompletion> getCompletion() const {
+      return _completion;
+    }
+
+    void setCompletion(std::shared_ptr<TaskCompletion> completion) {
+      _completion = completion;
+    }
+
+    CancellationToken getCancellation() const {
+      return _cancellation;
+    }
+
+    /**
+     * Set this before enqueueing the task. Tasks it enqueues while it
+     * runs get the same token unless they already have one, so
+     * cancelling it cancels everything the task started.
+     */
+    void setCancellation(CancellationToken cancellation) {
+      _cancellation = std::move(cancellation);
+    }
+
+    bool cancelled() const {
+      return _cancellation.cancelled();
+    }
+
+    // Long running tasks can call this every so often to give up
+    // early
+    void throwIfCancelled() const {
+      _cancellation.throwIfCancelled();
+    }
+
+    // Handle for the last time this task was enqueued
+    TaskHandle handle() const {
+      return TaskHandle(_completion);
+    }
+  };
+
+}
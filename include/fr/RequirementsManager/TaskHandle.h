@@ -0,0 +1,242 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Shared state behind a TaskHandle.
+   *
+   * A completion starts out with one outstanding piece of work (the
+   * task itself). Anything else that has to finish first -- tasks
+   * the task enqueues while it's running, or the handles passed to
+   * whenAll -- adds one with hold and gives it back with release.
+   * When the count gets to zero the completion is done: waiters wake
+   * up, continuations run and the parent (if there is one) gets its
+   * own release.
+   */
+
+  class TaskCompletion : public std::enable_shared_from_this<TaskCompletion> {
+  public:
+    using Type = TaskCompletion;
+    using PtrType = std::shared_ptr<Type>;
+
+  private:
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _condition;
+    size_t _pending;
+    bool _done;
+    // First error from this task or anything below it
+    std::exception_ptr _error;
+    std::vector<std::function<void()>> _continuations;
+    PtrType _parent;
+
+  public:
+
+    TaskCompletion(PtrType parent = nullptr) :
+      _pending(1),
+      _done(false),
+      _parent(parent) {
+      if (_parent) {
+        _parent->hold();
+      }
+    }
+
+    ~TaskCompletion() = default;
+
+    // One more thing has to finish before this is done
+    void hold() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_pending;
+    }
+
+    // One thing finished, possibly with an error
+    void release(std::exception_ptr error = nullptr) {
+      std::vector<std::function<void()>> continuations;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (error && !_error) {
+          _error = error;
+        }
+        if (--_pending > 0) {
+          return;
+        }
+        _done = true;
+        continuations.swap(_continuations);
+      }
+      _condition.notify_all();
+      for (auto& continuation : continuations) {
+        continuation();
+      }
+      if (_parent) {
+        auto parent = std::move(_parent);
+        parent->release(this->error());
+      }
+    }
+
+    bool done() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _done;
+    }
+
+    std::exception_ptr error() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _error;
+    }
+
+    void wait() const {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock, [this]() { return _done; });
+    }
+
+    bool waitFor(std::chrono::milliseconds timeout) const {
+      std::unique_lock<std::mutex> lock(_mutex);
+      return _condition.wait_for(lock, timeout, [this]() { return _done; });
+    }
+
+    // Run continuation once this is done. Runs it right away if
+    // it already is.
+    void onDone(std::function<void()> continuation) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_done) {
+          _continuations.push_back(std::move(continuation));
+          return;
+        }
+      }
+      continuation();
+    }
+
+    /**
+     * The completion of the task running on this thread, if there is
+     * one. ThreadPool sets this while a task runs so anything the task
+     * enqueues becomes part of its subtree.
+     */
+    static PtrType& current() {
+      static thread_local PtrType completion;
+      return completion;
+    }
+  };
+
+  /**
+   * What ThreadPool::enqueue gives you back.
+   *
+   * The handle is done once the task's run method has returned *and*
+   * every task it enqueued while it was running (and every task
+   * those enqueued, and so on) is done. So a SaveNodesNode's handle
+   * completes once every node in the graph has been saved and a
+   * PqNodeFactory's once every node has been loaded, no matter how
+   * many child tasks they split the work into.
+   *
+   * If a task in the subtree throws, the handle still completes
+   * and wait rethrows the first exception.
+   */
+
+  class TaskHandle {
+    TaskCompletion::PtrType _completion;
+
+  public:
+    using Type = TaskHandle;
+
+    TaskHandle() = default;
+    TaskHandle(TaskCompletion::PtrType completion) : _completion(completion) {}
+
+    // False for a default-constructed handle
+    bool valid() const {
+      return static_cast<bool>(_completion);
+    }
+
+    bool done() const {
+      return !_completion || _completion->done();
+    }
+
+    // Block until done. Rethrows the first exception from the subtree.
+    void wait() const {
+      if (!_completion) {
+        return;
+      }
+      _completion->wait();
+      if (auto error = _completion->error()) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    // Block until done or timeout. Returns true if it's done. Doesn't throw.
+    bool waitFor(std::chrono::milliseconds timeout) const {
+      return !_completion || _completion->waitFor(timeout);
+    }
+
+    std::exception_ptr error() const {
+      return _completion ? _completion->error() : nullptr;
+    }
+
+    /**
+     * Run continuation when this is done and return a handle for
+     * that. The continuation runs on whichever thread finishes the
+     * last piece of work (or right here if it's already done), so
+     * keep it short or enqueue something from it. It gets this
+     * handle so it can check for an error.
+     */
+    TaskHandle then(std::function<void(const TaskHandle&)> continuation) const {
+      auto next = std::make_shared<TaskCompletion>();
+      TaskHandle self(*this);
+      auto run = [next, self, continuation]() {
+        std::exception_ptr error;
+        try {
+          continuation(self);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        next->release(error);
+      };
+      if (_completion) {
+        _completion->onDone(run);
+      } else {
+        run();
+      }
+      return TaskHandle(next);
+    }
+
+    // A handle that's done once every handle in handles is
+    static TaskHandle whenAll(const std::vector<TaskHandle>& handles) {
+      auto all = std::make_shared<TaskCompletion>();
+      for (auto& handle : handles) {
+        if (!handle._completion) {
+          continue;
+        }
+        all->hold();
+        auto completion = handle._completion;
+        completion->onDone([all, completion]() {
+          all->release(completion->error());
+        });
+      }
+      // Let go of the initial hold now that everything's registered
+      all->release();
+      return TaskHandle(all);
+    }
+  };
+
+}
@@ -19,22 +19,23 @@
 #pragma once
 
 #include <fr/RequirementsManager/Node.h>
+#include <fr/RequirementsManager/Task.h>
 
 namespace fr::RequirementsManager {
 
-  template <typename WorkerType>
-  class ThreadPool;
-  
   // A task node is a generic node that can be run by a thread
   // pool. I need to make it a template so I can pass WorkerType on
   // to threadpool instances
+  //
+  // Being a Node costs a mutex, the up and down lists and a UUID
+  // generated every time one's enqueued. That's fine for a task that
+  // loads or saves a whole graph, but for tiny ones look at
+  // LightTask instead.
   template <typename WorkerType>
-  class TaskNode : public Node {
+  class TaskNode : public Node, public Task<WorkerType> {
     std::string _name;
-    // Threadpool this task gets assigned to
-    // Threadpool will set this when the task
-    // is assigned.
-    std::shared_ptr<ThreadPool<WorkerType>> _owner;
+    // Keep child tasks in the down list. See setAuditTrail.
+    bool _auditTrail = false;
     
   public:
     using Type = TaskNode;
@@ -44,8 +45,6 @@ namespace fr::RequirementsManager {
     TaskNode() {}
     virtual ~TaskNode() {}
 
-    virtual void run() = 0;
-    
     std::string getNodeType() const override {
       return "TaskNode";
     }
@@ -58,14 +57,54 @@ namespace fr::RequirementsManager {
       _name = name;
     }
 
-    std::shared_ptr<ThreadPool<WorkerType>> getOwner() const {
-      return _owner;
+    // Tasks need an ID to be told apart, so get one before we're
+    // queued
+    void prepare() override {
+      if (!initted) {
+        init();
+      }
+    }
+
+    std::string taskType() const override {
+      return getNodeType();
     }
 
-    void setOwner(std::shared_ptr<ThreadPool<WorkerType>> owner) {
-      _owner = owner;
+    // A task's group is named after it unless it's told otherwise
+    std::string defaultGroup() override {
+      prepare();
+      return idString();
     }
 
+    bool getAuditTrail() const {
+      return _auditTrail;
+    }
+
+    /**
+     * With the audit trail on, tasks that split their work up
+     * (SaveNodesNode, PqNodeFactory and friends) keep every child
+     * task they create in their down list so you can go poke at what
+     * they did afterwards. It's off by default, since a 10k node save
+     * would otherwise keep 10k finished tasks around for as long as
+     * you hold on to the first one. Use handle() to find out when the
+     * whole lot is done instead. Children get the setting from their
+     * parent.
+     */
+    void setAuditTrail(bool auditTrail) {
+      _auditTrail = auditTrail;
+    }
+
+  protected:
+
+    // Call with each child task before enqueueing it
+    void recordChild(PtrType child) {
+      child->setAuditTrail(_auditTrail);
+      if (_auditTrail) {
+        down.push_back(child);
+      }
+    }
+
+  public:
+
     template <class Archive>
     void save(Archive &ar) const {
       ar(cereal::make_nvp(Parent::getNodeType(), cereal::base_class<Parent>(this)));
@@ -16,11 +16,26 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <list>
+#include <deque>
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fr/RequirementsManager/FairQueue.h>
+#include <fr/RequirementsManager/LightTask.h>
+#include <fr/RequirementsManager/PoolMetrics.h>
+#include <fr/RequirementsManager/TaskHandle.h>
+#include <fr/RequirementsManager/Task.h>
 #include <fr/RequirementsManager/TaskNode.h>
 
 namespace fr::RequirementsManager {
@@ -42,12 +57,182 @@ namespace fr::RequirementsManager {
     Shutdown
   };
 
-  // Theadpool for handling database requests. Submit TaskNodes for threadpool
-  // to process.
+  /**
+   * How a ThreadPool hands out its tasks.
+   *
+   * SharedQueue keeps every task in one list behind one mutex and
+   * runs them in the order they were enqueued. That's the original
+   * behavior and it's still the default.
+   *
+   * WorkStealing gives every worker its own deque. Tasks enqueued
+   * from inside a running task (SaveNodesNode's per-node savers,
+   * PqNodeFactory's loaders) go on the deque of the worker that's
+   * running it, and that worker takes them back newest first. Tasks
+   * enqueued from anywhere else go in a shared injection queue. A
+   * worker with nothing in its own deque takes from the injection
+   * queue, and if that's empty too it steals the oldest task from
+   * another worker's deque. Workers mostly only touch their own
+   * deque's mutex, so there's no single lock for all of them to
+   * fight over.
+   *
+   * In both modes the shared queue is really one queue per
+   * TaskPriority. In WorkStealing mode Interactive tasks always go
+   * in the shared queue, even from inside a worker, and workers
+   * check for them before they look at their own deque. The
+   * worker deques themselves don't age.
+   *
+   * Within each priority, the shared queue takes turns between task
+   * groups (see Task::setGroup and FairQueue) rather than going
+   * strictly in order, so one huge graph load can't hold up a small
+   * one that was enqueued after it. Groups can be given a weight
+   * and a concurrency limit. In WorkStealing mode tasks from a group
+   * with a limit always go through the shared queue so the limit
+   * holds.
+   */
+
+  enum class SchedulerMode {
+    SharedQueue,
+    WorkStealing
+  };
+
+  /**
+   * What enqueue does when the pool already has its capacity's
+   * worth of tasks waiting (see ThreadPool::setCapacity).
+   *
+   * Block waits until a worker takes something off the queue.
+   * Reject throws QueueFullError right away. DropLowest throws
+   * out the newest queued task at the least urgent priority below
+   * the new task's to make room for it -- the dropped task's
+   * handle completes with a QueueFullError -- and rejects the new
+   * task if there's nothing less urgent than it waiting.
+   */
+
+  enum class OverflowPolicy {
+    Block,
+    Reject,
+    DropLowest
+  };
+
+  // Thrown from enqueue (or handed to a dropped task's handle)
+  // when the queue's full
+  class QueueFullError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+   * Sizing for ThreadPool::startElastic. The pool starts minThreads
+   * workers and a supervisor thread. Whenever the oldest task in the
+   * queues has been waiting longer than targetWait and nobody's
+   * idle, the supervisor adds a worker, up to maxThreads. A worker
+   * that's had nothing to do for idleTimeout retires, as long as
+   * that leaves at least minThreads.
+   */
+
+  struct ElasticSettings {
+    unsigned int minThreads = 1;
+    unsigned int maxThreads = 8;
+    std::chrono::milliseconds targetWait{50};
+    std::chrono::milliseconds idleTimeout{30000};
+  };
+
+  // Theadpool for handling database requests. Submit TaskNodes (or
+  // any other Task) for threadpool to process.
   //
   template <typename WorkerThreadType>
   class ThreadPool : public std::enable_shared_from_this<ThreadPool<WorkerThreadType>> {
     using ThreadPtr = std::shared_ptr<std::thread>;
+    using TaskPtr = std::shared_ptr<Task<WorkerThreadType>>;
+    using Clock = std::chrono::steady_clock;
+
+    // A task waiting in one of the queues. The priority is copied
+    // at enqueue time so the depth counts stay right if somebody
+    // changes it while it's queued.
+    struct QueuedTask {
+      TaskPtr task;
+      TaskPriority priority = TaskPriority::Normal;
+      Clock::time_point enqueued;
+      // Set when this came out of a group with a limit. The group
+      // gets its slot back when the task finishes.
+      std::string limitedGroup;
+    };
+
+    // One worker's deque in WorkStealing mode
+    struct LocalQueue {
+      std::mutex mutex;
+      std::deque<QueuedTask> tasks;
+      // Set once a worker thread has claimed this queue
+      bool claimed = false;
+    };
+
+    // The local queue of the worker thread we're running on, if
+    // it's one of ours
+    struct WorkerSlot {
+      const ThreadPool* pool = nullptr;
+      LocalQueue* queue = nullptr;
+      size_t index = 0;
+    };
+
+    static WorkerSlot& currentSlot() {
+      static thread_local WorkerSlot slot;
+      return slot;
+    }
+
+    // What the calling thread is running right now. requestWork
+    // fills in limitedGroup and runTask hands it back.
+    struct Running {
+      const ThreadPool* pool = nullptr;
+      TaskPtr task;
+      std::string limitedGroup;
+      // When it went on the queue, for the wait time metrics
+      Clock::time_point enqueued;
+    };
+
+    static Running& running() {
+      static thread_local Running current;
+      return current;
+    }
+
+    /**
+     * Metrics for one thread that runs tasks. Only that thread
+     * writes to it, so the mutex is only ever contended when somebody
+     * calls metrics().
+     */
+    struct WorkerStats {
+      std::mutex mutex;
+      std::unordered_map<std::string, TaskTypeMetrics> types;
+      uint64_t tasks = 0;
+      Clock::duration busy{};
+      Clock::time_point since = Clock::now();
+    };
+
+    // The calling thread's stats. Pools get a serial number rather
+    // than going by address, since a new pool can turn up where an
+    // old one used to be.
+    struct StatsSlot {
+      uint64_t pool = 0;
+      WorkerStats* stats = nullptr;
+    };
+
+    static StatsSlot& statsSlot() {
+      static thread_local StatsSlot slot;
+      return slot;
+    }
+
+    WorkerStats& workerStats() {
+      auto& slot = statsSlot();
+      if (slot.pool != _serial) {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        _workerStats.push_back(std::make_unique<WorkerStats>());
+        slot = {_serial, _workerStats.back().get()};
+      }
+      return *slot.stats;
+    }
+
+    static uint64_t nextSerial() {
+      static std::atomic<uint64_t> serial = 1;
+      return serial++;
+    }
 
     // Used to block threads until work is available. This will
     // be passed to worker threads.
@@ -65,14 +250,290 @@ namespace fr::RequirementsManager {
     std::atomic<bool> _shutdown;
     // General threadpool state
     std::atomic<ThreadState> _state;
-    // Storage for threads
+    // Storage for threads. Guarded by _threadsMutex, since in
+    // elastic mode the supervisor adds to it and workers take
+    // themselves out of it.
     std::vector<typename WorkerThreadType::PtrType> _threads;
-    // Storage for tasks
-    std::list<std::shared_ptr<TaskNode<WorkerThreadType>>> _work;
+    // Workers that have retired but haven't been joined yet
+    std::vector<typename WorkerThreadType::PtrType> _retired;
+    std::mutex _threadsMutex;
+    // See startElastic
+    std::atomic<bool> _elastic;
+    ElasticSettings _elasticSettings;
+    std::thread _supervisor;
+    std::mutex _superviseMutex;
+    std::condition_variable _superviseCondition;
+    std::atomic<uint64_t> _grown;
+    std::atomic<uint64_t> _retiredCount;
+    // Storage for tasks, one lane per TaskPriority and a fair
+    // round robin between groups inside each lane. In WorkStealing
+    // mode this is the injection queue.
+    FairQueue<QueuedTask, taskPriorityCount> _work;
+    // Tasks in _work that are waiting on their group's limit, and
+    // whether any group has a limit at all. Both mirror _work so
+    // workers can check them without the lock.
+    std::atomic<size_t> _blocked;
+    std::atomic<bool> _hasLimits;
+    // See popInjected
+    std::atomic<Clock::duration> _agingInterval;
+    // Last time each priority jumped the line. Guarded by _workMutex.
+    std::array<Clock::time_point, taskPriorityCount> _lastAged;
+    // Tasks waiting at each priority, in any queue
+    std::array<std::atomic<size_t>, taskPriorityCount> _depths;
+
+    SchedulerMode _mode;
+    // One per worker in WorkStealing mode. Workers claim theirs
+    // the first time they ask for work. _queuesMutex is only held
+    // exclusively while queues are added.
+    std::vector<std::unique_ptr<LocalQueue>> _queues;
+    mutable std::shared_mutex _queuesMutex;
+    // Tasks waiting in any queue. This lets hasWork answer without
+    // taking any locks.
+    std::atomic<size_t> _queued;
+    // Most tasks enqueue will let wait from outside the pool. 0 is
+    // no limit.
+    std::atomic<size_t> _capacity;
+    std::atomic<OverflowPolicy> _overflowPolicy;
+    // Blocked enqueues wait on this with _workMutex
+    std::condition_variable _spaceCondition;
+    // See metrics
+    const uint64_t _serial;
+    std::atomic<bool> _metricsEnabled;
+    std::atomic<size_t> _maxQueued;
+    std::vector<std::unique_ptr<WorkerStats>> _workerStats;
+    // What workers that have retired did
+    WorkerStats _retiredStats;
+    std::mutex _statsMutex;
+    Clock::time_point _statsSince;
+
+    void countQueued() {
+      auto queued = ++_queued;
+      auto max = _maxQueued.load();
+      while (queued > max && !_maxQueued.compare_exchange_weak(max, queued)) {
+      }
+    }
+
+    // The calling thread's local queue, claiming one if this is the
+    // first time a worker thread has asked. Returns nullptr for
+    // threads that aren't ours.
+    LocalQueue* localQueue(bool claim) {
+      auto& slot = currentSlot();
+      if (slot.pool == this) {
+        return slot.queue;
+      }
+      if (!claim) {
+        return nullptr;
+      }
+      std::unique_lock lock(_queuesMutex);
+      for (size_t i = 0; i < _queues.size(); ++i) {
+        if (!_queues[i]->claimed) {
+          _queues[i]->claimed = true;
+          slot = {this, _queues[i].get(), i};
+          return slot.queue;
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Take the next task from the shared queues. Normally that's
+     * the next one in the group round robin for the most urgent
+     * priority that has anything in it. The exception is aging: if
+     * the next task at a less urgent priority has been waiting
+     * longer than the aging interval, it goes first -- but each
+     * priority only gets to jump the line once per aging interval.
+     * That way a big backlog of bulk work keeps moving without
+     * getting in front of every interactive request that shows up
+     * behind it.
+     */
+    QueuedTask popInjected() {
+      QueuedTask ret;
+      std::lock_guard<std::mutex> lock(*_workMutex);
+      auto interval = _agingInterval.load();
+      size_t pick = taskPriorityCount;
+      if (interval.count() > 0) {
+        auto now = Clock::now();
+        for (size_t i = taskPriorityCount - 1; i > 0; --i) {
+          auto front = _work.front(i);
+          if (front &&
+              now - front->enqueued >= interval &&
+              now - _lastAged[i] >= interval) {
+            _lastAged[i] = now;
+            pick = i;
+            break;
+          }
+        }
+      }
+      for (size_t i = 0; pick == taskPriorityCount && i < taskPriorityCount; ++i) {
+        if (_work.front(i)) {
+          pick = i;
+        }
+      }
+      std::string group;
+      if (pick < taskPriorityCount && _work.pop(ret, group, pick)) {
+        if (_work.getSettings(group).limit > 0) {
+          ret.limitedGroup = group;
+        }
+        _blocked = _work.blocked();
+      }
+      return ret;
+    }
+
+    QueuedTask popLocal(LocalQueue& local, bool newest) {
+      QueuedTask ret;
+      std::lock_guard<std::mutex> lock(local.mutex);
+      if (!local.tasks.empty()) {
+        if (newest) {
+          ret = std::move(local.tasks.back());
+          local.tasks.pop_back();
+        } else {
+          ret = std::move(local.tasks.front());
+          local.tasks.pop_front();
+        }
+      }
+      return ret;
+    }
+
+    // Take the oldest task from some other worker's deque, starting
+    // with the one after ours so thieves spread out
+    QueuedTask steal(size_t start) {
+      std::shared_lock lock(_queuesMutex);
+      size_t count = _queues.size();
+      for (size_t i = 1; i <= count; ++i) {
+        auto ret = popLocal(*_queues[(start + i) % count], false);
+        if (ret.task) {
+          return ret;
+        }
+      }
+      return {};
+    }
+
+    QueuedTask requestStolenWork() {
+      LocalQueue* local = localQueue(true);
+      QueuedTask ret;
+      // Interactive work only ever sits in the shared queue
+      if (depth(TaskPriority::Interactive) > 0) {
+        ret = popInjected();
+      }
+      if (!ret.task && local) {
+        ret = popLocal(*local, true);
+      }
+      if (!ret.task) {
+        ret = popInjected();
+      }
+      if (!ret.task) {
+        ret = steal(local ? currentSlot().index : 0);
+      }
+      return ret;
+    }
+
+    std::atomic<size_t>& depthCounter(TaskPriority priority) {
+      return _depths[static_cast<size_t>(priority)];
+    }
+
+    // Start one more worker. Returns false if we're shutting down.
+    bool addWorker() {
+      std::lock_guard<std::mutex> lock(_threadsMutex);
+      if (_shutdown) {
+        return false;
+      }
+      if (_mode == SchedulerMode::WorkStealing) {
+        // Its queue has to exist before it asks for it
+        std::unique_lock queuesLock(_queuesMutex);
+        if (_queues.size() < _threads.size() + 1) {
+          _queues.push_back(std::make_unique<LocalQueue>());
+        }
+      }
+      _threads.push_back(std::make_shared<WorkerThreadType>(this->shared_from_this(), _conditionMutex, _workCondition));
+      return true;
+    }
+
+    // How long the task that's been waiting longest has been waiting
+    Clock::duration oldestWait() {
+      auto now = Clock::now();
+      Clock::duration ret{};
+      {
+        std::lock_guard<std::mutex> lock(*_workMutex);
+        for (size_t lane = 0; lane < taskPriorityCount; ++lane) {
+          if (auto front = _work.front(lane)) {
+            ret = std::max(ret, now - front->enqueued);
+          }
+        }
+      }
+      std::shared_lock lock(_queuesMutex);
+      for (auto& queue : _queues) {
+        std::lock_guard<std::mutex> queueLock(queue->mutex);
+        if (!queue->tasks.empty()) {
+          ret = std::max(ret, now - queue->tasks.front().enqueued);
+        }
+      }
+      return ret;
+    }
+
+    // Join the workers that have retired since we last looked
+    void reapRetired() {
+      std::vector<typename WorkerThreadType::PtrType> retired;
+      {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        retired.swap(_retired);
+      }
+      for (auto& worker : retired) {
+        if (worker->joinable()) {
+          worker->join();
+        }
+      }
+    }
+
+    // The elastic mode supervisor thread
+    void supervise() {
+      auto tick = std::clamp<Clock::duration>(_elasticSettings.targetWait / 2,
+                                              std::chrono::milliseconds(1),
+                                              std::chrono::milliseconds(100));
+      while (!_shutdown) {
+        {
+          std::unique_lock<std::mutex> lock(_superviseMutex);
+          _superviseCondition.wait_for(lock, tick, [this]() { return _shutdown.load(); });
+        }
+        if (_shutdown) {
+          break;
+        }
+        reapRetired();
+        if (workerCount() >= _elasticSettings.maxThreads ||
+            oldestWait() <= _elasticSettings.targetWait) {
+          continue;
+        }
+        bool idle = false;
+        for (auto state : workerStatus()) {
+          idle |= (state == ThreadState::Ready);
+        }
+        if (!idle && addWorker()) {
+          ++_grown;
+        }
+      }
+    }
 
   public:
 
-    ThreadPool() : _shutdown(false), _state(ThreadState::Starting) {
+    ThreadPool(SchedulerMode mode = SchedulerMode::SharedQueue) :
+      _shutdown(false),
+      _state(ThreadState::Starting),
+      _elastic(false),
+      _grown(0),
+      _retiredCount(0),
+      _blocked(0),
+      _hasLimits(false),
+      _agingInterval(std::chrono::milliseconds(100)),
+      _mode(mode),
+      _queued(0),
+      _capacity(0),
+      _overflowPolicy(OverflowPolicy::Block),
+      _serial(nextSerial()),
+      _metricsEnabled(true),
+      _maxQueued(0),
+      _statsSince(Clock::now()) {
+      for (auto& depth : _depths) {
+        depth = 0;
+      }
       _conditionMutex = std::make_shared<std::mutex>();
       _workMutex = std::make_shared<std::mutex>();
       _workCondition = std::make_shared<std::condition_variable>();
@@ -93,51 +554,534 @@ namespace fr::RequirementsManager {
       return _state;
     }
 
+    SchedulerMode getSchedulerMode() const {
+      return _mode;
+    }
+
     void startThreads(unsigned int nthreads) {
-      for (int i = 0; i < nthreads; ++i) {
-        auto worker = std::make_shared<WorkerThreadType>(this->shared_from_this(), _conditionMutex, _workCondition);
-        _threads.push_back(worker);
-      }      
+      for (unsigned int i = 0; i < nthreads; ++i) {
+        addWorker();
+      }
+    }
+
+    /**
+     * Start minThreads workers and let the pool grow and shrink
+     * between minThreads and maxThreads as the load changes (see
+     * ElasticSettings.) Call this instead of startThreads.
+     */
+    void startElastic(ElasticSettings settings) {
+      if (_elastic) {
+        throw std::logic_error("ThreadPool is already elastic");
+      }
+      settings.maxThreads = std::max({settings.maxThreads, settings.minThreads, 1u});
+      _elasticSettings = settings;
+      _elastic = true;
+      startThreads(settings.minThreads);
+      _supervisor = std::thread([this]() { supervise(); });
+    }
+
+    bool isElastic() const {
+      return _elastic;
+    }
+
+    ElasticSettings getElasticSettings() const {
+      return _elasticSettings;
+    }
+
+    // Number of workers running right now
+    size_t workerCount() {
+      std::lock_guard<std::mutex> lock(_threadsMutex);
+      return _threads.size();
+    }
+
+    /**
+     * Workers call this when they've been idle for the idle timeout.
+     * Returns true if the worker should exit, in which case it's
+     * already been taken out of the pool.
+     */
+    bool retire(const WorkerThreadType* worker) {
+      std::lock_guard<std::mutex> lock(_threadsMutex);
+      if (!_elastic || _shutdown || _threads.size() <= _elasticSettings.minThreads || hasRunnableWork()) {
+        return false;
+      }
+      auto found = std::find_if(_threads.begin(), _threads.end(),
+                                [worker](const auto& thread) { return thread.get() == worker; });
+      if (found == _threads.end()) {
+        return false;
+      }
+      // Let the next worker have our queue. It's empty or we'd have
+      // had runnable work.
+      auto& slot = currentSlot();
+      if (slot.pool == this) {
+        std::unique_lock queuesLock(_queuesMutex);
+        slot.queue->claimed = false;
+        slot = {};
+      }
+      // Keep what it did in the totals
+      auto& stats = statsSlot();
+      if (stats.pool == _serial) {
+        std::lock_guard<std::mutex> statsLock(_statsMutex);
+        {
+          std::lock_guard<std::mutex> workerLock(stats.stats->mutex);
+          for (auto& [name, type] : stats.stats->types) {
+            _retiredStats.types[name].merge(type);
+          }
+          _retiredStats.tasks += stats.stats->tasks;
+        }
+        std::erase_if(_workerStats, [&stats](const auto& each) { return each.get() == stats.stats; });
+        stats = {};
+      }
+      // The supervisor joins it once it's exited
+      _retired.push_back(*found);
+      _threads.erase(found);
+      ++_retiredCount;
+      return true;
+    }
+
+    // How long workers wait for work before asking to retire. Zero
+    // unless the pool is elastic.
+    std::chrono::milliseconds getIdleTimeout() const {
+      return _elastic ? _elasticSettings.idleTimeout : std::chrono::milliseconds(0);
     }
     
     std::vector<ThreadState> workerStatus() {
       std::vector<ThreadState> ret;
+      std::lock_guard<std::mutex> lock(_threadsMutex);
       for (auto worker : _threads) {
         ret.push_back(worker->status());
       }
       return ret;
     }
 
-    // Returns true if there is work in the work queue
+    // Returns true if there is work in any of the work queues
     bool hasWork() {
-      std::lock_guard<std::mutex> lock(*_workMutex);
-      return (_work.size() > 0);
+      return _queued.load() > 0;
     }
-    
-    // Add a task to the work list -- Will init the task if it's not already
-    // initted.
-    void enqueue(std::shared_ptr<TaskNode<WorkerThreadType>> task) {
-      if (!task->initted) {
-        task->init();
+
+    // True if there's queued work that isn't just waiting on a
+    // group's limit. Workers sleep until this is true.
+    bool hasRunnableWork() {
+      return _queued.load() > _blocked.load();
+    }
+
+    // Number of tasks waiting to run at priority
+    size_t depth(TaskPriority priority) const {
+      return _depths[static_cast<size_t>(priority)].load();
+    }
+
+    // Number of tasks waiting at each priority, indexed by TaskPriority
+    std::vector<size_t> depths() const {
+      std::vector<size_t> ret;
+      for (auto& depth : _depths) {
+        ret.push_back(depth.load());
       }
-      task->setOwner(this->shared_from_this());
+      return ret;
+    }
+
+    /**
+     * Give group weight turns in the round robin for every one the
+     * other groups get. Weights below 1 count as 1.
+     */
+    void setGroupWeight(const std::string& group, size_t weight) {
+      std::lock_guard<std::mutex> lock(*_workMutex);
+      auto settings = _work.getSettings(group);
+      settings.weight = weight;
+      _work.setSettings(group, settings);
+      _blocked = _work.blocked();
+    }
+
+    /**
+     * Never run more than limit tasks from group at once. 0 means no
+     * limit. Tasks that are already running when you lower it keep
+     * running.
+     */
+    void setGroupLimit(const std::string& group, size_t limit) {
       {
         std::lock_guard<std::mutex> lock(*_workMutex);
-        _work.push_back(task);
+        auto settings = _work.getSettings(group);
+        settings.limit = limit;
+        _work.setSettings(group, settings);
+        _blocked = _work.blocked();
+        _hasLimits = _work.hasLimits();
+      }
+      _workCondition->notify_all();
+    }
+
+    size_t getGroupWeight(const std::string& group) {
+      std::lock_guard<std::mutex> lock(*_workMutex);
+      return _work.getSettings(group).weight;
+    }
+
+    size_t getGroupLimit(const std::string& group) {
+      std::lock_guard<std::mutex> lock(*_workMutex);
+      return _work.getSettings(group).limit;
+    }
+
+    std::chrono::milliseconds getAgingInterval() const {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(_agingInterval.load());
+    }
+
+    /**
+     * How long a Normal or Bulk task can wait before it gets to go
+     * ahead of more urgent work. Each of those priorities gets one
+     * such turn per interval, so with the default of 100ms a flood
+     * of interactive requests still lets through at least ten bulk
+     * tasks a second. Zero turns aging off, which means strict
+     * priority order and bulk work can starve.
+     */
+    void setAgingInterval(std::chrono::milliseconds interval) {
+      _agingInterval = std::chrono::duration_cast<Clock::duration>(interval);
+    }
+
+    size_t getCapacity() const {
+      return _capacity;
+    }
+
+    /**
+     * Only let capacity tasks wait in the queues before enqueue
+     * starts applying the overflow policy. 0 (the default) means
+     * no limit.
+     *
+     * This only applies to tasks enqueued from outside the pool.
+     * Tasks that running tasks enqueue (SaveNodesNode's savers and
+     * so on) and coroutine tasks being resumed always go in -- the
+     * work they're part of was already let in, and making a worker
+     * wait on its own queue would deadlock. They do count toward
+     * the total, though, so a big fan out holds off new requests
+     * until it's worked through.
+     */
+    void setCapacity(size_t capacity) {
+      _capacity = capacity;
+      _spaceCondition.notify_all();
+    }
+
+    OverflowPolicy getOverflowPolicy() const {
+      return _overflowPolicy;
+    }
+
+    void setOverflowPolicy(OverflowPolicy policy) {
+      _overflowPolicy = policy;
+      _spaceCondition.notify_all();
+    }
+
+    /**
+     * Everything the pool has measured since it was created or
+     * resetMetrics was last called: how long tasks of each type
+     * (see Task::taskType) waited in the queue and how long they
+     * took to run, how busy each worker has been, and how deep the
+     * queues are. That's what tells you whether a slow request is
+     * sitting in the queue or waiting on the database.
+     */
+    PoolMetrics metrics() {
+      PoolMetrics ret;
+      auto now = Clock::now();
+      ret.queued = _queued;
+      ret.blocked = _blocked;
+      ret.maxQueued = _maxQueued;
+      ret.depths = depths();
+      ret.threads = workerCount();
+      ret.grown = _grown;
+      ret.retired = _retiredCount;
+      std::lock_guard<std::mutex> lock(_statsMutex);
+      ret.elapsed = now - _statsSince;
+      ret.completed = _retiredStats.tasks;
+      ret.types.insert(_retiredStats.types.begin(), _retiredStats.types.end());
+      for (auto& stats : _workerStats) {
+        std::lock_guard<std::mutex> statsLock(stats->mutex);
+        WorkerMetrics worker;
+        worker.tasks = stats->tasks;
+        worker.busy = stats->busy;
+        worker.elapsed = now - stats->since;
+        ret.completed += stats->tasks;
+        ret.workers.push_back(worker);
+        for (auto& [name, type] : stats->types) {
+          ret.types[name].merge(type);
+        }
+      }
+      return ret;
+    }
+
+    // Start counting again from now
+    void resetMetrics() {
+      auto now = Clock::now();
+      std::lock_guard<std::mutex> lock(_statsMutex);
+      _statsSince = now;
+      _maxQueued = _queued.load();
+      _retiredStats.types.clear();
+      _retiredStats.tasks = 0;
+      _grown = 0;
+      _retiredCount = 0;
+      for (auto& stats : _workerStats) {
+        std::lock_guard<std::mutex> statsLock(stats->mutex);
+        stats->types.clear();
+        stats->tasks = 0;
+        stats->busy = {};
+        stats->since = now;
+      }
+    }
+
+    bool getMetricsEnabled() const {
+      return _metricsEnabled;
+    }
+
+    // Metrics are on by default. They cost two clock reads and an
+    // uncontended lock per task.
+    void setMetricsEnabled(bool enabled) {
+      _metricsEnabled = enabled;
+    }
+    
+    /**
+     * Add a task to the work list -- Gives the task a chance to get
+     * ready first (TaskNodes get initted if they aren't already.)
+     *
+     * Returns a handle that's done once the task and everything it
+     * enqueues while it runs are done. If this is called from inside
+     * a running task, the new task becomes part of that task's
+     * subtree.
+     */
+    TaskHandle enqueue(std::shared_ptr<Task<WorkerThreadType>> task) {
+      task->prepare();
+      task->setOwner(this->shared_from_this());
+      auto& current = running();
+      bool fromTask = current.pool == this && current.task;
+      if (task->getGroup().empty()) {
+        task->setGroup(fromTask ? current.task->getGroup() : task->defaultGroup());
+      }
+      if (fromTask && !task->getCancellation().valid()) {
+        // Cancelling the parent cancels its whole subtree
+        task->setCancellation(current.task->getCancellation());
+      }
+      auto completion = std::make_shared<TaskCompletion>(TaskCompletion::current());
+      task->setCompletion(completion);
+      try {
+        push(task, running().pool != this);
+      } catch (...) {
+        // It never went in, so don't leave whatever enqueued it
+        // waiting on it
+        completion->release();
+        throw;
+      }
+      return TaskHandle(completion);
+    }
+
+    /**
+     * Run fn on the pool as a LightTask. Same as enqueue otherwise --
+     * if you call it from inside a running task it joins that task's
+     * group and subtree.
+     */
+    template <typename Fn>
+    TaskHandle submit(Fn&& fn, TaskPriority priority = TaskPriority::Normal) {
+      auto task = std::make_shared<LightTask<WorkerThreadType>>(std::forward<Fn>(fn));
+      task->setPriority(priority);
+      return enqueue(task);
+    }
+
+    /**
+     * Put a task that's already been enqueued back on the queue
+     * without starting a new handle for it. CoroutineTask uses this
+     * to pick up where it left off once whatever it was waiting on
+     * is done.
+     */
+    void resume(std::shared_ptr<Task<WorkerThreadType>> task) {
+      push(task);
+    }
+
+  private:
+
+    /**
+     * Called with _workMutex held before a task from outside the
+     * pool goes in the shared queue. Returns once there's room,
+     * throws QueueFullError if there isn't going to be, and hands
+     * back the task it threw out if it had to drop one.
+     */
+    QueuedTask makeRoom(std::unique_lock<std::mutex>& lock, TaskPriority priority) {
+      auto full = [this]() {
+        auto capacity = _capacity.load();
+        return capacity > 0 && _queued.load() >= capacity;
+      };
+      if (!full()) {
+        return {};
+      }
+      switch (_overflowPolicy.load()) {
+      case OverflowPolicy::Block:
+        // Workers don't take this lock to take things off their own
+        // deques, so don't count on hearing about every one
+        while (full() && !_shutdown && _overflowPolicy.load() == OverflowPolicy::Block) {
+          _spaceCondition.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        if (!full()) {
+          return {};
+        }
+        if (_shutdown) {
+          throw QueueFullError("ThreadPool is shutting down");
+        }
+        // Somebody changed the policy on us
+        return makeRoom(lock, priority);
+      case OverflowPolicy::DropLowest:
+        for (size_t lane = taskPriorityCount - 1; lane > static_cast<size_t>(priority); --lane) {
+          QueuedTask dropped;
+          if (_work.dropNewest(dropped, lane)) {
+            --depthCounter(dropped.priority);
+            --_queued;
+            _blocked = _work.blocked();
+            return dropped;
+          }
+        }
+        break;
+      case OverflowPolicy::Reject:
+        break;
+      }
+      throw QueueFullError("ThreadPool queue is full");
+    }
+
+    void push(const TaskPtr& task, bool bounded = false) {
+      QueuedTask queued{task, task->getPriority(), Clock::now()};
+      LocalQueue* local = nullptr;
+      if (_mode == SchedulerMode::WorkStealing && queued.priority != TaskPriority::Interactive) {
+        local = localQueue(false);
+        if (local && _hasLimits) {
+          std::lock_guard<std::mutex> lock(*_workMutex);
+          if (_work.getSettings(task->getGroup()).limit > 0) {
+            local = nullptr;
+          }
+        }
+      }
+      // Count it before it goes in so a worker that grabs it right
+      // away never takes the count below zero
+      if (local) {
+        ++depthCounter(queued.priority);
+        countQueued();
+        std::lock_guard<std::mutex> lock(local->mutex);
+        local->tasks.push_back(std::move(queued));
+      } else {
+        QueuedTask dropped;
+        {
+          std::unique_lock<std::mutex> lock(*_workMutex);
+          if (bounded) {
+            dropped = makeRoom(lock, queued.priority);
+          }
+          ++depthCounter(queued.priority);
+          countQueued();
+          auto lane = static_cast<size_t>(queued.priority);
+          _work.push(task->getGroup(), std::move(queued), lane);
+          _blocked = _work.blocked();
+        }
+        if (dropped.task) {
+          if (auto completion = dropped.task->getCompletion()) {
+            completion->release(std::make_exception_ptr(QueueFullError("Dropped from a full ThreadPool queue")));
+          }
+        }
       }
       _workCondition->notify_one();
     }
 
+  public:
+
+    /**
+     * Workers call this to run a task they got from requestWork.
+     * Anything the task enqueues while it runs is counted against its
+     * handle, and the handle gets any exception it throws rather than
+     * the exception taking the worker thread down.
+     */
+    void runTask(std::shared_ptr<Task<WorkerThreadType>> task) {
+      auto& runningNow = running();
+      std::string limitedGroup;
+      Clock::time_point enqueued;
+      Running previousRunning;
+      if (runningNow.pool == this && runningNow.task == task) {
+        // Straight from requestWork
+        limitedGroup = std::move(runningNow.limitedGroup);
+        enqueued = runningNow.enqueued;
+      } else {
+        previousRunning = std::move(runningNow);
+      }
+      runningNow = {this, task, {}};
+      auto completion = task->getCompletion();
+      auto& current = TaskCompletion::current();
+      auto previous = current;
+      current = completion;
+      bool measure = _metricsEnabled;
+      Clock::time_point started;
+      if (measure) {
+        started = Clock::now();
+      }
+      std::exception_ptr error;
+      // No point starting something nobody wants any more
+      bool skipped = task->cancelled();
+      if (skipped) {
+        error = std::make_exception_ptr(TaskCancelled("Task was cancelled before it ran"));
+        task->abandon();
+      } else {
+        try {
+          task->run();
+        } catch (const TaskCancelled&) {
+          error = std::current_exception();
+        } catch (...) {
+          // Whatever a cancelled query threw, the handle should
+          // say why it happened
+          error = task->cancelled() ?
+            std::make_exception_ptr(TaskCancelled("Task was cancelled while it ran")) :
+            std::current_exception();
+        }
+      }
+      if (measure) {
+        // Before the handle's released, so anyone waiting on it
+        // sees this task in the numbers
+        auto ran = Clock::now() - started;
+        auto& stats = workerStats();
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        auto& type = stats.types[task->taskType()];
+        if (enqueued != Clock::time_point{}) {
+          type.wait.record(started - enqueued);
+        }
+        if (skipped) {
+          ++type.cancelled;
+        } else {
+          type.run.record(ran);
+          if (error) {
+            ++type.errors;
+          }
+          ++stats.tasks;
+          stats.busy += ran;
+        }
+      }
+      // Continuations run during release, and anything they enqueue
+      // shouldn't count against a handle that's already done
+      current = previous;
+      running() = std::move(previousRunning);
+      if (!limitedGroup.empty()) {
+        bool released;
+        {
+          std::lock_guard<std::mutex> lock(*_workMutex);
+          released = _work.finished(limitedGroup);
+          _blocked = _work.blocked();
+        }
+        if (released) {
+          _workCondition->notify_all();
+        }
+      }
+      if (completion) {
+        completion->release(error);
+      }
+    }
+
     // Can return nullptr -- threads must check before running task.
     
-    std::shared_ptr<TaskNode<WorkerThreadType>> requestWork() {
-      std::shared_ptr<TaskNode<WorkerThreadType>> ret;
-      std::lock_guard<std::mutex> lock(*_workMutex);
-      if (_work.size() > 0) {
-        ret = _work.front();
-        _work.pop_front();
+    std::shared_ptr<Task<WorkerThreadType>> requestWork() {
+      QueuedTask ret = (_mode == SchedulerMode::WorkStealing) ? requestStolenWork() : popInjected();
+      if (ret.task) {
+        --depthCounter(ret.priority);
+        --_queued;
+        if (_capacity.load() > 0) {
+          _spaceCondition.notify_one();
+        }
+        // runTask picks this up
+        running() = {this, ret.task, std::move(ret.limitedGroup), ret.enqueued};
+      } else if (_metricsEnabled) {
+        // Make sure idle workers show up in the metrics too
+        workerStats();
       }
-      return ret;
+      return ret.task;
     }
 
     // Shut down all the threads -- This just sets a flag requesting
@@ -145,15 +1089,33 @@ namespace fr::RequirementsManager {
     // terminate
 
     void shutdown() {
-      for (auto worker : _threads) {
-        worker->shutdown();
+      {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        _shutdown = true;
+        for (auto worker : _threads) {
+          worker->shutdown();
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lock(_superviseMutex);
+        _superviseCondition.notify_all();
       }
       _workCondition->notify_all();
+      _spaceCondition.notify_all();
       _state = ThreadState::Draining;
     }
 
     void join() {
-      for (auto worker : _threads) {
+      if (_supervisor.joinable() && _supervisor.get_id() != std::this_thread::get_id()) {
+        _supervisor.join();
+      }
+      std::vector<typename WorkerThreadType::PtrType> threads;
+      {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        threads = _threads;
+        threads.insert(threads.end(), _retired.begin(), _retired.end());
+      }
+      for (auto worker : threads) {
         if (worker->joinable()) {
           worker->join();
         }
@@ -191,11 +1153,11 @@ namespace fr::RequirementsManager {
     // notified and invokes this.
 
     void drain() {
-      std::shared_ptr<TaskNode<WorkerThread>> oneWork;
+      std::shared_ptr<Task<WorkerThread>> oneWork;
       _state = ThreadState::Processing;
       oneWork = _owner->requestWork();
       while(oneWork) {
-        oneWork->run();
+        _owner->runTask(oneWork);
         oneWork = _owner->requestWork();
       }      
     }
@@ -235,12 +1197,29 @@ namespace fr::RequirementsManager {
         // back to sleep if we don't want to wake up. It'd
         // probably be about the same amount of processing
         // either way, though.
-        _cv->wait(lock, [&](){ return _shutdown || _owner->hasWork();});
+        auto ready = [&](){ return _shutdown || _owner->hasRunnableWork();};
+        auto idleTimeout = _owner->getIdleTimeout();
+        if (idleTimeout.count() == 0) {
+          _cv->wait(lock, ready);
+        } else if (!_cv->wait_for(lock, idleTimeout, ready) && _owner->retire(this)) {
+          // Elastic pool doesn't need us any more. Nothing's queued
+          // or retire would have said no.
+          _state = ThreadState::Shutdown;
+          return;
+        }
       }
 
       // Call drain again after shutdown to ensure that all work is
-      // processed before the thread exits.
+      // processed before the thread exits. Work that's waiting on a
+      // group limit only becomes available as other threads finish,
+      // so keep at it until there's nothing left.
       drain();
+      while (_owner->hasWork()) {
+        std::unique_lock lock(waitMutex);
+        _cv->wait_for(lock, std::chrono::milliseconds(10), [&](){ return _owner->hasRunnableWork(); });
+        lock.unlock();
+        drain();
+      }
     }
 
     bool joinable() {
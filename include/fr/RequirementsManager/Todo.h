@@ -58,6 +58,9 @@ namespace fr::RequirementsManager {
     using Parent = Node;
     using PtrType = std::shared_ptr<Type>;
 
+    // Fields in DbSpecificData<RecurringTodo>::columns order, for markDirty
+    enum class Field { Description, Created, RecurringInterval, SecondsFlag, DayOfMonthFlag, DayOfYearFlag };
+
     RecurringTodo() : _created(0l),
                       _recurringInterval(0l),
                       _seconds(false),
@@ -81,6 +84,7 @@ namespace fr::RequirementsManager {
     // you have to do this sort of thing.
     void setCreated(time_t created) {
       _created = created;
+      markDirty(Field::Created);
     }
 
     std::string getDescription() {
@@ -89,6 +93,7 @@ namespace fr::RequirementsManager {
     
     void setDescription(const std::string& description) {
       _description = description;
+      markDirty(Field::Description);
     }
     
     time_t getRecurringInterval() {
@@ -97,10 +102,12 @@ namespace fr::RequirementsManager {
     
     void setRecurringInterval(time_t interval) {
       _recurringInterval = interval;
+      markDirty(Field::RecurringInterval);
     }
 
     void setSecondsFlag(bool seconds) {
       _seconds = seconds;
+      markDirty(Field::SecondsFlag);
     }
     
     bool getSecondsFlag() {
@@ -109,6 +116,7 @@ namespace fr::RequirementsManager {
 
     void setDayOfMonthFlag(bool dayOfMonth) {
       _dayOfMonth = dayOfMonth;
+      markDirty(Field::DayOfMonthFlag);
     }
 
     bool getDayOfMonthFlag() {
@@ -117,6 +125,7 @@ namespace fr::RequirementsManager {
 
     void setDayOfYearFlag(bool dayOfYear) {
       _dayOfYear = dayOfYear;
+      markDirty(Field::DayOfYearFlag);
     }
 
     bool getDayOfYearFlag() {
@@ -187,6 +196,9 @@ namespace fr::RequirementsManager {
     using Parent = Node;
     using PtrType = std::shared_ptr<Type>;
 
+    // Fields in DbSpecificData<Todo>::columns order, for markDirty
+    enum class Field { Description, Created, Due, Completed, DateCompleted, SpawnedFrom };
+
     // Create a Todo from a recurring todo
     static PtrType fromRecurring(RecurringTodo::PtrType from) {
       PtrType todo = std::make_shared<Todo>();
@@ -222,6 +234,7 @@ namespace fr::RequirementsManager {
 
     void setDescription(const std::string& description) {
       _description = description;
+      markDirty(Field::Description);
     }
 
     // It kind of doesn't make sense to be able to set the
@@ -234,6 +247,7 @@ namespace fr::RequirementsManager {
 
     void setCreated(time_t created) {
       _created = created;
+      markDirty(Field::Created);
     }
 
     time_t getDue() {
@@ -242,6 +256,7 @@ namespace fr::RequirementsManager {
 
     void setDue(time_t due) {
       _due = due;
+      markDirty(Field::Due);
     }
 
     bool getCompleted() {
@@ -250,6 +265,7 @@ namespace fr::RequirementsManager {
 
     void setCompleted(bool completed) {
       _completed = completed;
+      markDirty(Field::Completed);
     }
 
     time_t getDateCompleted() {
@@ -258,6 +274,7 @@ namespace fr::RequirementsManager {
 
     void setDateCompleted(time_t dateCompleted) {
       _dateCompleted = dateCompleted;
+      markDirty(Field::DateCompleted);
     }
 
     boost::uuids::uuid getSpawnedFrom() {
@@ -266,6 +283,7 @@ namespace fr::RequirementsManager {
 
     void setSpawnedFrom(boost::uuids::uuid spawnedFrom) {
       _spawnedFrom = spawnedFrom;
+      markDirty(Field::SpawnedFrom);
     }
 
     template <typename Archive>
@@ -0,0 +1,318 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fr/RequirementsManager/UuidSet.h>
+
+namespace fr::RequirementsManager {
+
+  enum class TraverseOrder {
+    // Same order the old recursive traverse visited nodes in: a
+    // node, then everything reachable through its first up node,
+    // and so on
+    DepthFirst,
+    // Everything one edge away, then everything two edges away...
+    BreadthFirst
+  };
+
+  // Which links a traversal follows. Combine them with |.
+  enum class EdgeFilter : unsigned {
+    None = 0,
+    Up = 1,
+    Down = 2,
+    // Anything a node reports from Node::relatedNodes, like a
+    // CommitableNode's change parent and child
+    Related = 4,
+    UpDown = Up | Down,
+    All = Up | Down | Related
+  };
+
+  constexpr EdgeFilter operator|(EdgeFilter a, EdgeFilter b) {
+    return static_cast<EdgeFilter>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+  }
+
+  constexpr bool follows(EdgeFilter filter, EdgeFilter edges) {
+    return (static_cast<unsigned>(filter) & static_cast<unsigned>(edges)) != 0;
+  }
+
+  // What a traversal callback can return to steer the traversal
+  enum class TraverseAction {
+    Continue,
+    // Don't go past this node
+    Prune,
+    // Don't visit anything else
+    Stop
+  };
+
+  struct TraverseOptions {
+    TraverseOrder order = TraverseOrder::DepthFirst;
+    EdgeFilter edges = EdgeFilter::All;
+    // Don't follow edges from nodes this many edges from the start.
+    // Depth first, a node's depth is the length of the path the
+    // traversal happened to reach it by, so use BreadthFirst if
+    // you need everything within maxDepth.
+    size_t maxDepth = std::numeric_limits<size_t>::max();
+  };
+
+  /**
+   * Walks a graph of nodes with an explicit stack (or queue), so a
+   * deep graph can't run us out of stack the way the recursive
+   * traverse could. Visited nodes are tracked by their raw UUID in
+   * a UuidSet.
+   *
+   * Nodes that haven't been initted are initted as the traversal
+   * reaches them, same as the old traverse did.
+   *
+   * You can call run more than once. Nodes visited by an earlier
+   * run aren't visited again, which is handy when you have several
+   * roots that share nodes.
+   *
+   * The callback takes the node, and optionally the depth it was
+   * found at. It can return a TraverseAction or nothing.
+   *
+   * NodeType is always Node. It's a template so Node.h can use this
+   * without this header needing Node.
+   */
+
+  template <typename NodeType>
+  class Traversal {
+  public:
+    using Type = Traversal<NodeType>;
+    using NodePtr = std::shared_ptr<NodeType>;
+
+  private:
+    struct Pending {
+      NodePtr node;
+      size_t depth;
+    };
+
+    TraverseOptions _options;
+    UuidSet _visited;
+    std::vector<Pending> _stack;
+    std::deque<Pending> _queue;
+    // Reused for relatedNodes so we're not allocating per node
+    std::vector<NodePtr> _related;
+    bool _stopped = false;
+    // The node whose callback returned Stop. Its neighbours never
+    // made it on the stack.
+    Pending _stoppedAt;
+
+    // True the first time we see node
+    bool mark(NodeType& node) {
+      if (!node.initted) {
+        node.init();
+      }
+      return _visited.insert(node.id);
+    }
+
+    bool seen(const NodeType& node) const {
+      return node.initted && _visited.contains(node.id);
+    }
+
+    template <typename Fn>
+    static TraverseAction call(Fn& fn, const NodePtr& node, size_t depth) {
+      if constexpr (std::is_invocable_v<Fn&, const NodePtr&, size_t>) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, const NodePtr&, size_t>>) {
+          fn(node, depth);
+          return TraverseAction::Continue;
+        } else {
+          return fn(node, depth);
+        }
+      } else {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, const NodePtr&>>) {
+          fn(node);
+          return TraverseAction::Continue;
+        } else {
+          return fn(node);
+        }
+      }
+    }
+
+    template <typename Each>
+    void forEachNeighbour(const NodePtr& node, Each&& each) {
+      if (follows(_options.edges, EdgeFilter::Up)) {
+        for (auto& next : node->up) {
+          if (next) {
+            each(next);
+          }
+        }
+      }
+      if (follows(_options.edges, EdgeFilter::Down)) {
+        for (auto& next : node->down) {
+          if (next) {
+            each(next);
+          }
+        }
+      }
+      if (follows(_options.edges, EdgeFilter::Related)) {
+        _related.clear();
+        node->relatedNodes(_related);
+        for (auto& next : _related) {
+          if (next) {
+            each(next);
+          }
+        }
+        _related.clear();
+      }
+    }
+
+    template <typename Fn>
+    size_t depthFirst(const NodePtr& start, Fn& fn) {
+      size_t visited = 0;
+      _stack.push_back({start, 0});
+      while (!_stack.empty()) {
+        auto [node, depth] = std::move(_stack.back());
+        _stack.pop_back();
+        // It can be on the stack more than once if several nodes
+        // link to it. Only the first one counts.
+        if (!mark(*node)) {
+          continue;
+        }
+        ++visited;
+        auto action = call(fn, node, depth);
+        if (action == TraverseAction::Stop) {
+          // Leave the rest on the stack for pending
+          _stopped = true;
+          _stoppedAt = {node, depth};
+          break;
+        }
+        if (action == TraverseAction::Prune || depth >= _options.maxDepth) {
+          continue;
+        }
+        auto first = _stack.size();
+        forEachNeighbour(node, [&](const NodePtr& next) {
+          if (!seen(*next)) {
+            _stack.push_back({next, depth + 1});
+          }
+        });
+        // So the first neighbour comes off the stack first
+        std::reverse(_stack.begin() + first, _stack.end());
+      }
+      return visited;
+    }
+
+    template <typename Fn>
+    size_t breadthFirst(const NodePtr& start, Fn& fn) {
+      size_t visited = 0;
+      if (mark(*start)) {
+        _queue.push_back({start, 0});
+      }
+      while (!_queue.empty()) {
+        auto [node, depth] = std::move(_queue.front());
+        _queue.pop_front();
+        ++visited;
+        auto action = call(fn, node, depth);
+        if (action == TraverseAction::Stop) {
+          _stopped = true;
+          _stoppedAt = {node, depth};
+          break;
+        }
+        if (action == TraverseAction::Prune || depth >= _options.maxDepth) {
+          continue;
+        }
+        forEachNeighbour(node, [&](const NodePtr& next) {
+          if (mark(*next)) {
+            _queue.push_back({next, depth + 1});
+          }
+        });
+      }
+      return visited;
+    }
+
+  public:
+
+    explicit Traversal(TraverseOptions options = TraverseOptions()) : _options(options) {}
+
+    /**
+     * Visit everything reachable from start that an earlier run
+     * hasn't already visited. Returns how many nodes fn was called
+     * for. Does nothing once a callback has returned Stop.
+     */
+    template <typename Fn>
+    size_t run(const NodePtr& start, Fn&& fn) {
+      if (!start || _stopped) {
+        return 0;
+      }
+      if (_options.order == TraverseOrder::BreadthFirst) {
+        return breadthFirst(start, fn);
+      }
+      return depthFirst(start, fn);
+    }
+
+    bool visited(const NodeType& node) const {
+      return seen(node);
+    }
+
+    // Number of nodes reached so far, across every run. Breadth
+    // first, that includes any that were still queued when a
+    // callback returned Stop.
+    size_t size() const {
+      return _visited.size();
+    }
+
+    // True if a callback returned Stop
+    bool stopped() const {
+      return _stopped;
+    }
+
+    /**
+     * Nodes that were found but not visited yet when a callback
+     * returned Stop, plus the neighbours of the node that stopped
+     * it, so something else can carry on from them. Everything that
+     * wasn't visited is reachable from these without going through a
+     * node that was. A node can turn up more than once. Empty if
+     * nothing stopped.
+     */
+    std::vector<NodePtr> pending() {
+      std::vector<NodePtr> ret;
+      if (!_stopped) {
+        return ret;
+      }
+      if (_options.order == TraverseOrder::BreadthFirst) {
+        for (auto& entry : _queue) {
+          ret.push_back(entry.node);
+        }
+      } else {
+        // A node can be on the stack more than once, and some of
+        // those may have been visited through another link since
+        UuidSet added;
+        for (auto& entry : _stack) {
+          if (!seen(*entry.node) && (!entry.node->initted || added.insert(entry.node->id))) {
+            ret.push_back(entry.node);
+          }
+        }
+      }
+      if (_stoppedAt.node && _stoppedAt.depth < _options.maxDepth) {
+        forEachNeighbour(_stoppedAt.node, [&](const NodePtr& next) {
+          if (!seen(*next)) {
+            ret.push_back(next);
+          }
+        });
+      }
+      return ret;
+    }
+  };
+
+}
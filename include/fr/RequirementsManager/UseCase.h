@@ -35,6 +35,9 @@ namespace fr::RequirementsManager {
     using Parent = CommitableNode;
     using PtrType = std::shared_ptr<Type>;
 
+    // Fields in DbSpecificData<UseCase>::columns order, for markDirty
+    enum class Field { Name };
+
     virtual ~UseCase() {}
     
     std::string getNodeType() const override {
@@ -44,6 +47,7 @@ namespace fr::RequirementsManager {
     void setName(const std::string &name) {
       throwIfCommitted();
       _name = name;
+      markDirty(Field::Name);
     }
 
     std::string getName() const {
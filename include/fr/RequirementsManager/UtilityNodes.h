@@ -47,6 +47,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Text>::columns order, for markDirty
+    enum class Field { Text };
+
   private:
     std::string _text;
 
@@ -60,6 +63,7 @@ namespace fr::RequirementsManager {
     
     void setText(const std::string &text) {
       _text = text;
+      markDirty(Field::Text);
     }
 
     std::string getText() const {
@@ -96,12 +100,16 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Completed>::columns order, for markDirty
+    enum class Field { Description };
+
     std::string getNodeType() const override {
       return "Completed";
     }
     
     void setDescription(const std::string& description) {
       _description = description;
+      markDirty(Field::Description);
     }
 
     std::string getDescription() const {
@@ -134,6 +142,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<KeyValue>::columns order, for markDirty
+    enum class Field { Key, Value };
+
   private:
     std::string _key;
     std::string _value;
@@ -149,10 +160,12 @@ namespace fr::RequirementsManager {
     
     void setKey(const std::string& key) {
       _key = key;
+      markDirty(Field::Key);
     }
 
     void setValue(const std::string &value) {
       _value = value;
+      markDirty(Field::Value);
     }
 
     std::string getKey() const {
@@ -201,6 +214,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<TimeEstimate>::columns order, for markDirty
+    enum class Field { Text, Estimate, Started, Start };
+
   private:
     // Descriptive text for this estimate
     std::string _text;
@@ -229,10 +245,12 @@ namespace fr::RequirementsManager {
     
     void setText(const std::string &text) {
       _text = text;
+      markDirty(Field::Text);
     }
 
     void setEstimate(unsigned long estimate) {
       _estimate = estimate;
+      markDirty(Field::Estimate);
     }
 
     std::string getText() const {
@@ -249,6 +267,7 @@ namespace fr::RequirementsManager {
 
     void setStarted(bool started) {
       _started = started;
+      markDirty(Field::Started);
     }
 
     time_t getStartTimestamp() const {
@@ -257,6 +276,7 @@ namespace fr::RequirementsManager {
 
     void setStartTimestamp(time_t stamp) {
       _startTimestamp = stamp;
+      markDirty(Field::Start);
     }
 
     template <class Archive>
@@ -291,6 +311,10 @@ namespace fr::RequirementsManager {
     using Type = Effort;
     using PtrType = std::shared_ptr<Effort>;
     using Parent = Node;
+
+    // Fields in DbSpecificData<Effort>::columns order, for markDirty
+    enum class Field { Text, Effort };
+
     
   private:
     // Some descriptive text for this effort (System doesn't require anything)
@@ -308,6 +332,7 @@ namespace fr::RequirementsManager {
     
     void setText(const std::string& text) {
       _text = text;
+      markDirty(Field::Text);
     }
 
     // Set effort (in seconds) spent for this work. Nodes where time make
@@ -320,6 +345,7 @@ namespace fr::RequirementsManager {
     // that should be somewhat dictated by the node type the effort is attached to
     void setEffort(unsigned long effort) {
       _effort = effort;
+      markDirty(Field::Effort);
     }
 
     std::string getText() const {
@@ -364,6 +390,10 @@ namespace fr::RequirementsManager {
     using Type = Role;
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
+
+    // Fields in DbSpecificData<Role>::columns order, for markDirty
+    enum class Field { Who };
+
     
     Role() = default;
     virtual ~Role() = default;
@@ -378,6 +408,7 @@ namespace fr::RequirementsManager {
 
     void setWho(const std::string& who) {
       _who = who;
+      markDirty(Field::Who);
     }
 
     template <class Archive>
@@ -407,6 +438,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Actor>::columns order, for markDirty
+    enum class Field { Actor };
+
     std::string getNodeType() const override {
       return "Actor";
     }
@@ -417,6 +451,7 @@ namespace fr::RequirementsManager {
 
     void setActor(const std::string& actor) {
       _actor = actor;
+      markDirty(Field::Actor);
     }
 
     template <class Archive>
@@ -462,6 +497,10 @@ namespace fr::RequirementsManager {
     using Type = Goal;
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
+
+    // Fields in DbSpecificData<Goal>::columns order, for markDirty
+    enum class Field { Action, Outcome, Context, TargetDate, TargetDateConfidence, Alignment };
+
     
     Goal() = default;
     virtual ~Goal() = default;
@@ -472,26 +511,32 @@ namespace fr::RequirementsManager {
 
     void setAction(const std::string& action) {
       _action = action;
+      markDirty(Field::Action);
     }
 
     void setOutcome(const std::string& outcome) {
       _outcome = outcome;
+      markDirty(Field::Outcome);
     }
 
     void setContext(const std::string &context) {
       _context = context;
+      markDirty(Field::Context);
     }
 
     void setTargetDate(unsigned long targetDate) {
       _targetDate = targetDate;
+      markDirty(Field::TargetDate);
     }
 
     void setTargetDateConfidence(const std::string &targetDateConfidence) {
       _targetDateConfidence = targetDateConfidence;
+      markDirty(Field::TargetDateConfidence);
     }
 
     void setAlignment(const std::string &alignment) {
       _alignment = alignment;
+      markDirty(Field::Alignment);
     }
 
     std::string getAction() const {
@@ -561,6 +606,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Purpose>::columns order, for markDirty
+    enum class Field { Description, Deadline, DeadlineConfidence };
+
     Purpose() = default;
     virtual ~Purpose() = default;
 
@@ -570,14 +618,17 @@ namespace fr::RequirementsManager {
 
     void setDescription(const std::string description) {
       _description = description;
+      markDirty(Field::Description);
     }
 
     void setDeadline(unsigned long deadline) {
       _deadline = deadline;
+      markDirty(Field::Deadline);
     }
 
     void setDeadlineConfidence(const std::string &deadlineConfidence) {
       _deadlineConfidence = deadlineConfidence;
+      markDirty(Field::DeadlineConfidence);
     }
 
     std::string getDescription() const {
@@ -629,6 +680,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Person>::columns order, for markDirty
+    enum class Field { FirstName, LastName };
+
     Person() = default;
     virtual ~Person() = default;
 
@@ -638,10 +692,12 @@ namespace fr::RequirementsManager {
 
     void setLastName(const std::string &lastName) {
       _lastName = lastName;
+      markDirty(Field::LastName);
     }
 
     void setFirstName(const std::string &firstName) {
       _firstName = firstName;
+      markDirty(Field::FirstName);
     }
 
     std::string getLastName() const {
@@ -676,6 +732,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<EmailAddress>::columns order, for markDirty
+    enum class Field { Address };
+
     EmailAddress() = default;
     virtual ~EmailAddress() = default;
 
@@ -685,6 +744,7 @@ namespace fr::RequirementsManager {
     
     void setAddress(const std::string& address) {
       _address = address;
+      markDirty(Field::Address);
     }
 
     std::string getAddress() const {
@@ -721,6 +781,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<PhoneNumber>::columns order, for markDirty
+    enum class Field { CountryCode, Number, PhoneType };
+
     PhoneNumber() = default;
     virtual ~PhoneNumber() = default;
 
@@ -730,6 +793,7 @@ namespace fr::RequirementsManager {
 
     void setCountryCode(const std::string &countryCode) {
       _countryCode = countryCode;
+      markDirty(Field::CountryCode);
     }
 
     std::string getCountryCode() const {
@@ -738,10 +802,12 @@ namespace fr::RequirementsManager {
     
     void setNumber(const std::string &number) {
       _number = number;
+      markDirty(Field::Number);
     }
 
     void setPhoneType(const std::string &phoneType) {
       _phoneType = phoneType;
+      markDirty(Field::PhoneType);
     }
 
     std::string getNumber() const {
@@ -791,6 +857,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<InternationalAddress>::columns order, for markDirty
+    enum class Field { CountryCode, AddressLines, Locality, PostalCode };
+
     InternationalAddress() = default;
     virtual ~InternationalAddress() = default;
 
@@ -800,20 +869,24 @@ namespace fr::RequirementsManager {
 
     void setCountryCode(const std::string &countryCode) {
       _countryCode = countryCode;
+      markDirty(Field::CountryCode);
     }
     // Just construct your whole address lines text node
     // and slap it in here. I'm already predicting this will
     // cause me problems in the future lol.
     void setAddressLines(std::string addressLines) {
       _addressLines = addressLines;
+      markDirty(Field::AddressLines);
     }
 
     void setLocality(const std::string &locality) {
       _locality = locality;
+      markDirty(Field::Locality);
     }
 
     void setPostalCode(const std::string &postalCode) {
       _postalCode = postalCode;
+      markDirty(Field::PostalCode);
     }
 
     std::string getCountryCode() const {
@@ -870,6 +943,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<USAddress>::columns order, for markDirty
+    enum class Field { AddressLines, City, State, ZipCode };
+
     USAddress() = default;
     virtual ~USAddress() = default;
 
@@ -882,18 +958,22 @@ namespace fr::RequirementsManager {
     // here (one node per address line)
     void setAddressLines(std::string addressLines) {
       _addressLines = addressLines;
+      markDirty(Field::AddressLines);
     }
 
     void setCity(const std::string& city) {
       _city = city;
+      markDirty(Field::City);
     }
 
     void setState(const std::string& state) {
       _state = state;
+      markDirty(Field::State);
     }
 
     void setZipCode(const std::string &zipCode) {
       _zipCode = zipCode;
+      markDirty(Field::ZipCode);
     }
 
     // Can't guarantee this is const since we're returning a pointer
@@ -951,6 +1031,9 @@ namespace fr::RequirementsManager {
     using PtrType = std::shared_ptr<Type>;
     using Parent = Node;
 
+    // Fields in DbSpecificData<Event>::columns order, for markDirty
+    enum class Field { Name, Description };
+
     std::string getNodeType() const override {
       return "Event";
     }
@@ -961,6 +1044,7 @@ namespace fr::RequirementsManager {
 
     void setName(const std::string &name) {
       _name = name;
+      markDirty(Field::Name);
     }
 
     std::string getDescription() const {
@@ -969,6 +1053,7 @@ namespace fr::RequirementsManager {
 
     void setDescription(const std::string& description) {
       _description = description;
+      markDirty(Field::Description);
     }
 
     template <class Archive>
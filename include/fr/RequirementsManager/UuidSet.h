@@ -0,0 +1,187 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace fr::RequirementsManager {
+
+  /**
+   * Hash for the raw 16 bytes of a UUID. V7 UUIDs start with a
+   * timestamp, so nodes created together share their first few
+   * bytes. Mixing both halves keeps them from all landing in the
+   * same corner of a table.
+   */
+
+  struct UuidHash {
+    size_t operator()(const boost::uuids::uuid& id) const {
+      uint64_t high;
+      uint64_t low;
+      std::memcpy(&high, &*id.begin(), sizeof(high));
+      std::memcpy(&low, &*id.begin() + sizeof(high), sizeof(low));
+      // splitmix64's finalizer
+      uint64_t hash = high ^ (low * 0x9e3779b97f4a7c15ull);
+      hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+      hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+      return static_cast<size_t>(hash ^ (hash >> 31));
+    }
+  };
+
+  /**
+   * A set of UUIDs in one flat array with linear probing. Traversals
+   * used to key an unordered_map on idString(), which formatted a
+   * 36 character string (and allocated it) every time they looked at
+   * a node. This compares 16 bytes and usually touches one cache
+   * line.
+   *
+   * The nil UUID marks an empty slot, so it's tracked separately --
+   * nodes that haven't been initted all have it.
+   */
+
+  class UuidSet {
+    std::vector<boost::uuids::uuid> _slots;
+    size_t _size = 0;
+    bool _hasNil = false;
+
+    size_t mask() const {
+      return _slots.size() - 1;
+    }
+
+    size_t home(const boost::uuids::uuid& id) const {
+      return UuidHash()(id) & mask();
+    }
+
+    // Slot id is in, or the empty slot it would go in
+    size_t find(const boost::uuids::uuid& id) const {
+      size_t slot = home(id);
+      while (!_slots[slot].is_nil() && _slots[slot] != id) {
+        slot = (slot + 1) & mask();
+      }
+      return slot;
+    }
+
+    void rehash(size_t capacity) {
+      std::vector<boost::uuids::uuid> old(capacity, boost::uuids::nil_uuid());
+      old.swap(_slots);
+      for (auto& id : old) {
+        if (!id.is_nil()) {
+          _slots[find(id)] = id;
+        }
+      }
+    }
+
+  public:
+    using Type = UuidSet;
+
+    UuidSet() = default;
+
+    explicit UuidSet(size_t expected) {
+      reserve(expected);
+    }
+
+    // Make room for expected UUIDs without rehashing
+    void reserve(size_t expected) {
+      // Keep the table at most half full so probes stay short
+      size_t capacity = std::bit_ceil(std::max<size_t>(expected * 2, 16));
+      if (capacity > _slots.size()) {
+        rehash(capacity);
+      }
+    }
+
+    // Returns false if id was already in the set
+    bool insert(const boost::uuids::uuid& id) {
+      if (id.is_nil()) {
+        bool added = !_hasNil;
+        _hasNil = true;
+        return added;
+      }
+      if ((_size + 1) * 2 > _slots.size()) {
+        rehash(std::max<size_t>(_slots.size() * 2, 16));
+      }
+      auto slot = find(id);
+      if (!_slots[slot].is_nil()) {
+        return false;
+      }
+      _slots[slot] = id;
+      ++_size;
+      return true;
+    }
+
+    bool contains(const boost::uuids::uuid& id) const {
+      if (id.is_nil()) {
+        return _hasNil;
+      }
+      return !_slots.empty() && !_slots[find(id)].is_nil();
+    }
+
+    /**
+     * Returns false if id wasn't there. Entries after the hole that
+     * probed past it get shifted back into it, so lookups never need
+     * tombstones.
+     */
+    bool erase(const boost::uuids::uuid& id) {
+      if (id.is_nil()) {
+        return std::exchange(_hasNil, false);
+      }
+      if (_slots.empty()) {
+        return false;
+      }
+      auto hole = find(id);
+      if (_slots[hole].is_nil()) {
+        return false;
+      }
+      auto next = (hole + 1) & mask();
+      while (!_slots[next].is_nil()) {
+        // How far next is from where it wanted to be, and how far
+        // the hole is. If the hole's no further, next can move in.
+        auto wanted = home(_slots[next]);
+        if (((next - wanted) & mask()) >= ((next - hole) & mask())) {
+          _slots[hole] = _slots[next];
+          hole = next;
+        }
+        next = (next + 1) & mask();
+      }
+      _slots[hole] = boost::uuids::nil_uuid();
+      --_size;
+      return true;
+    }
+
+    size_t size() const {
+      return _size + (_hasNil ? 1 : 0);
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    // Forget everything but keep the table
+    void clear() {
+      std::fill(_slots.begin(), _slots.end(), boost::uuids::nil_uuid());
+      _size = 0;
+      _hasNil = false;
+    }
+  };
+
+}
@@ -21,18 +21,32 @@
 
 #include <iostream>
 #include <pqxx/pqxx>
+#include <string>
+#include <vector>
 
-int main(int argc, char *argv[]) {
-  pqxx::connection connection;
-
-  if (!connection.is_open()) {
-    std::cout << "Unable to connect to database" << std::endl;
-    exit(1);
-  }
+/**
+ * CreateTables is a migration runner. Each Migration below moves
+ * the schema from version - 1 to version, and the versions that
+ * have been applied are recorded in schema_version. Running this
+ * against an empty database builds the whole schema; running it
+ * against an existing one only applies the migrations it hasn't
+ * seen yet. Databases that were created before schema_version
+ * existed start at 0, and migration 1 (which is all CREATE ...
+ * IF NOT EXISTS) just adopts the tables that are already there.
+ *
+ * Each migration runs in its own transaction, so a failure leaves
+ * the database at the last version that applied cleanly. Never
+ * edit a migration once it's been released -- add a new one.
+ */
 
-  std::cout << "Connected to " << connection.dbname() << std::endl;
+struct Migration {
+  int version;
+  std::string description;
+  std::vector<std::string> statements;
+};
 
-  pqxx::work transaction(connection);
+// The node tables, as they were before migrations existed
+Migration initialSchema() {
   // We get node type from getNodeType so be sure your nodes
   // override it. Otherwise we won't know where to look for
   // the rest of the node information
@@ -40,9 +54,6 @@ int main(int argc, char *argv[]) {
                         "id          uuid PRIMARY KEY,"
                         "node_type   VARCHAR(100) NOT NULL);");
 
-  std::string nodeAssociationType(
-      "CREATE TYPE association_type AS ENUM('up', 'down');");
-
   std::string nodeAssociations("CREATE TABLE IF NOT EXISTS node_associations ("
                                "id            uuid,"
                                "association   uuid,"
@@ -195,111 +206,207 @@ int main(int argc, char *argv[]) {
                                  "dom_flag           BOOLEAN NOT NULL DEFAULT FALSE,"
                                  "doy_flag           BOOLEAN NOT NULL DEFAULT FALSE);");
 
+  std::string associationType(
+      "DO $$ BEGIN "
+      "CREATE TYPE association_type AS ENUM('up', 'down'); "
+      "EXCEPTION WHEN duplicate_object THEN NULL; "
+      "END $$;");
+
+  return {1, "Initial node tables", {
+      associationType,
+      nodeTable,
+      nodeAssociations,
+      graphNodeTable,
+      organizationTable,
+      commitableNodeTable,
+      projectTable,
+      productTable,
+      useCaseTable,
+      requirementTable,
+      storyTable,
+      textTable,
+      completedTable,
+      keyValueTable,
+      timeEstimateTable,
+      effortTable,
+      roleTable,
+      actorTable,
+      goalTable,
+      purposeTable,
+      personTable,
+      emailAddressTable,
+      phoneNumberTable,
+      internationalAddressTable,
+      usAddressTable,
+      eventTable,
+      todoTable,
+      recurringTodoTable
+    }};
+}
 
-  std::cout << "Checking to see if association_type exists...";
-  pqxx::result res = transaction.exec(
-      "SELECT EXISTS(SELECT 1 FROM pg_type AS t JOIN pg_namespace AS n ON "
-      "n.oid = t.typnamespace where t.typname = 'association_type' AND "
-      "n.nspname = 'public' AND t.typtype = 'e');");
-  bool enumExists = false;
-  if (res.size() == 1) {
-    enumExists = res[0][0].as<bool>();
-  }
-  if (enumExists) {
-    std::cout << " Already exists" << std::endl;
-  } else {
-    std::cout << " Not found." << std::endl;
-    std::cout << "Creating association_type...";
-    transaction.exec(nodeAssociationType);
-    std::cout << " Done" << std::endl;
+/**
+ * node_associations had no keys and no indexes, so every lookup by
+ * id (loading) and by association (removing) was a sequential scan.
+ *
+ * This removes duplicate and incomplete rows, makes (id, association,
+ * type) the primary key (which also gives us the index for looking
+ * up a node's associations) and adds a reverse index on association.
+ *
+ * It also adds foreign keys from node_associations.id and every
+ * type table's id to node, with ON DELETE CASCADE, so deleting a
+ * node row cleans up after it. Rows that point at nodes that aren't
+ * there are deleted first. There's deliberately no foreign key on
+ * node_associations.association: the per-node savers run in
+ * parallel in their own transactions, so a node's associations can
+ * reach the database before the node on the other end does.
+ */
+Migration associationIndexes() {
+  std::vector<std::string> statements{
+    "DELETE FROM node_associations "
+    "WHERE id IS NULL OR association IS NULL OR type IS NULL",
+
+    "DELETE FROM node_associations a USING node_associations b "
+    "WHERE a.ctid < b.ctid AND a.id = b.id "
+    "AND a.association = b.association AND a.type = b.type",
+
+    "ALTER TABLE node_associations "
+    "ALTER COLUMN id SET NOT NULL, "
+    "ALTER COLUMN association SET NOT NULL, "
+    "ALTER COLUMN type SET NOT NULL",
+
+    "ALTER TABLE node_associations "
+    "ADD CONSTRAINT node_associations_pkey PRIMARY KEY (id, association, type)",
+
+    "CREATE INDEX IF NOT EXISTS node_associations_association_idx "
+    "ON node_associations (association)",
+
+    "DELETE FROM node_associations na "
+    "WHERE NOT EXISTS (SELECT 1 FROM node n WHERE n.id = na.id)",
+
+    "ALTER TABLE node_associations "
+    "ADD CONSTRAINT node_associations_id_fkey FOREIGN KEY (id) "
+    "REFERENCES node (id) ON DELETE CASCADE"
+  };
+
+  // commitable_node isn't written by anything yet, but it's keyed
+  // on node ids just like the rest of them.
+  std::vector<std::string> typeTables{
+    "graph_node", "organization", "commitable_node", "project", "product",
+    "use_case", "requirement", "story", "text", "completed", "keyvalue",
+    "time_estimate", "effort", "role", "actor", "goal", "purpose", "person",
+    "email_address", "phone_number", "international_address", "us_address",
+    "event", "todo", "recurring_todo"
+  };
+
+  for (auto& table : typeTables) {
+    statements.push_back("DELETE FROM " + table + " t "
+                         "WHERE NOT EXISTS (SELECT 1 FROM node n WHERE n.id = t.id)");
+    statements.push_back("ALTER TABLE " + table + " "
+                         "ADD CONSTRAINT " + table + "_id_fkey FOREIGN KEY (id) "
+                         "REFERENCES node (id) ON DELETE CASCADE");
   }
 
-  std::cout << "Creating node table...";
-  transaction.exec(nodeTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating node_associations table...";
-  transaction.exec(nodeAssociations);
-  std::cout << " Done." << std::endl;
-  std::cout << "Creating graph_node table...";
-  transaction.exec(graphNodeTable);
-  std::cout << " Done." << std::endl;
-  std::cout << "Creating organization table...";
-  transaction.exec(organizationTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating commitable node table...";
-  transaction.exec(commitableNodeTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating project table...";
-  transaction.exec(projectTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating product table...";
-  transaction.exec(productTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating use case table...";
-  transaction.exec(useCaseTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating requirement table...";
-  transaction.exec(requirementTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating story table...";
-  transaction.exec(storyTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating text table...";
-  transaction.exec(textTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating completed table...";
-  transaction.exec(completedTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating keyvalue table...";
-  transaction.exec(keyValueTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating time_estimate table...";
-  transaction.exec(timeEstimateTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating effort table...";
-  transaction.exec(effortTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating role table...";
-  transaction.exec(roleTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating actor table...";
-  transaction.exec(actorTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating goal table...";
-  transaction.exec(goalTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating purpose table...";
-  transaction.exec(purposeTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating person table...";
-  transaction.exec(personTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating email address table...";
-  transaction.exec(emailAddressTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating phone number table...";
-  transaction.exec(phoneNumberTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating international address table...";
-  transaction.exec(internationalAddressTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating USAddress Table...";
-  transaction.exec(usAddressTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating Event Table...";
-  transaction.exec(eventTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating todo table...";
-  transaction.exec(todoTable);
-  std::cout << " Done" << std::endl;
-  std::cout << "Creating recurring todo table...";
-  transaction.exec(recurringTodoTable);
-  std::cout << " Done" << std::endl;
-  
-  std::cout << " Done" << std::endl;
-  std::cout << "Comitting transactions...";
+  return {2, "node_associations keys and indexes, node foreign keys", statements};
+}
+
+/**
+ * Migration 3 adds node_edges, which holds one row per (parent,
+ * child) edge for database::EdgeStorage::Normalized, and fills it
+ * from node_associations. A down row and the matching up row on
+ * the other node collapse into the same edge, and edges that only
+ * got written from one end still come across.
+ *
+ * node_associations is left alone, since mirrored storage is still
+ * the default. There are no foreign keys on node_edges for the
+ * same reason there isn't one on node_associations.association:
+ * either end of an edge can save it, so an edge can show up before
+ * one of its nodes does. Removing a node deletes its edges
+ * explicitly instead.
+ */
+Migration edgeTable() {
+  return {3, "node_edges, one row per edge", {
+    "CREATE TABLE IF NOT EXISTS node_edges ("
+    "parent        uuid NOT NULL,"
+    "child         uuid NOT NULL,"
+    "PRIMARY KEY (parent, child));",
+
+    "CREATE INDEX IF NOT EXISTS node_edges_child_idx ON node_edges (child)",
+
+    "INSERT INTO node_edges (parent, child) "
+    "SELECT id, association FROM node_associations WHERE type = 'down' "
+    "UNION "
+    "SELECT association, id FROM node_associations WHERE type = 'up' "
+    "ON CONFLICT DO NOTHING"
+  }};
+}
+
+// Every migration, in order. Add new ones to the end.
+std::vector<Migration> migrations() {
+  return {
+    initialSchema(),
+    associationIndexes(),
+    edgeTable()
+  };
+}
+
+int currentVersion(pqxx::connection& connection) {
+  pqxx::work transaction(connection);
+  transaction.exec("CREATE TABLE IF NOT EXISTS schema_version ("
+                   "version       INTEGER PRIMARY KEY,"
+                   "description   TEXT NOT NULL,"
+                   "applied       TIMESTAMP NOT NULL DEFAULT now());");
+  pqxx::result res = transaction.exec("SELECT COALESCE(MAX(version), 0) FROM schema_version");
+  transaction.commit();
+  return res[0][0].as<int>();
+}
+
+void apply(pqxx::connection& connection, const Migration& migration) {
+  pqxx::work transaction(connection);
+  // Keep two copies of this from migrating the same database at once
+  transaction.exec("SELECT pg_advisory_xact_lock(hashtext('schema_version'))");
+  pqxx::params p{
+    migration.version
+  };
+  pqxx::result applied = transaction.exec("SELECT 1 FROM schema_version WHERE version = $1", p);
+  if (applied.size() > 0) {
+    std::cout << " Already applied." << std::endl;
+    return;
+  }
+  for (auto& statement : migration.statements) {
+    transaction.exec(statement);
+  }
+  pqxx::params record{
+    migration.version,
+    migration.description
+  };
+  transaction.exec("INSERT INTO schema_version (version, description) VALUES ($1, $2)", record);
   transaction.commit();
-  std::cout << "Done." << std::endl;
+  std::cout << " Done." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  pqxx::connection connection;
+
+  if (!connection.is_open()) {
+    std::cout << "Unable to connect to database" << std::endl;
+    exit(1);
+  }
+
+  std::cout << "Connected to " << connection.dbname() << std::endl;
+
+  int version = currentVersion(connection);
+  auto all = migrations();
+  std::cout << "Schema is at version " << version << " of "
+            << all.back().version << std::endl;
+
+  for (auto& migration : all) {
+    if (migration.version <= version) {
+      continue;
+    }
+    std::cout << "Applying migration " << migration.version << " ("
+              << migration.description << ")...";
+    apply(connection, migration);
+  }
 
   std::cout << "Processing complete." << std::endl;
 }
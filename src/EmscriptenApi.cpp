@@ -34,6 +34,7 @@ EMSCRIPTEN_BINDINGS(FRRequirementsManager) {
       .property("up", &Node::up, return_value_policy::reference())
       .property("down", &Node::down, return_value_policy::reference())
       .property("changed", &Node::changed, return_value_policy::reference())
+      .property("persisted", &Node::persisted, return_value_policy::reference())
       .function("idString", &Node::idString)
       .function("setUuid", &Node::setUuid)
       .function("init", &Node::init)
@@ -27,11 +27,10 @@ void connectNodes(Node::PtrType parent, Node::PtrType child) {
     child->init();
   }
 
-  parent->changed = true;
-  child->changed = true;
-
-  parent->down.push_back(child);
-  child->up.push_back(parent);
+  // These record the new edge on both nodes (and set changed) so
+  // the next save only has to write the edge
+  parent->addDown(child);
+  child->addUp(parent);
 }
 
 } // namespace fr::RequirementsManager
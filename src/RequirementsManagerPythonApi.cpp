@@ -15,13 +15,18 @@
  */
 
 #include <fr/RequirementsManager.h>
+#include <fr/RequirementsManager/TaskHandle.h>
 #include <fr/RequirementsManager/TaskNode.h>
 #include <fr/RequirementsManager/ThreadPool.h>
 #include <fr/RequirementsManager/GraphServer.h>
+#include <fr/RequirementsManager/GraphSnapshot.h>
 #include <memory>
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/array.h>
 #include <nanobind/stl/bind_vector.h>
 #include <nanobind/stl/chrono.h>
+#include <nanobind/stl/map.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
@@ -88,6 +93,86 @@ NB_MODULE(FRRequirements, m) {
       .value("Shutdown", ThreadState::Shutdown)
       .export_values();
 
+  nanobind::enum_<TaskPriority>(m, "TaskPriority")
+      .value("Interactive", TaskPriority::Interactive)
+      .value("Normal", TaskPriority::Normal)
+      .value("Bulk", TaskPriority::Bulk)
+      .export_values();
+
+  nanobind::enum_<OverflowPolicy>(m, "OverflowPolicy")
+      .value("Block", OverflowPolicy::Block)
+      .value("Reject", OverflowPolicy::Reject)
+      .value("DropLowest", OverflowPolicy::DropLowest)
+      .export_values();
+
+  nanobind::exception<QueueFullError>(m, "QueueFullError");
+  nanobind::exception<TaskCancelled>(m, "TaskCancelled");
+
+  nanobind::class_<CancellationToken>(m, "CancellationToken")
+      .def(nanobind::init<>())
+      .def_static("create", &CancellationToken::create,
+                  "A token that's cancelled when you call cancel")
+      .def_static("withTimeout", &CancellationToken::withTimeout,
+                  "A token that cancels itself once timeout has passed")
+      .def("valid", &CancellationToken::valid)
+      .def("cancel", &CancellationToken::cancel,
+           nanobind::call_guard<nanobind::gil_scoped_release>())
+      .def("cancelled", &CancellationToken::cancelled);
+
+  // Node constructors allocate from the current arena. Use it as a
+  // context manager:
+  //   with GraphArena() as arena:
+  //       req = Requirement()
+
+  nanobind::class_<GraphArena>(m, "GraphArena")
+      .def(nanobind::new_([]() { return GraphArena::create(); }))
+      .def(nanobind::new_([](size_t blockSize) { return GraphArena::create(blockSize); }),
+           nanobind::arg("blockSize"))
+      .def("allocated", &GraphArena::allocated,
+           "Bytes allocated from the arena so far")
+      .def("__enter__", [](GraphArena::PtrType arena) {
+        GraphArena::enter(arena);
+        return arena;
+      })
+      .def("__exit__", [](GraphArena::PtrType arena, nanobind::args) {
+        GraphArena::leave(arena);
+      });
+
+  // Read-only copy of a graph's shape. Nodes are numbered from 0
+  // (the node you froze) and links come back as node numbers.
+
+  nanobind::class_<GraphSnapshot>(m, "GraphSnapshot")
+      .def(nanobind::init<>())
+      .def_static("freeze", [](Node::PtrType start) { return GraphSnapshot::freeze(start); },
+                  "Snapshot everything reachable from a node through its up "
+                  "and down lists")
+      .def_static("from_json", &GraphSnapshot::from_json)
+      .def("to_json", &GraphSnapshot::to_json)
+      .def("size", &GraphSnapshot::size)
+      .def("find", [](const GraphSnapshot& snapshot, const std::string& id) -> std::optional<GraphSnapshot::Index> {
+        auto found = snapshot.find(id);
+        if (found == GraphSnapshot::npos) {
+          return std::nullopt;
+        }
+        return found;
+      }, "Node number for a UUID, or None")
+      .def("idString", &GraphSnapshot::idString)
+      .def("nodeType", &GraphSnapshot::nodeType)
+      .def("up", [](const GraphSnapshot& snapshot, GraphSnapshot::Index node) {
+        auto up = snapshot.up(node);
+        return std::vector<GraphSnapshot::Index>(up.begin(), up.end());
+      })
+      .def("down", [](const GraphSnapshot& snapshot, GraphSnapshot::Index node) {
+        auto down = snapshot.down(node);
+        return std::vector<GraphSnapshot::Index>(down.begin(), down.end());
+      })
+      .def("reachable", [](const GraphSnapshot& snapshot, GraphSnapshot::Index from, GraphSnapshot::Index to) {
+        return snapshot.reachable(from, to);
+      }, "True if you can get from one node to the other through down links")
+      .def("reachableFrom", [](const GraphSnapshot& snapshot, GraphSnapshot::Index start) {
+        return snapshot.reachableFrom(start);
+      }, "Every node under start, nearest first");
+
   // TaskNode is a pure virtual class -- do not create directly
 
   nanobind::class_<TaskNode<WorkerThread>>(m, "TaskNode")
@@ -95,8 +180,95 @@ NB_MODULE(FRRequirements, m) {
         throw std::logic_error(
             "Tasknode is a pure virtual class -- do not create one directly in "
             "Python (Are you looking for SaveNodesNode or PqNodeFactory?");
-      }));
+      }))
+      // These live in Task, which isn't bound on its own
+      .def("getGroup", [](TaskNode<WorkerThread>& task) { return task.getGroup(); })
+      .def("setGroup", [](TaskNode<WorkerThread>& task, const std::string& group) { task.setGroup(group); },
+           "Set the group this task shares the threadpool as. Tasks enqueued "
+           "from inside it join the same group.")
+      .def("getPriority", [](TaskNode<WorkerThread>& task) { return task.getPriority(); })
+      .def("setPriority", [](TaskNode<WorkerThread>& task, TaskPriority priority) { task.setPriority(priority); },
+           "Set the TaskPriority this task is queued with. Takes effect the "
+           "next time it's enqueued.")
+      .def("getCancellation", [](TaskNode<WorkerThread>& task) { return task.getCancellation(); })
+      .def("setCancellation", [](TaskNode<WorkerThread>& task, CancellationToken token) { task.setCancellation(token); },
+           "Cancel this task and everything it enqueues when token is "
+           "cancelled. Set it before enqueueing the task.")
+      .def("cancelled", [](TaskNode<WorkerThread>& task) { return task.cancelled(); })
+      .def("getAuditTrail", &TaskNode<WorkerThread>::getAuditTrail)
+      .def("setAuditTrail", &TaskNode<WorkerThread>::setAuditTrail,
+           "Keep the child tasks this task creates in its down list. Off by "
+           "default.");
   
+  // Returned from ThreadPool.enqueue
+  nanobind::class_<TaskHandle>(m, "TaskHandle")
+      .def("valid", &TaskHandle::valid,
+           "False if this handle doesn't refer to any task")
+      .def("done", &TaskHandle::done,
+           "True once the task and everything it enqueued have finished")
+      .def("wait", &TaskHandle::wait,
+           nanobind::call_guard<nanobind::gil_scoped_release>(),
+           "Block until the task and everything it enqueued have finished. "
+           "Raises if any of them threw.")
+      .def("waitFor", &TaskHandle::waitFor,
+           nanobind::call_guard<nanobind::gil_scoped_release>(),
+           "Block for at most the given timedelta. Returns True if the task "
+           "finished in that time.");
+
+  // ThreadPool.metrics returns a PoolMetrics
+  nanobind::class_<LatencyHistogram>(m, "LatencyHistogram")
+      .def("count", &LatencyHistogram::count)
+      .def("total", &LatencyHistogram::total)
+      .def("max", &LatencyHistogram::max)
+      .def("mean", &LatencyHistogram::mean)
+      .def("percentile", &LatencyHistogram::percentile,
+           "Roughly the duration that fraction (0 to 1) of the samples "
+           "were under")
+      .def("buckets", &LatencyHistogram::buckets,
+           "Sample counts. Bucket 0 is under a microsecond and bucket i is "
+           "2^(i-1) to 2^i microseconds.");
+
+  nanobind::class_<TaskTypeMetrics>(m, "TaskTypeMetrics")
+      .def_ro("wait", &TaskTypeMetrics::wait,
+              "Time from enqueue until a worker started the task")
+      .def_ro("run", &TaskTypeMetrics::run, "Time spent running the task")
+      .def_ro("errors", &TaskTypeMetrics::errors)
+      .def_ro("cancelled", &TaskTypeMetrics::cancelled,
+              "Tasks skipped because they were cancelled before they ran");
+
+  nanobind::class_<WorkerMetrics>(m, "WorkerMetrics")
+      .def_ro("tasks", &WorkerMetrics::tasks)
+      .def_ro("busy", &WorkerMetrics::busy)
+      .def_ro("elapsed", &WorkerMetrics::elapsed)
+      .def("busyRatio", &WorkerMetrics::busyRatio)
+      .def("idleRatio", &WorkerMetrics::idleRatio);
+
+  nanobind::class_<PoolMetrics>(m, "PoolMetrics")
+      .def_ro("elapsed", &PoolMetrics::elapsed)
+      .def_ro("completed", &PoolMetrics::completed)
+      .def_ro("queued", &PoolMetrics::queued)
+      .def_ro("blocked", &PoolMetrics::blocked)
+      .def_ro("maxQueued", &PoolMetrics::maxQueued)
+      .def_ro("depths", &PoolMetrics::depths)
+      .def_ro("types", &PoolMetrics::types,
+              "TaskTypeMetrics for each task type that has run")
+      .def_ro("workers", &PoolMetrics::workers)
+      .def_ro("threads", &PoolMetrics::threads)
+      .def_ro("grown", &PoolMetrics::grown,
+              "Workers an elastic pool has added")
+      .def_ro("retired", &PoolMetrics::retired,
+              "Workers an elastic pool has retired")
+      .def("tasksPerSecond", &PoolMetrics::tasksPerSecond);
+
+  nanobind::class_<ElasticSettings>(m, "ElasticSettings")
+      .def(nanobind::init<>())
+      .def_rw("minThreads", &ElasticSettings::minThreads)
+      .def_rw("maxThreads", &ElasticSettings::maxThreads)
+      .def_rw("targetWait", &ElasticSettings::targetWait,
+              "Add a worker when tasks have waited longer than this")
+      .def_rw("idleTimeout", &ElasticSettings::idleTimeout,
+              "Retire workers that have been idle this long");
+
   // Threadpool (Currently for database saving and loading)
   nanobind::class_<ThreadPool<WorkerThread>>(m, "ThreadPool")
       .def(nanobind::new_(
@@ -106,13 +278,55 @@ NB_MODULE(FRRequirements, m) {
       .def("startThreads", &ThreadPool<WorkerThread>::startThreads,
            "Start threads. Int parameter is the number of threads to start. "
            "Between 2 and 4 are usually good numbers.")
+      .def("startElastic", &ThreadPool<WorkerThread>::startElastic,
+           "Start ElasticSettings.minThreads workers and grow or shrink "
+           "between that and maxThreads with the load. Use instead of "
+           "startThreads.")
+      .def("isElastic", &ThreadPool<WorkerThread>::isElastic)
+      .def("getElasticSettings", &ThreadPool<WorkerThread>::getElasticSettings)
+      .def("workerCount", &ThreadPool<WorkerThread>::workerCount,
+           "Number of workers running right now")
       .def("workerStatus", &ThreadPool<WorkerThread>::workerStatus,
            "Returns an array with the ThreadState status of each worker.")
       .def("hasWork", &ThreadPool<WorkerThread>::hasWork,
            "Returns true if work is currently queued up in the threadpool")
-      .def("enqueue", &ThreadPool<WorkerThread>::enqueue,
+      .def("depth", &ThreadPool<WorkerThread>::depth,
+           "Number of tasks waiting to run at the given TaskPriority")
+      .def("depths", &ThreadPool<WorkerThread>::depths,
+           "Number of tasks waiting at each TaskPriority, Interactive first")
+      .def("setGroupWeight", &ThreadPool<WorkerThread>::setGroupWeight,
+           "Give a task group this many turns for every one the other groups "
+           "get")
+      .def("setGroupLimit", &ThreadPool<WorkerThread>::setGroupLimit,
+           "Never run more than this many tasks from a group at once. 0 means "
+           "no limit.")
+      .def("getGroupWeight", &ThreadPool<WorkerThread>::getGroupWeight)
+      .def("getGroupLimit", &ThreadPool<WorkerThread>::getGroupLimit)
+      .def("getAgingInterval", &ThreadPool<WorkerThread>::getAgingInterval)
+      .def("setAgingInterval", &ThreadPool<WorkerThread>::setAgingInterval,
+           "How long Normal and Bulk tasks can wait before they get a turn "
+           "ahead of more urgent work. Zero disables aging.")
+      .def("metrics", &ThreadPool<WorkerThread>::metrics,
+           "Queue wait and run time histograms per task type, worker busy "
+           "ratios and queue depths")
+      .def("resetMetrics", &ThreadPool<WorkerThread>::resetMetrics)
+      .def("getMetricsEnabled", &ThreadPool<WorkerThread>::getMetricsEnabled)
+      .def("setMetricsEnabled", &ThreadPool<WorkerThread>::setMetricsEnabled)
+      .def("getCapacity", &ThreadPool<WorkerThread>::getCapacity)
+      .def("setCapacity", &ThreadPool<WorkerThread>::setCapacity,
+           "Number of tasks that can wait in the queue before enqueue applies "
+           "the overflow policy. 0 means no limit.")
+      .def("getOverflowPolicy", &ThreadPool<WorkerThread>::getOverflowPolicy)
+      .def("setOverflowPolicy", &ThreadPool<WorkerThread>::setOverflowPolicy,
+           "What enqueue does when the queue is full")
+      .def("enqueue",
+           [](ThreadPool<WorkerThread>& pool, TaskNode<WorkerThread>::PtrType task) {
+             return pool.enqueue(task);
+           },
+           nanobind::call_guard<nanobind::gil_scoped_release>(),
            "Queue up a worker to be run whenever the threadpool gets around to "
-           "it.")
+           "it. Returns a TaskHandle you can wait on. Raises QueueFullError "
+           "if the queue is full and the overflow policy doesn't block.")
       .def("shutdown", &ThreadPool<WorkerThread>::shutdown,
            "Shut down the threadpool. Threadpool will process remaining work "
            "before finally shutting down.")
@@ -129,6 +343,26 @@ NB_MODULE(FRRequirements, m) {
     .def("start", &GraphServer<WorkerThread>::start,
          "Start the server. Pass in number of threads to start for the "
          "endpoint and number of threads to start for the database threadpool")
+    .def("setQueueCapacity", &GraphServer<WorkerThread>::setQueueCapacity,
+         nanobind::arg("capacity"), nanobind::arg("policy") = OverflowPolicy::Reject,
+         "Answer requests with a 503 once this many tasks are waiting in the "
+         "threadpool. 0 means no limit.")
+    .def("setElastic", &GraphServer<WorkerThread>::setElastic,
+         "Size the database threadpool with ElasticSettings. Call before "
+         "start.")
+    .def("setRequestTimeout", &GraphServer<WorkerThread>::setRequestTimeout,
+         "How long a graph load can take before it's cancelled and the "
+         "client gets a 504. 0 for no limit.")
+    .def("setUseArenas", &GraphServer<WorkerThread>::setUseArenas,
+         "Allocate each graph a request loads or posts in its own "
+         "GraphArena")
+    .def("setParallelMarking", &GraphServer<WorkerThread>::setParallelMarking,
+         "Posted graphs with more than threshold nodes are marked for "
+         "saving by threads workers that never touch the database. 0 "
+         "threads, the default, marks everything on the request's "
+         "thread. Call before start.")
+    .def("setRetryAfter", &GraphServer<WorkerThread>::setRetryAfter,
+         "Seconds clients are told to wait before retrying after a 503")
     .def("shutdown", &GraphServer<WorkerThread>::shutdown,
          "Shut down the server");
   
@@ -157,6 +391,9 @@ NB_MODULE(FRRequirements, m) {
       }))
       .def("getNode", &PqNodeFactory<WorkerThread>::getNode,
            "Retrieves the node you asked to be loaded.")
+      .def("setArena", &PqNodeFactory<WorkerThread>::setArena,
+           "Allocate the graph's nodes from a GraphArena. Call before "
+           "enqueueing the factory.")
       .def("graphLoaded", &PqNodeFactory<WorkerThread>::graphLoaded,
            "Returns true if your graph is loaded. The ThreadPool could still "
            "be busy loading node data into the nodes. You can check its "
@@ -168,15 +405,34 @@ NB_MODULE(FRRequirements, m) {
   // other things inherit from it
 
   nanobind::class_<Node>(m, "Node")
-      .def(nanobind::new_([]() { return std::make_shared<Node>(); }))
-      .def_rw("up", &Node::up,
-              "Node up-list. This indicates some sort of owner/parent "
-              "relationship.")
-      .def_rw("down", &Node::down,
-              "Node down-list. This indicates some sort of owned/child "
-              "relationship")
+      .def(nanobind::new_([]() { return makeNode<Node>(); }))
+      // Assigning a whole list goes through setUp/setDown so the
+      // node's lookup indexes don't go stale
+      .def_prop_rw("up",
+                   [](Node& node) -> std::vector<Node::PtrType>& { return node.up; },
+                   [](Node& node, const std::vector<Node::PtrType>& nodes) { node.setUp(nodes); },
+                   nanobind::rv_policy::reference_internal,
+                   "Node up-list. This indicates some sort of owner/parent "
+                   "relationship. Appending to it is fine, but call reindex "
+                   "after changing it in place any other way.")
+      .def_prop_rw("down",
+                   [](Node& node) -> std::vector<Node::PtrType>& { return node.down; },
+                   [](Node& node, const std::vector<Node::PtrType>& nodes) { node.setDown(nodes); },
+                   nanobind::rv_policy::reference_internal,
+                   "Node down-list. This indicates some sort of owned/child "
+                   "relationship. Appending to it is fine, but call reindex "
+                   "after changing it in place any other way.")
+      .def("reindex", &Node::reindex,
+           "Rebuild the node's lookup indexes after changing up, down or "
+           "edgeChanges in place")
       .def_rw("changed", &Node::changed,
               "Indicates some data in the node changed.")
+      .def_rw("persisted", &Node::persisted,
+              "Indicates the node was loaded from or saved to the database, "
+              "so saves only need to write what changed since then.")
+      .def_ro("dirtyFields", &Node::dirtyFields,
+              "Bitmask of the fields set since the node was last loaded or "
+              "saved.")
       .def("idString", &Node::idString,
            "Unique (UUIDV7) ID. You must call init to set the id, initally.")
       .def("setUuid", &Node::setUuid, "Set this node's UUID from a string")
@@ -189,7 +445,7 @@ NB_MODULE(FRRequirements, m) {
   // directly -- other things inherit from it
 
   nanobind::class_<CommitableNode, Node>(m, "CommitableNode")
-      .def(nanobind::new_([]() { return std::make_shared<CommitableNode>(); }))
+      .def(nanobind::new_([]() { return makeNode<CommitableNode>(); }))
       .def("commit", &CommitableNode::commit,
            "Commits this node, making further change impossible. This is for "
            "traceability -- to make a change to a committed node, create a "
@@ -212,12 +468,12 @@ NB_MODULE(FRRequirements, m) {
            "committed.");
 
   nanobind::class_<GraphNode, Node>(m, "GraphNode")
-      .def(nanobind::new_([]() { return std::make_shared<GraphNode>(); }))
+      .def(nanobind::new_([]() { return makeNode<GraphNode>(); }))
       .def("setTitle", &GraphNode::setTitle, "Set graph title")
       .def("getTitle", &GraphNode::getTitle, "get graph title");
 
   nanobind::class_<Organization, Node>(m, "Organization")
-      .def(nanobind::new_([]() { return std::make_shared<Organization>(); }))
+      .def(nanobind::new_([]() { return makeNode<Organization>(); }))
       .def("isLocked", &Organization::isLocked,
            "Checks to see if the organization is locked. If it's locked you "
            "can't change its name.")
@@ -231,7 +487,7 @@ NB_MODULE(FRRequirements, m) {
            "Unlocks the organization, allowing its name to be changed.");
 
   nanobind::class_<Product, CommitableNode>(m, "Product")
-      .def(nanobind::new_([]() { return std::make_shared<Product>(); }))
+      .def(nanobind::new_([]() { return makeNode<Product>(); }))
       .def("setTitle", &Product::setTitle, "Set the product title")
       .def("setDescription", &Product::setDescription,
            "Set the product description")
@@ -240,7 +496,7 @@ NB_MODULE(FRRequirements, m) {
            "Get the product description");
 
   nanobind::class_<Project, Node>(m, "Project")
-      .def(nanobind::new_([]() { return std::make_shared<Project>(); }))
+      .def(nanobind::new_([]() { return makeNode<Project>(); }))
       .def("setName", &Project::setName, "Sets the project name")
       .def("setDescription", &Project::setDescription,
            "Sets the project description")
@@ -249,7 +505,7 @@ NB_MODULE(FRRequirements, m) {
            "Gets the project description");
 
   nanobind::class_<Requirement, CommitableNode>(m, "Requirement")
-      .def(nanobind::new_([]() { return std::make_shared<Requirement>(); }))
+      .def(nanobind::new_([]() { return makeNode<Requirement>(); }))
       .def("setTitle", &Requirement::setTitle, "Set the requirement title")
       .def("setText", &Requirement::setText, "Set the requirement text")
       .def("setFunctional", &Requirement::setFunctional,
@@ -261,7 +517,7 @@ NB_MODULE(FRRequirements, m) {
            "Returns true if the requirement is a functional requirement");
 
   nanobind::class_<Story, CommitableNode>(m, "Story")
-      .def(nanobind::new_([]() { return std::make_shared<Story>(); }))
+      .def(nanobind::new_([]() { return makeNode<Story>(); }))
       .def("getTitle", &Story::getTitle, "Get the Story title")
       .def("setTitle", &Story::setTitle, "Set the Story title")
       .def("getGoal", &Story::getGoal, "Get the story goal")
@@ -270,31 +526,31 @@ NB_MODULE(FRRequirements, m) {
       .def("setBenefit", &Story::setBenefit, "Set the story benefit");
 
   nanobind::class_<UseCase, CommitableNode>(m, "UseCase")
-      .def(nanobind::new_([]() { return std::make_shared<UseCase>(); }))
+      .def(nanobind::new_([]() { return makeNode<UseCase>(); }))
       .def("setName", &UseCase::setName, "Set the use case name")
       .def("getName", &UseCase::getName, "Get the use case name");
 
   nanobind::class_<Text, Node>(m, "Text")
-      .def(nanobind::new_([]() { return std::make_shared<Text>(); }))
+      .def(nanobind::new_([]() { return makeNode<Text>(); }))
       .def("setText", &Text::setText, "Set the text for this node")
       .def("getText", &Text::getText, "Get the text for this node");
 
   nanobind::class_<Completed, Node>(m, "Completed")
-      .def(nanobind::new_([]() { return std::make_shared<Completed>(); }))
+      .def(nanobind::new_([]() { return makeNode<Completed>(); }))
       .def("setDescription", &Completed::setDescription,
            "Set the description for this completed node.")
       .def("getDescription", &Completed::getDescription,
            "Get the description for this completed node.");
 
   nanobind::class_<KeyValue, Node>(m, "KeyValue")
-      .def(nanobind::new_([]() { return std::make_shared<KeyValue>(); }))
+      .def(nanobind::new_([]() { return makeNode<KeyValue>(); }))
       .def("setKey", &KeyValue::setKey, "Sets the key name for this node")
       .def("getKey", &KeyValue::getKey, "Gets the key name for this node")
       .def("setValue", &KeyValue::setValue, "Sets the value of this node")
       .def("getValue", &KeyValue::getValue, "Gets the value for this node");
 
   nanobind::class_<TimeEstimate, Node>(m, "TimeEstimate")
-      .def(nanobind::new_([]() { return std::make_shared<TimeEstimate>(); }))
+      .def(nanobind::new_([]() { return makeNode<TimeEstimate>(); }))
       .def("setText", &TimeEstimate::setText, "Sets the text for this node")
       .def("getText", &TimeEstimate::getText, "Gets the text for this node")
       .def("setEstimate", &TimeEstimate::setEstimate,
@@ -311,7 +567,7 @@ NB_MODULE(FRRequirements, m) {
            "Date work on this estimate started.");
 
   nanobind::class_<Effort, Node>(m, "Effort")
-      .def(nanobind::new_([]() { return std::make_shared<Effort>(); }))
+      .def(nanobind::new_([]() { return makeNode<Effort>(); }))
       .def("setText", &Effort::setText, "Set the text for this node")
       .def("getText", &Effort::getText, "Get the text for this node")
       .def("setEffort", &Effort::setEffort,
@@ -322,17 +578,17 @@ NB_MODULE(FRRequirements, m) {
            "Get the effort (duration, seconds) for this node");
 
   nanobind::class_<Role, Node>(m, "Role")
-      .def(nanobind::new_([]() { return std::make_shared<Role>(); }))
+      .def(nanobind::new_([]() { return makeNode<Role>(); }))
       .def("setWho", &Role::setWho, "Sets the who value for this node")
       .def("getWho", &Role::getWho, "Gets the who value for this node");
 
   nanobind::class_<Actor, Node>(m, "Actor")
-      .def(nanobind::new_([]() { return std::make_shared<Actor>(); }))
+      .def(nanobind::new_([]() { return makeNode<Actor>(); }))
       .def("getActor", &Actor::getActor, "Gets the actor text for this node")
       .def("setActor", &Actor::setActor, "Sets the actor text for this node");
 
   nanobind::class_<Goal, Node>(m, "Goal")
-      .def(nanobind::new_([]() { return std::make_shared<Goal>(); }))
+      .def(nanobind::new_([]() { return makeNode<Goal>(); }))
       .def("setAction", &Goal::setAction,
            "Set the action (what will be done) part of this goal")
       .def("setOutcome", &Goal::setOutcome,
@@ -355,7 +611,7 @@ NB_MODULE(FRRequirements, m) {
            "Get the target date confidence/flexibility/priority (string tag)");
 
   nanobind::class_<Purpose, Node>(m, "Purpose")
-      .def(nanobind::new_([]() { return std::make_shared<Purpose>(); }))
+      .def(nanobind::new_([]() { return makeNode<Purpose>(); }))
       .def("setDescription", &Purpose::setDescription,
            "Set the description of this purpose (IE: You pass butter)")
       .def("setDeadline", &Purpose::setDeadline,
@@ -372,14 +628,14 @@ NB_MODULE(FRRequirements, m) {
            "tag)");
 
   nanobind::class_<Person, Node>(m, "Person")
-      .def(nanobind::new_([]() { return std::make_shared<Person>(); }))
+      .def(nanobind::new_([]() { return makeNode<Person>(); }))
       .def("setLastName", &Person::setLastName, "Set last name")
       .def("setFirstName", &Person::setFirstName, "Set first name")
       .def("getLastName", &Person::getLastName, "Get last name")
       .def("getFirstName", &Person::getFirstName, "Get first name");
 
   nanobind::class_<PhoneNumber, Node>(m, "PhoneNumber")
-      .def(nanobind::new_([]() { return std::make_shared<PhoneNumber>(); }))
+      .def(nanobind::new_([]() { return makeNode<PhoneNumber>(); }))
       .def("setCountryCode", &PhoneNumber::setCountryCode,
            "Set country code (nominally optional if you're a one country "
            "project.)")
@@ -393,7 +649,7 @@ NB_MODULE(FRRequirements, m) {
 
   nanobind::class_<InternationalAddress, Node>(m, "InternationalAddress")
       .def(nanobind::new_(
-          []() { return std::make_shared<InternationalAddress>(); }))
+          []() { return makeNode<InternationalAddress>(); }))
       .def("setCountryCode", &InternationalAddress::setCountryCode,
            "Set country code (ISO 3166-1 Country codes)")
       .def("setAddressLines", &InternationalAddress::setAddressLines,
@@ -413,7 +669,7 @@ NB_MODULE(FRRequirements, m) {
            "Get Postal/Zip code");
 
   nanobind::class_<Event, Node>(m, "Event")
-      .def(nanobind::new_([]() { return std::make_shared<Event>(); }))
+      .def(nanobind::new_([]() { return makeNode<Event>(); }))
       .def("getName", &Event::getName, "Gets the name of this event")
       .def("setName", &Event::setName, "Sets the name of this event")
       .def("getDescription", &Event::getDescription,
@@ -20,7 +20,7 @@
 
 void printHelp(const std::string& programName, const boost::program_options::options_description &desc) {
 
-  std::cout << "Usage: " << programName << " [-p port] [-a address] [-t threads]" << std::endl;
+  std::cout << "Usage: " << programName << " [-p port] [-a address] [-t threads] [--min-threads n] [--max-threads n]" << std::endl;
   std::cout << "Port is optional and defaults to 8080" << std::endl;
   std::cout << "Address is optional and defaults to 127.0.0.1" << std::endl;
   std::cout << "Use address 0.0.0.0 to make the server listen on all interfaces." << std::endl;
@@ -32,6 +32,17 @@ int main(int argc, char *argv[]) {
   const std::string programName(argv[0]);
   int port = 8080;
   std::string address("127.0.0.1");
+  size_t queueCapacity = 4096;
+  int retryAfter = 5;
+  bool dropSaves = false;
+  int endpointThreads = 2;
+  ElasticSettings elastic;
+  unsigned int targetWait = 50;
+  unsigned int idleTimeout = 30;
+  unsigned int requestTimeout = 30;
+  bool arenas = false;
+  size_t parallelThreshold = 50000;
+  unsigned int traversalThreads = 0;
   boost::program_options::options_description desc("Options");
   desc.add_options()
     ("help,h", "Print help message")
@@ -42,6 +53,42 @@ int main(int argc, char *argv[]) {
      boost::program_options::value<std::string>(&address)->default_value("127.0.0.1"),
      "Listen address (use 0.0.0.0 to listen on all interfaces.)"
      )
+    ("queue-capacity,q",
+     boost::program_options::value<size_t>(&queueCapacity)->default_value(4096),
+     "Tasks the database threadpool will queue up before requests get a 503. 0 for no limit.")
+    ("retry-after",
+     boost::program_options::value<int>(&retryAfter)->default_value(5),
+     "Seconds to tell clients to wait in the Retry-After header of a 503.")
+    ("drop-saves",
+     boost::program_options::bool_switch(&dropSaves),
+     "When the queue's full, throw out queued saves to make room for reads instead of turning the reads away. Saves that get dropped are lost.")
+    ("endpoint-threads,t",
+     boost::program_options::value<int>(&endpointThreads)->default_value(2),
+     "Threads handling HTTP requests.")
+    ("min-threads",
+     boost::program_options::value<unsigned int>(&elastic.minThreads)->default_value(1),
+     "Database threads to keep around when the server's idle.")
+    ("max-threads",
+     boost::program_options::value<unsigned int>(&elastic.maxThreads)->default_value(8),
+     "Most database threads to start under load.")
+    ("target-wait",
+     boost::program_options::value<unsigned int>(&targetWait)->default_value(50),
+     "Milliseconds requests can sit in the queue before another database thread is started.")
+    ("idle-timeout",
+     boost::program_options::value<unsigned int>(&idleTimeout)->default_value(30),
+     "Seconds a database thread can sit idle before it's stopped.")
+    ("request-timeout",
+     boost::program_options::value<unsigned int>(&requestTimeout)->default_value(30),
+     "Seconds a graph load can take before it's cancelled and the client gets a 504. 0 for no limit.")
+    ("arenas",
+     boost::program_options::bool_switch(&arenas),
+     "Allocate each graph a request loads or posts in its own arena, freed in one go when the request's done.")
+    ("parallel-threshold",
+     boost::program_options::value<size_t>(&parallelThreshold)->default_value(50000),
+     "Posted graphs bigger than this many nodes get split between the traversal threads to be marked for saving.")
+    ("traversal-threads",
+     boost::program_options::value<unsigned int>(&traversalThreads)->default_value(0),
+     "Threads marking big posted graphs. These never touch the database. 0 marks every graph on the request's thread.")
     ;
      
   boost::program_options::variables_map vm;
@@ -54,8 +101,19 @@ int main(int argc, char *argv[]) {
   }
 
   GraphServer<WorkerThread> server(address, port);
-  // TODO: Allow the user to specify thread counts
-  server.start(2,2);
+  // A bulk import used to be able to queue up work until we got
+  // OOM-killed.
+  server.setQueueCapacity(queueCapacity, dropSaves ? OverflowPolicy::DropLowest : OverflowPolicy::Reject);
+  server.setRetryAfter(std::chrono::seconds(retryAfter));
+  server.setRequestTimeout(std::chrono::seconds(requestTimeout));
+  server.setUseArenas(arenas);
+  server.setParallelMarking(parallelThreshold, traversalThreads);
+  // Mostly idle, then a pile of saves all at once from CI, so let
+  // the database threadpool size itself
+  elastic.targetWait = std::chrono::milliseconds(targetWait);
+  elastic.idleTimeout = std::chrono::seconds(idleTimeout);
+  server.setElastic(elastic);
+  server.start(endpointThreads, elastic.minThreads);
   std::cout << "Server started on " << address << ":" << port << std::endl;
   // TODO: Install a signal handler to handle sigint(ctrl-c)/sighup?
   server.join();
@@ -15,9 +15,12 @@
  *
  */
 
+#include <format>
 #include <fr/RequirementsManager/Node.h>
 #include <fr/RequirementsManager/NodeConnector.h>
+#include <fr/RequirementsManager/PqAsyncTasks.h>
 #include <fr/RequirementsManager/PqDatabase.h>
+#include <fr/RequirementsManager/PqNodeFactory.h>
 #include <fr/RequirementsManager/RemoveNodesNode.h>
 #include <fr/RequirementsManager/ThreadPool.h>
 #include <gtest/gtest.h>
@@ -127,3 +130,225 @@ TEST(DatabaseTests, SpecificNodeTests) {
   ASSERT_TRUE(saver->treeSaveComplete());
   remover->run();
 }
+
+/**
+ * Save a graph in bulk, change a node and save it again. The
+ * second save has to update the rows the first one inserted.
+ */
+
+TEST(DatabaseTests, BulkSaveUpdates) {
+  auto remover = std::make_shared<RemoveNodesNode<WorkerThread>>();
+  auto project = std::make_shared<Project>();
+  remover->addDown(project);
+  project->setName("Bulk Wombat");
+  project->setDescription("Saved in one transaction");
+  auto product = std::make_shared<Product>();
+  product->setTitle("Bulk wombat product");
+  product->setDescription("First description");
+  connectNodes(project, product);
+
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(project);
+  ASSERT_EQ(saver->getSaveMode(), SaveMode::Bulk);
+  std::vector<std::string> saved;
+  saver->complete.connect([&saved](const std::string &id, Node::PtrType) {
+    saved.push_back(id);
+  });
+  saver->run();
+  ASSERT_TRUE(saver->treeSaveComplete());
+  ASSERT_EQ(saved.size(), 2);
+  ASSERT_FALSE(project->changed);
+  ASSERT_FALSE(product->changed);
+
+  product->setDescription("Second description");
+  product->changed = true;
+  auto updater = std::make_shared<SaveNodesNode<WorkerThread>>(project);
+  updater->run();
+  ASSERT_TRUE(updater->treeSaveComplete());
+
+  NodeAllocator allocator;
+  auto restored = allocator.get("Product", product->idString());
+  PqNodeLoader<WorkerThread> loader(restored);
+  loader.run();
+  ASSERT_TRUE(loader.found());
+  ASSERT_EQ(std::dynamic_pointer_cast<Product>(restored)->getDescription(),
+            "Second description");
+  remover->run();
+}
+
+/**
+ * Saving a node that's already in the database goes through the
+ * same upsert as the first save did.
+ */
+
+TEST(DatabaseTests, UpsertExistingNode) {
+  auto remover = std::make_shared<RemoveNodesNode<WorkerThread>>();
+  auto requirement = std::make_shared<Requirement>();
+  remover->addDown(requirement);
+  requirement->setTitle("Upserted requirement");
+  requirement->setText("Before");
+
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(requirement, true);
+  saver->run();
+  ASSERT_TRUE(saver->saveComplete());
+
+  requirement->setText("After");
+  requirement->changed = true;
+  auto resaver = std::make_shared<SaveNodesNode<WorkerThread>>(requirement, true);
+  resaver->run();
+  ASSERT_TRUE(resaver->saveComplete());
+
+  NodeAllocator allocator;
+  auto restored = allocator.get("Requirement", requirement->idString());
+  PqNodeLoader<WorkerThread> loader(restored);
+  loader.run();
+  ASSERT_TRUE(loader.found());
+  ASSERT_EQ(std::dynamic_pointer_cast<Requirement>(restored)->getText(), "After");
+  remover->run();
+}
+
+/**
+ * Once a node has been saved, saving it again only writes the
+ * fields that were set since.
+ */
+
+TEST(DatabaseTests, IncrementalSave) {
+  auto text = static_cast<uint64_t>(1) << static_cast<unsigned>(Requirement::Field::Text);
+  ASSERT_EQ(database::Statements<Requirement>::update(text), "requirement_update_2");
+  ASSERT_EQ(database::Statements<Requirement>::updateSql(text),
+            "UPDATE requirement SET text = $2 WHERE id = $1");
+
+  auto remover = std::make_shared<RemoveNodesNode<WorkerThread>>();
+  auto product = std::make_shared<Product>();
+  remover->addDown(product);
+  product->setTitle("Incremental product");
+  auto requirement = std::make_shared<Requirement>();
+  requirement->setTitle("Incremental requirement");
+  requirement->setText("Before");
+  connectNodes(product, requirement);
+
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(product);
+  saver->run();
+  ASSERT_TRUE(saver->treeSaveComplete());
+  ASSERT_TRUE(requirement->persisted);
+  ASSERT_EQ(requirement->dirtyFields, 0);
+
+  requirement->setText("After");
+  ASSERT_EQ(requirement->dirtyFields, text);
+  auto updater = std::make_shared<SaveNodesNode<WorkerThread>>(product);
+  updater->run();
+  ASSERT_TRUE(updater->treeSaveComplete());
+  ASSERT_FALSE(requirement->changed);
+
+  NodeAllocator allocator;
+  auto restored = allocator.get("Requirement", requirement->idString());
+  PqNodeLoader<WorkerThread> loader(restored);
+  loader.run();
+  ASSERT_TRUE(loader.found());
+  ASSERT_FALSE(restored->changed);
+  ASSERT_EQ(std::dynamic_pointer_cast<Requirement>(restored)->getTitle(), "Incremental requirement");
+  ASSERT_EQ(std::dynamic_pointer_cast<Requirement>(restored)->getText(), "After");
+  remover->run();
+}
+
+/**
+ * The coroutine savers and loaders write and read the same rows as
+ * the blocking ones, with a couple of workers handling the whole
+ * graph at once.
+ */
+
+TEST(DatabaseTests, AsyncSaveAndLoad) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(2);
+  auto remover = std::make_shared<RemoveNodesNode<WorkerThread>>();
+  auto product = std::make_shared<Product>();
+  remover->addDown(product);
+  product->setTitle("Async product");
+  std::vector<std::shared_ptr<Requirement>> requirements;
+  for (int i = 0; i < 20; ++i) {
+    auto requirement = std::make_shared<Requirement>();
+    requirement->setTitle(std::format("Async requirement {}", i));
+    requirement->setFunctional(i % 2 == 0);
+    connectNodes(product, requirement);
+    requirements.push_back(requirement);
+  }
+  auto saver = std::make_shared<PqAsyncSaveNodesNode<WorkerThread>>(product);
+  pool->enqueue(saver).wait();
+  ASSERT_EQ(saver->saved(), 21);
+  ASSERT_TRUE(requirements.back()->persisted);
+
+  std::vector<TaskHandle> handles;
+  std::vector<std::shared_ptr<PqAsyncNodeLoader<WorkerThread>>> loaders;
+  NodeAllocator allocator;
+  for (auto& requirement : requirements) {
+    auto loader = std::make_shared<PqAsyncNodeLoader<WorkerThread>>(allocator.get("Requirement", requirement->idString()));
+    handles.push_back(pool->enqueue(loader));
+    loaders.push_back(loader);
+  }
+  TaskHandle::whenAll(handles).wait();
+  for (size_t i = 0; i < loaders.size(); ++i) {
+    ASSERT_TRUE(loaders[i]->found());
+    auto restored = std::dynamic_pointer_cast<Requirement>(loaders[i]->getNode());
+    ASSERT_EQ(restored->getTitle(), requirements[i]->getTitle());
+    ASSERT_EQ(restored->isFunctional(), requirements[i]->isFunctional());
+  }
+  pool->shutdown();
+  pool->join();
+  remover->run();
+}
+
+/**
+ * Removing by root only needs the root's id. Everything connected
+ * to it goes in one transaction.
+ */
+
+TEST(DatabaseTests, RemoveByRoot) {
+  auto project = std::make_shared<Project>();
+  project->setName("Doomed project");
+  auto product = std::make_shared<Product>();
+  product->setTitle("Doomed product");
+  connectNodes(project, product);
+  auto requirement = std::make_shared<Requirement>();
+  requirement->setTitle("Doomed requirement");
+  connectNodes(product, requirement);
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(project);
+  saver->run();
+  ASSERT_TRUE(saver->treeSaveComplete());
+
+  // Root it at the requirement, so the up edges have to be followed
+  RemoveNodesNode<WorkerThread> remover;
+  ASSERT_EQ(remover.getRemoveMode(), RemoveMode::ByRoot);
+  remover.addRoot(requirement->idString());
+  remover.run();
+  ASSERT_EQ(remover.removed(), 3);
+
+  NodeAllocator allocator;
+  auto restored = allocator.get("Project", project->idString());
+  PqNodeLoader<WorkerThread> loader(restored);
+  loader.run();
+  ASSERT_FALSE(loader.found());
+}
+
+/**
+ * Every node type gets its statements in the registry, and a
+ * connection borrowed through the registry has them all prepared.
+ */
+
+TEST(DatabaseTests, PreparedStatements) {
+  auto &statements = database::PqStatements::all();
+  // Node-level statements plus upsert (once per edge storage mode),
+  // load, load_batch, remove and remove_batch for each of the node types
+  ASSERT_EQ(statements.size(), database::Statements<Node>::all().size() + 24 * 6);
+  ASSERT_EQ(database::Statements<Requirement>::upsert(), "requirement_upsert");
+  ASSERT_EQ(database::Statements<Todo>::loadBatch(), "todo_load_batch");
+
+  auto pool = std::make_shared<database::PqConnectionPool>(1);
+  {
+    auto connection = database::PqStatements::acquire(pool);
+    for (auto &[name, sql] : statements) {
+      ASSERT_TRUE(connection.isPrepared(name));
+    }
+  }
+  // Same connection comes back out of the pool already prepared
+  auto connection = pool->acquire();
+  ASSERT_TRUE(connection.isPrepared(database::Statements<Node>::skeleton()));
+}
@@ -0,0 +1,213 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cereal/archives/portable_binary.hpp>
+#include <fr/RequirementsManager/GraphSnapshot.h>
+#include <fr/RequirementsManager/UtilityNodes.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using fr::RequirementsManager::EdgeFilter;
+using fr::RequirementsManager::GraphSnapshot;
+using fr::RequirementsManager::Node;
+using fr::RequirementsManager::Text;
+using fr::RequirementsManager::TraverseAction;
+using fr::RequirementsManager::TraverseOptions;
+using fr::RequirementsManager::TraverseOrder;
+
+namespace {
+
+  // root -> a, b. a -> c. b -> c. c -> d (a Text)
+  struct Diamond {
+    Node::PtrType root = std::make_shared<Node>();
+    Node::PtrType a = std::make_shared<Node>();
+    Node::PtrType b = std::make_shared<Node>();
+    Node::PtrType c = std::make_shared<Node>();
+    std::shared_ptr<Text> d = std::make_shared<Text>();
+
+    Diamond() {
+      for (auto node : {root, a, b, c, Node::PtrType(d)}) {
+        node->init();
+      }
+      link(root, a);
+      link(root, b);
+      link(a, c);
+      link(b, c);
+      link(c, d);
+    }
+
+    static void link(Node::PtrType parent, Node::PtrType child) {
+      parent->addDown(child);
+      child->addUp(parent);
+    }
+
+    // Undo the parent/child cycles so everything gets freed
+    ~Diamond() {
+      for (auto node : {root, a, b, c, Node::PtrType(d)}) {
+        node->up.clear();
+        node->down.clear();
+      }
+    }
+  };
+
+}
+
+// Numbering, lookups, types and links
+TEST(GraphSnapshotTests, Freeze) {
+  Diamond graph;
+  auto snapshot = GraphSnapshot::freeze(graph.root);
+  ASSERT_EQ(snapshot.size(), 5);
+  ASSERT_EQ(snapshot.find(graph.root->id), 0);
+  ASSERT_EQ(snapshot.idString(0), graph.root->idString());
+  ASSERT_EQ(snapshot.find(graph.d->idString()), snapshot.find(graph.d->id));
+  ASSERT_EQ(snapshot.find("not a uuid"), GraphSnapshot::npos);
+  auto stranger = std::make_shared<Node>();
+  stranger->init();
+  ASSERT_EQ(snapshot.find(stranger->id), GraphSnapshot::npos);
+
+  auto d = snapshot.find(graph.d->id);
+  ASSERT_EQ(snapshot.nodeType(d), "Text");
+  ASSERT_EQ(snapshot.nodeType(0), "Node");
+  ASSERT_EQ(snapshot.typeNames().size(), 2);
+  ASSERT_EQ(snapshot.typeTag(d), snapshot.tagFor("Text"));
+  ASSERT_EQ(snapshot.tagFor("Requirement"), GraphSnapshot::noType);
+
+  auto c = snapshot.find(graph.c->id);
+  ASSERT_EQ(snapshot.down(0).size(), 2);
+  ASSERT_EQ(snapshot.down(0)[0], snapshot.find(graph.a->id));
+  ASSERT_EQ(snapshot.down(0)[1], snapshot.find(graph.b->id));
+  ASSERT_EQ(snapshot.up(c).size(), 2);
+  ASSERT_EQ(snapshot.down(c).size(), 1);
+  ASSERT_EQ(snapshot.down(c)[0], d);
+  ASSERT_TRUE(snapshot.up(0).empty());
+  ASSERT_EQ(snapshot.upEdgeCount(), 5);
+  ASSERT_EQ(snapshot.downEdgeCount(), 5);
+  ASSERT_THROW(snapshot.down(5), std::out_of_range);
+
+  // Starting in the middle still gets everything through up links
+  ASSERT_EQ(GraphSnapshot::freeze(graph.c).size(), 5);
+}
+
+// Walks visit nodes in the same order Node::walk does
+TEST(GraphSnapshotTests, Walk) {
+  Diamond graph;
+  auto snapshot = GraphSnapshot::freeze(graph.root);
+  for (auto order : {TraverseOrder::DepthFirst, TraverseOrder::BreadthFirst}) {
+    TraverseOptions options{order, EdgeFilter::UpDown};
+    std::vector<std::string> expected;
+    graph.root->walk(options, [&expected](const Node::PtrType& node) {
+      expected.push_back(node->idString());
+    });
+    std::vector<std::string> visited;
+    snapshot.walk(0, options, [&](GraphSnapshot::Index node) {
+      visited.push_back(snapshot.idString(node));
+    });
+    ASSERT_EQ(visited, expected);
+  }
+
+  std::vector<size_t> depths(snapshot.size());
+  snapshot.walk(0, TraverseOptions{TraverseOrder::BreadthFirst, EdgeFilter::Down},
+                [&depths](GraphSnapshot::Index node, size_t depth) {
+                  depths[node] = depth;
+                });
+  ASSERT_EQ(depths[snapshot.find(graph.d->id)], 3);
+
+  // Pruning at c keeps us from getting to d
+  auto c = snapshot.find(graph.c->id);
+  auto count = snapshot.walk(0, [c](GraphSnapshot::Index node) {
+    return node == c ? TraverseAction::Prune : TraverseAction::Continue;
+  });
+  ASSERT_EQ(count, 4);
+}
+
+TEST(GraphSnapshotTests, Reachability) {
+  Diamond graph;
+  auto snapshot = GraphSnapshot::freeze(graph.root);
+  auto a = snapshot.find(graph.a->id);
+  auto b = snapshot.find(graph.b->id);
+  auto d = snapshot.find(graph.d->id);
+  ASSERT_TRUE(snapshot.reachable(0, d));
+  ASSERT_TRUE(snapshot.reachable(a, d));
+  ASSERT_FALSE(snapshot.reachable(a, b));
+  ASSERT_FALSE(snapshot.reachable(d, 0));
+  ASSERT_TRUE(snapshot.reachable(d, 0, EdgeFilter::Up));
+  ASSERT_TRUE(snapshot.reachable(a, b, EdgeFilter::UpDown));
+  ASSERT_TRUE(snapshot.reachable(b, b));
+
+  auto below = snapshot.reachableFrom(a);
+  ASSERT_EQ(below.size(), 3);
+  ASSERT_EQ(below.front(), a);
+  ASSERT_EQ(below.back(), d);
+}
+
+// A deep graph snapshots without recursing
+TEST(GraphSnapshotTests, LongChain) {
+  std::vector<Node::PtrType> chain;
+  for (int i = 0; i < 100000; ++i) {
+    auto node = std::make_shared<Node>();
+    node->init();
+    if (!chain.empty()) {
+      chain.back()->addDown(node);
+    }
+    chain.push_back(node);
+  }
+  auto snapshot = GraphSnapshot::freeze(chain.front());
+  ASSERT_EQ(snapshot.size(), chain.size());
+  ASSERT_TRUE(snapshot.reachable(0, snapshot.find(chain.back()->id)));
+  for (auto& node : chain) {
+    node->down.clear();
+  }
+}
+
+TEST(GraphSnapshotTests, Serialization) {
+  Diamond graph;
+  auto snapshot = GraphSnapshot::freeze(graph.root);
+  auto copy = GraphSnapshot::from_json(snapshot.to_json());
+  ASSERT_EQ(copy.size(), snapshot.size());
+  for (GraphSnapshot::Index i = 0; i < snapshot.size(); ++i) {
+    ASSERT_EQ(copy.id(i), snapshot.id(i));
+    ASSERT_EQ(copy.find(snapshot.id(i)), i);
+    ASSERT_EQ(copy.nodeType(i), snapshot.nodeType(i));
+    ASSERT_TRUE(std::ranges::equal(copy.up(i), snapshot.up(i)));
+    ASSERT_TRUE(std::ranges::equal(copy.down(i), snapshot.down(i)));
+  }
+}
+
+// Binary archives carry the ids as raw bytes, so they come out
+// smaller than the text ids alone would be
+TEST(GraphSnapshotTests, BinarySerialization) {
+  Diamond graph;
+  auto snapshot = GraphSnapshot::freeze(graph.root);
+  std::stringstream stream;
+  {
+    cereal::PortableBinaryOutputArchive archive(stream);
+    archive(snapshot);
+  }
+  ASSERT_LT(stream.str().size(), snapshot.size() * 36);
+  GraphSnapshot copy;
+  {
+    cereal::PortableBinaryInputArchive archive(stream);
+    archive(copy);
+  }
+  ASSERT_EQ(copy.size(), snapshot.size());
+  for (GraphSnapshot::Index i = 0; i < snapshot.size(); ++i) {
+    ASSERT_EQ(copy.id(i), snapshot.id(i));
+    ASSERT_EQ(copy.find(snapshot.id(i)), i);
+    ASSERT_TRUE(std::ranges::equal(copy.down(i), snapshot.down(i)));
+  }
+}
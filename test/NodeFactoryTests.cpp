@@ -151,3 +151,131 @@ TEST(NodeFactoryTest, LoadAGraph) {
   }
   remover.run();
 }
+
+TEST(NodeFactoryTest, LoadMissingGraph) {
+  // Nothing in the database has this ID, but the factory should
+  // still tell us it's done rather than leaving us waiting.
+  auto threadpool = std::make_shared<ThreadPool<WorkerThread>>();
+  threadpool->startThreads(2);
+  for (auto mode : {LoadMode::Skeleton, LoadMode::Recursive}) {
+    auto factory = std::make_shared<PqNodeFactory<WorkerThread>>(
+        "00000000-0000-7000-8000-000000000000",
+        database::PqConnectionPool::getDefault(), mode);
+    std::mutex waitMutex;
+    std::condition_variable waitCv;
+    bool finished = false;
+    factory->done.connect([&](const std::string &) {
+      std::lock_guard<std::mutex> lock(waitMutex);
+      finished = true;
+      waitCv.notify_one();
+    });
+    threadpool->enqueue(factory);
+    std::unique_lock lock(waitMutex);
+    ASSERT_TRUE(waitCv.wait_for(lock, std::chrono::seconds(10),
+                                [&finished]() { return finished; }));
+    ASSERT_FALSE(factory->getNode());
+  }
+  threadpool->shutdown();
+  threadpool->join();
+}
+
+TEST(NodeFactoryTest, BatchLoader) {
+  // Save a couple of requirements, then load them both back
+  // with one batch loader.
+  auto product = std::make_shared<Product>();
+  product->setTitle("Batch loaded product");
+  auto first = std::make_shared<Requirement>();
+  first->setTitle("First batched requirement");
+  connectNodes(product, first);
+  auto second = std::make_shared<Requirement>();
+  second->setTitle("Second batched requirement");
+  connectNodes(product, second);
+
+  auto threadpool = std::make_shared<ThreadPool<WorkerThread>>();
+  threadpool->startThreads(4);
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(product);
+  RemoveNodesNode<WorkerThread> remover;
+  remover.addDown(product);
+  std::mutex waitMutex;
+  std::condition_variable waitCv;
+  saver->complete.connect(
+      [&waitCv](const std::string &, Node::PtrType) { waitCv.notify_one(); });
+  threadpool->enqueue(saver);
+  {
+    std::unique_lock lock(waitMutex);
+    waitCv.wait(lock, [&saver]() { return saver->treeSaveComplete(); });
+  }
+  threadpool->shutdown();
+  threadpool->join();
+
+  NodeAllocator allocator;
+  std::vector<Node::PtrType> toLoad{
+      allocator.get("Requirement", first->idString()),
+      allocator.get("Requirement", second->idString())};
+  std::vector<std::string> loadedIds;
+  PqBatchNodeLoader<WorkerThread> loader("Requirement", toLoad);
+  loader.loaded.connect([&loadedIds](const std::string &id, Node::PtrType) {
+    loadedIds.push_back(id);
+  });
+  loader.run();
+
+  ASSERT_TRUE(loader.complete());
+  ASSERT_EQ(loader.found(), 2);
+  ASSERT_EQ(loadedIds.size(), 2);
+  ASSERT_EQ(std::dynamic_pointer_cast<Requirement>(toLoad[0])->getTitle(),
+            "First batched requirement");
+  ASSERT_EQ(std::dynamic_pointer_cast<Requirement>(toLoad[1])->getTitle(),
+            "Second batched requirement");
+  remover.run();
+}
+
+TEST(NodeFactoryTest, NormalizedEdges) {
+  // Same graph shape loads the same way when each edge is only
+  // stored once.
+  database::setEdgeStorage(database::EdgeStorage::Normalized);
+  auto product = std::make_shared<Product>();
+  product->setTitle("Normalized product");
+  auto first = std::make_shared<Requirement>();
+  first->setTitle("First normalized requirement");
+  connectNodes(product, first);
+  auto second = std::make_shared<Requirement>();
+  second->setTitle("Second normalized requirement");
+  connectNodes(product, second);
+  RemoveNodesNode<WorkerThread> remover;
+  remover.addDown(product);
+
+  auto saver = std::make_shared<SaveNodesNode<WorkerThread>>(product);
+  saver->run();
+  ASSERT_TRUE(saver->treeSaveComplete());
+
+  auto threadpool = std::make_shared<ThreadPool<WorkerThread>>();
+  threadpool->startThreads(4);
+  for (auto mode : {LoadMode::Skeleton, LoadMode::Recursive}) {
+    // Load from one of the children so the up edge has to be found
+    auto factory = std::make_shared<PqNodeFactory<WorkerThread>>(
+        first->idString(), database::PqConnectionPool::getDefault(), mode);
+    std::mutex waitMutex;
+    std::condition_variable waitCv;
+    bool finished = false;
+    factory->done.connect([&](const std::string &) {
+      std::lock_guard<std::mutex> lock(waitMutex);
+      finished = true;
+      waitCv.notify_one();
+    });
+    threadpool->enqueue(factory);
+    std::unique_lock lock(waitMutex);
+    ASSERT_TRUE(waitCv.wait_for(lock, std::chrono::seconds(10),
+                                [&finished]() { return finished; }));
+    auto restored = factory->getNode();
+    ASSERT_TRUE(restored);
+    ASSERT_EQ(restored->up.size(), 1);
+    ASSERT_TRUE(restored->down.empty());
+    auto restoredProduct = restored->up.front();
+    ASSERT_EQ(restoredProduct->idString(), product->idString());
+    ASSERT_EQ(restoredProduct->down.size(), 2);
+  }
+  threadpool->shutdown();
+  threadpool->join();
+  remover.run();
+  database::setEdgeStorage(database::EdgeStorage::Mirrored);
+}
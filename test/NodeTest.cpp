@@ -14,11 +14,15 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <fr/RequirementsManager/Node.h>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 // Verify InitNode sets the ID.
 TEST(NodeTests, InitNode) {
@@ -104,3 +108,392 @@ TEST(NodeTests, Serialization) {
     cChild++;
   }
 }
+
+// JSON from before nodes carried their dirty tracking still loads,
+// and the node comes in as needing a full save
+TEST(NodeTests, LoadUntrackedJson) {
+  const std::string json = R"({
+    "node": {
+        "id": "019a8466-2528-7000-8025-ca48cf0c16c9",
+        "upList": [],
+        "downList": [],
+        "initted": true
+    }
+})";
+  fr::RequirementsManager::Node node;
+  node.persisted = true;
+  node.dirtyFields = 1;
+  {
+    std::stringstream stream(json);
+    cereal::JSONInputArchive archive(stream);
+    archive(cereal::make_nvp("node", node));
+  }
+  ASSERT_EQ(node.idString(), "019a8466-2528-7000-8025-ca48cf0c16c9");
+  ASSERT_TRUE(node.initted);
+  ASSERT_FALSE(node.persisted);
+  ASSERT_EQ(node.dirtyFields, 0);
+  ASSERT_TRUE(node.edgeChanges.empty());
+
+  // And the current format keeps it
+  fr::RequirementsManager::Node saved;
+  saved.init();
+  saved.clearDirty();
+  saved.dirtyFields = 2;
+  std::stringstream stream;
+  {
+    cereal::JSONOutputArchive archive(stream);
+    archive(cereal::make_nvp("node", saved));
+  }
+  fr::RequirementsManager::Node loaded;
+  {
+    cereal::JSONInputArchive archive(stream);
+    archive(cereal::make_nvp("node", loaded));
+  }
+  ASSERT_EQ(loaded.id, saved.id);
+  ASSERT_TRUE(loaded.persisted);
+  ASSERT_EQ(loaded.dirtyFields, 2);
+}
+
+// addUp/addDown/removeUp/removeDown remember which edges changed
+TEST(NodeTests, EdgeChanges) {
+  auto n = std::make_shared<fr::RequirementsManager::Node>();
+  n->init();
+  auto child = std::make_shared<fr::RequirementsManager::Node>();
+  child->init();
+  auto parent = std::make_shared<fr::RequirementsManager::Node>();
+  parent->init();
+  n->clearDirty();
+  ASSERT_FALSE(n->changed);
+  ASSERT_TRUE(n->persisted);
+
+  n->addDown(child);
+  n->addUp(parent);
+  ASSERT_TRUE(n->changed);
+  ASSERT_EQ(n->edgeChanges.size(), 2);
+  ASSERT_TRUE(n->edgeChanges[0].down);
+  ASSERT_TRUE(n->edgeChanges[0].added);
+  ASSERT_FALSE(n->edgeChanges[1].down);
+  // Adding an edge that's already there doesn't record anything
+  n->addDown(child);
+  ASSERT_EQ(n->edgeChanges.size(), 2);
+  // Removing an edge added since the last save cancels it out
+  n->removeDown(child);
+  ASSERT_EQ(n->edgeChanges.size(), 1);
+  ASSERT_EQ(n->edgeChanges[0].id, parent->idString());
+
+  n->clearDirty();
+  n->removeUp(parent);
+  ASSERT_EQ(n->edgeChanges.size(), 1);
+  ASSERT_FALSE(n->edgeChanges[0].added);
+}
+
+// UuidSet handles lots of UUIDs, erasing from the middle of a probe
+// run and the nil UUID
+TEST(NodeTests, UuidSet) {
+  fr::RequirementsManager::UuidSet set;
+  std::vector<std::shared_ptr<fr::RequirementsManager::Node>> nodes;
+  for (int i = 0; i < 1000; ++i) {
+    auto node = std::make_shared<fr::RequirementsManager::Node>();
+    node->init();
+    nodes.push_back(node);
+    ASSERT_TRUE(set.insert(node->id));
+  }
+  ASSERT_FALSE(set.insert(nodes[10]->id));
+  ASSERT_EQ(set.size(), 1000);
+  for (int i = 0; i < 1000; i += 2) {
+    ASSERT_TRUE(set.erase(nodes[i]->id));
+  }
+  ASSERT_FALSE(set.erase(nodes[0]->id));
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(set.contains(nodes[i]->id), i % 2 == 1);
+  }
+  ASSERT_FALSE(set.contains(boost::uuids::nil_uuid()));
+  ASSERT_TRUE(set.insert(boost::uuids::nil_uuid()));
+  ASSERT_EQ(set.size(), 501);
+}
+
+// A chain deep enough to blow the stack if traversal recursed, plus
+// depth limits, edge filters, breadth first order and stopping early
+TEST(NodeTests, IterativeTraversal) {
+  using fr::RequirementsManager::Node;
+  using namespace fr::RequirementsManager;
+  auto root = std::make_shared<Node>();
+  auto last = root;
+  for (int i = 0; i < 200000; ++i) {
+    auto next = std::make_shared<Node>();
+    last->down.push_back(next);
+    next->up.push_back(last);
+    last = next;
+  }
+  size_t count = 0;
+  root->traverse([&count](Node::PtrType) { ++count; });
+  ASSERT_EQ(count, 200001);
+  // Traversal initted them all
+  ASSERT_TRUE(last->initted);
+
+  TraverseOptions options;
+  options.maxDepth = 10;
+  ASSERT_EQ(root->walk(options, [](const Node::PtrType&) {}), 11);
+  options.maxDepth = std::numeric_limits<size_t>::max();
+  options.edges = EdgeFilter::Up;
+  ASSERT_EQ(last->walk(options, [](const Node::PtrType&) {}), 200001);
+  ASSERT_EQ(root->walk(options, [](const Node::PtrType&) {}), 1);
+
+  // A diamond: root -> a, b -> leaf
+  std::vector<Node::PtrType> diamond;
+  for (int i = 0; i < 4; ++i) {
+    diamond.push_back(std::make_shared<Node>());
+    diamond.back()->init();
+  }
+  auto top = diamond[0];
+  auto a = top->addDown(diamond[1]);
+  auto b = top->addDown(diamond[2]);
+  auto leaf = diamond[3];
+  a->addDown(leaf);
+  b->addDown(leaf);
+  TraverseOptions breadth;
+  breadth.order = TraverseOrder::BreadthFirst;
+  breadth.edges = EdgeFilter::Down;
+  std::vector<std::pair<Node::PtrType, size_t>> seen;
+  top->walk(breadth, [&seen](const Node::PtrType& node, size_t depth) {
+    seen.emplace_back(node, depth);
+  });
+  ASSERT_EQ(seen.size(), 4);
+  ASSERT_EQ(seen[0].first, top);
+  ASSERT_EQ(seen[1].first, a);
+  ASSERT_EQ(seen[2].first, b);
+  ASSERT_EQ(seen[3].first, leaf);
+  ASSERT_EQ(seen[3].second, 2);
+
+  // Depth first goes through a to the leaf before it gets to b
+  seen.clear();
+  breadth.order = TraverseOrder::DepthFirst;
+  top->walk(breadth, [&seen](const Node::PtrType& node, size_t depth) {
+    seen.emplace_back(node, depth);
+  });
+  ASSERT_EQ(seen[2].first, leaf);
+  ASSERT_EQ(seen[3].first, b);
+
+  size_t visited = top->walk(TraverseOptions(), [&a](const Node::PtrType& node) {
+    return node == a ? TraverseAction::Stop : TraverseAction::Continue;
+  });
+  ASSERT_EQ(visited, 2);
+
+  // Pruning a and b keeps the traversal away from leaf
+  Traversal<Node> pruned(breadth);
+  pruned.run(top, [&top](const Node::PtrType& node) {
+    return node == top ? TraverseAction::Continue : TraverseAction::Prune;
+  });
+  ASSERT_FALSE(pruned.visited(*leaf));
+  // A second run picks up where the first left off
+  ASSERT_EQ(pruned.run(leaf, [](const Node::PtrType&) {}), 1);
+  ASSERT_EQ(pruned.run(a, [](const Node::PtrType&) {}), 0);
+
+  // Unlink the chain without recursing through 200000 destructors
+  std::vector<Node::PtrType> chain;
+  root->traverse([&chain](Node::PtrType node) { chain.push_back(node); });
+  for (auto& node : chain) {
+    node->up.clear();
+    node->down.clear();
+  }
+}
+
+// A hub with lots of children still catches duplicates and finds,
+// removes and re-adds children, including ones pushed on directly
+TEST(NodeTests, IndexedEdges) {
+  using fr::RequirementsManager::Node;
+  auto hub = std::make_shared<Node>();
+  hub->init();
+  std::vector<Node::PtrType> children;
+  for (int i = 0; i < 5000; ++i) {
+    auto child = std::make_shared<Node>();
+    child->init();
+    children.push_back(child);
+    hub->addDown(child);
+  }
+  ASSERT_EQ(hub->down.size(), 5000);
+  ASSERT_EQ(hub->edgeChanges.size(), 5000);
+  hub->addDown(children[1234]);
+  ASSERT_EQ(hub->down.size(), 5000);
+  ASSERT_EQ(hub->findDown(children[4321]->id), children[4321]);
+  ASSERT_EQ(hub->findDown(children[4321]->idString()), children[4321]);
+  ASSERT_FALSE(hub->findUp(children[4321]->id));
+  ASSERT_FALSE(hub->findDown("not a uuid"));
+
+  hub->clearDirty();
+  // Remove every other one from the front half, which shifts
+  // everything after them
+  for (int i = 0; i < 2500; i += 2) {
+    hub->removeDown(children[i]);
+  }
+  ASSERT_EQ(hub->down.size(), 3750);
+  ASSERT_EQ(hub->edgeChanges.size(), 1250);
+  for (int i = 0; i < 5000; ++i) {
+    bool expected = i >= 2500 || i % 2 == 1;
+    ASSERT_EQ(static_cast<bool>(hub->findDown(children[i]->id)), expected);
+  }
+  // Adding one back cancels out its removal
+  hub->addDown(children[0]);
+  ASSERT_EQ(hub->edgeChanges.size(), 1249);
+  ASSERT_EQ(hub->down.back(), children[0]);
+
+  // Pushed on without addDown, but addDown still sees it
+  auto extra = std::make_shared<Node>();
+  extra->init();
+  hub->down.push_back(extra);
+  hub->addDown(extra);
+  ASSERT_EQ(hub->down.size(), 3752);
+  ASSERT_EQ(hub->findDown(extra->id), extra);
+}
+
+// Nodes made in an arena keep it around until the last of them is
+// gone, whether they came from makeNodeIn or from new in a Scope
+TEST(NodeTests, GraphArena) {
+  using fr::RequirementsManager::GraphArena;
+  using fr::RequirementsManager::Node;
+  auto arena = GraphArena::create();
+  std::weak_ptr<GraphArena> weakArena = arena;
+  auto root = fr::RequirementsManager::makeNodeIn<Node>(arena);
+  root->init();
+  for (int i = 0; i < 1000; ++i) {
+    auto child = fr::RequirementsManager::makeNodeIn<Node>(arena);
+    child->init();
+    root->addDown(child);
+  }
+  auto used = arena->allocated();
+  ASSERT_GE(used, 1001 * sizeof(Node));
+
+  {
+    GraphArena::Scope scope(arena);
+    ASSERT_EQ(GraphArena::current(), arena);
+    // This is how cereal allocates nodes it loads
+    Node::PtrType loaded(new Node);
+    loaded->init();
+    root->addUp(loaded);
+    ASSERT_GT(arena->allocated(), used);
+    // Nested scopes put back whatever was there before
+    {
+      GraphArena::Scope heap(nullptr);
+      ASSERT_FALSE(GraphArena::current());
+      used = arena->allocated();
+      Node::PtrType onHeap(new Node);
+      ASSERT_EQ(arena->allocated(), used);
+    }
+    ASSERT_EQ(GraphArena::current(), arena);
+  }
+  ASSERT_FALSE(GraphArena::current());
+  // Heap nodes still work with the same operator delete
+  delete new Node;
+
+  arena.reset();
+  ASSERT_FALSE(weakArena.expired());
+  ASSERT_EQ(root->down.size(), 1000);
+  ASSERT_EQ(root->up.size(), 1);
+  root.reset();
+  ASSERT_TRUE(weakArena.expired());
+}
+
+// Replacing a long list, or giving a node in one a new id, doesn't
+// leave lookups going by the old entries
+TEST(NodeTests, IndexedEdgesStayCurrent) {
+  using fr::RequirementsManager::Node;
+  auto makeChildren = []() {
+    std::vector<Node::PtrType> children;
+    for (int i = 0; i < 40; ++i) {
+      auto child = std::make_shared<Node>();
+      child->init();
+      children.push_back(child);
+    }
+    return children;
+  };
+  auto hub = std::make_shared<Node>();
+  hub->init();
+  auto first = makeChildren();
+  for (auto& child : first) {
+    hub->addDown(child);
+  }
+  ASSERT_EQ(hub->findDown(first[30]->id), first[30]);
+
+  // Same size, so the new list lands in the old storage
+  auto second = makeChildren();
+  auto storage = hub->down.data();
+  hub->setDown(second);
+  ASSERT_EQ(hub->down.data(), storage);
+  ASSERT_FALSE(hub->findDown(first[30]->id));
+  ASSERT_EQ(hub->findDown(second[30]->id), second[30]);
+  ASSERT_FALSE(hub->addDown(second[5]) != second[5]);
+  ASSERT_EQ(hub->down.size(), 40);
+  hub->removeDown(second[20]);
+  ASSERT_FALSE(hub->findDown(second[20]->id));
+  ASSERT_EQ(hub->down.size(), 39);
+
+  // Assigning directly works too, with a reindex
+  hub->down = first;
+  hub->reindex();
+  hub->addDown(first[7]);
+  ASSERT_EQ(hub->down.size(), 40);
+  ASSERT_EQ(hub->findDown(first[7]->id), first[7]);
+
+  // A node that got indexed before it had an id
+  auto late = std::make_shared<Node>();
+  hub->addDown(late);
+  // The next add puts it in the index under the nil id
+  auto after = std::make_shared<Node>();
+  after->init();
+  hub->addDown(after);
+  ASSERT_EQ(hub->findDown(late->id), late);
+  late->init();
+  ASSERT_EQ(hub->findDown(late->id), late);
+  hub->addDown(late);
+  ASSERT_EQ(hub->down.size(), 42);
+  ASSERT_EQ(hub->findDown(first[39]->id), first[39]);
+
+  // Appended behind the index's back, and found without it
+  // catching up first
+  auto pushed = std::make_shared<Node>();
+  pushed->init();
+  hub->down.push_back(pushed);
+  ASSERT_EQ(hub->findDown(pushed->id), pushed);
+}
+
+// A node getting a new id only costs the indexes it's in
+TEST(NodeTests, IdChangeOnlyStalesItsIndexes) {
+  using fr::RequirementsManager::EdgeIndex;
+  using fr::RequirementsManager::Node;
+  auto makeList = []() {
+    std::vector<Node::PtrType> list;
+    for (int i = 0; i < 20; ++i) {
+      auto node = std::make_shared<Node>();
+      node->init();
+      list.push_back(node);
+    }
+    return list;
+  };
+  auto first = makeList();
+  auto second = makeList();
+  EdgeIndex<Node::PtrType> firstIndex;
+  EdgeIndex<Node::PtrType> secondIndex;
+  firstIndex.sync(first);
+  secondIndex.sync(second);
+  ASSERT_TRUE(firstIndex.current(first));
+  ASSERT_TRUE(secondIndex.current(second));
+
+  first[3]->init();
+  ASSERT_FALSE(firstIndex.current(first));
+  ASSERT_TRUE(secondIndex.current(second));
+  ASSERT_EQ(firstIndex.find(first[3]->id, first), 3);
+
+  // Catching up picks the new id up
+  firstIndex.sync(first);
+  ASSERT_TRUE(firstIndex.current(first));
+  ASSERT_EQ(firstIndex.find(first[3]->id, first), 3);
+
+  // In both, so both hear about it
+  secondIndex.reset();
+  second[0] = first[5];
+  secondIndex.sync(second);
+  first[5]->setUuid("019a8466-0000-7000-8000-000000000005");
+  ASSERT_FALSE(firstIndex.current(first));
+  ASSERT_FALSE(secondIndex.current(second));
+  ASSERT_EQ(secondIndex.find(first[5]->id, second), 0);
+}
@@ -40,6 +40,20 @@ TEST(Requirement, SetHappyPaths) {
   ASSERT_FALSE(r->isFunctional());
 }
 
+// Setters flag the fields they change
+TEST(Requirement, DirtyFields) {
+  auto r = std::make_shared<Requirement>();
+  ASSERT_EQ(r->dirtyFields, 0);
+  r->setText("Only the text changed");
+  ASSERT_TRUE(r->changed);
+  ASSERT_TRUE(r->isDirty(Requirement::Field::Text));
+  ASSERT_FALSE(r->isDirty(Requirement::Field::Title));
+  ASSERT_FALSE(r->isDirty(Requirement::Field::Functional));
+  r->clearDirty();
+  ASSERT_EQ(r->dirtyFields, 0);
+  ASSERT_FALSE(r->changed);
+}
+
 // Once we're committed we can no longer set the things
 TEST(Requirement, SetSadPaths) {
   auto r = std::make_shared<Requirement>();
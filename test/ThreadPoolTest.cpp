@@ -0,0 +1,825 @@
+/**
+ * Copyright 2026 Bruce Ide
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fr/RequirementsManager/CoroutineTask.h>
+#include <fr/RequirementsManager/FairQueue.h>
+#include <fr/RequirementsManager/LightTask.h>
+#include <fr/RequirementsManager/ParallelTraversal.h>
+#include <fr/RequirementsManager/PoolMetrics.h>
+#include <fr/RequirementsManager/TaskHandle.h>
+#include <fr/RequirementsManager/TaskNode.h>
+#include <fr/RequirementsManager/ThreadPool.h>
+#include <functional>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace fr::RequirementsManager;
+
+/**
+ * A task that just runs a function. Handy for poking at the
+ * threadpool without a database.
+ */
+
+class FunctionTask : public TaskNode<WorkerThread> {
+  std::function<void(FunctionTask&)> _fn;
+
+public:
+  FunctionTask(std::function<void(FunctionTask&)> fn) : _fn(fn) {}
+
+  void run() override {
+    _fn(*this);
+  }
+};
+
+// Tasks that enqueue more tasks from inside a worker, the way
+// SaveNodesNode and PqNodeFactory do. Everything has to run
+// exactly once before the pool finishes draining.
+TEST(ThreadPoolTest, WorkStealingRunsSpawnedTasks) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>(SchedulerMode::WorkStealing);
+  ASSERT_EQ(pool->getSchedulerMode(), SchedulerMode::WorkStealing);
+  pool->startThreads(4);
+  std::atomic<int> ran = 0;
+  for (int i = 0; i < 10; ++i) {
+    pool->enqueue(std::make_shared<FunctionTask>([&ran](FunctionTask& task) {
+      ++ran;
+      for (int j = 0; j < 10; ++j) {
+        task.getOwner()->enqueue(std::make_shared<FunctionTask>([&ran](FunctionTask&) {
+          ++ran;
+        }));
+      }
+    }));
+  }
+  pool->shutdown();
+  pool->join();
+  ASSERT_EQ(ran, 110);
+  ASSERT_FALSE(pool->hasWork());
+}
+
+// The handle from enqueue covers everything the task enqueues,
+// and everything those enqueue, so it doesn't finish until the
+// last grandchild has run. Exceptions come back out of wait.
+TEST(ThreadPoolTest, HandleWaitsForSubtree) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(4);
+  std::atomic<int> ran = 0;
+  auto handle = pool->enqueue(std::make_shared<FunctionTask>([&ran](FunctionTask& task) {
+    for (int i = 0; i < 5; ++i) {
+      task.getOwner()->enqueue(std::make_shared<FunctionTask>([&ran](FunctionTask& child) {
+        child.getOwner()->enqueue(std::make_shared<FunctionTask>([&ran](FunctionTask&) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+          ++ran;
+        }));
+        ++ran;
+      }));
+    }
+    ++ran;
+  }));
+  handle.wait();
+  ASSERT_TRUE(handle.done());
+  ASSERT_EQ(ran, 11);
+
+  auto throws = pool->enqueue(std::make_shared<FunctionTask>([](FunctionTask& task) {
+    task.getOwner()->enqueue(std::make_shared<FunctionTask>([](FunctionTask&) {
+      throw std::runtime_error("child failed");
+    }));
+  }));
+  ASSERT_THROW(throws.wait(), std::runtime_error);
+  pool->shutdown();
+  pool->join();
+}
+
+TEST(ThreadPoolTest, HandleTimeoutThenAndWhenAll) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(2);
+  std::atomic<bool> release = false;
+  auto slow = pool->enqueue(std::make_shared<FunctionTask>([&release](FunctionTask&) {
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }));
+  ASSERT_FALSE(slow.waitFor(std::chrono::milliseconds(20)));
+  ASSERT_FALSE(slow.done());
+
+  std::atomic<int> continued = 0;
+  auto after = slow.then([&continued](const TaskHandle& handle) {
+    if (handle.done() && !handle.error()) {
+      ++continued;
+    }
+  });
+  auto quick = pool->enqueue(std::make_shared<FunctionTask>([](FunctionTask&) {}));
+  auto all = TaskHandle::whenAll({slow, quick, after});
+  ASSERT_FALSE(all.done());
+  release = true;
+  ASSERT_TRUE(all.waitFor(std::chrono::seconds(5)));
+  ASSERT_EQ(continued, 1);
+  // Already done, so this one runs right away
+  slow.then([&continued](const TaskHandle&) { ++continued; });
+  ASSERT_EQ(continued, 2);
+  ASSERT_TRUE(TaskHandle::whenAll({}).done());
+  pool->shutdown();
+  pool->join();
+}
+
+// One worker, held up by a task that won't finish until we say
+// so, while a mix of priorities piles up behind it. Without aging
+// they run strictly in priority order. With aging, a bulk task
+// that's waited long enough gets to go ahead of interactive work.
+TEST(ThreadPoolTest, PriorityAndAging) {
+  for (bool aging : {false, true}) {
+    auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+    pool->setAgingInterval(std::chrono::milliseconds(aging ? 20 : 0));
+    pool->startThreads(1);
+    std::mutex orderMutex;
+    std::vector<std::string> order;
+    auto task = [&](const std::string& name, TaskPriority priority) {
+      auto ret = std::make_shared<FunctionTask>([&orderMutex, &order, name](FunctionTask&) {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        order.push_back(name);
+      });
+      ret->setPriority(priority);
+      return ret;
+    };
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    pool->enqueue(std::make_shared<FunctionTask>([&started, &release](FunctionTask&) {
+      started = true;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }));
+    while (!started) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool->enqueue(task("bulk", TaskPriority::Bulk));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pool->enqueue(task("normal", TaskPriority::Normal));
+    pool->enqueue(task("interactive1", TaskPriority::Interactive));
+    auto last = pool->enqueue(task("interactive2", TaskPriority::Interactive));
+    ASSERT_EQ(pool->depth(TaskPriority::Interactive), 2);
+    ASSERT_EQ(pool->depths(), (std::vector<size_t>{2, 1, 1}));
+    release = true;
+    pool->shutdown();
+    pool->join();
+    ASSERT_EQ(pool->depths(), (std::vector<size_t>{0, 0, 0}));
+    if (aging) {
+      ASSERT_EQ(order, (std::vector<std::string>{"bulk", "interactive1", "interactive2", "normal"}));
+    } else {
+      ASSERT_EQ(order, (std::vector<std::string>{"interactive1", "interactive2", "normal", "bulk"}));
+    }
+  }
+}
+
+// Groups take turns, weights give a group more turns and a group
+// at its limit waits until something of its finishes.
+TEST(ThreadPoolTest, FairQueueGroups) {
+  FairQueue<int> queue;
+  for (int i = 0; i < 4; ++i) {
+    queue.push("big", i);
+  }
+  queue.push("small", 100);
+  queue.push("small", 101);
+  std::vector<int> order;
+  int item;
+  std::string group;
+  while (queue.pop(item, group)) {
+    order.push_back(item);
+  }
+  ASSERT_EQ(order, (std::vector<int>{0, 100, 1, 101, 2, 3}));
+  ASSERT_EQ(queue.groups(), 0);
+
+  queue.setSettings("big", {2, 0});
+  for (int i = 0; i < 4; ++i) {
+    queue.push("big", i);
+    queue.push("small", 100 + i);
+  }
+  order.clear();
+  while (queue.pop(item, group)) {
+    order.push_back(item);
+  }
+  ASSERT_EQ(order, (std::vector<int>{0, 1, 100, 2, 3, 101, 102, 103}));
+
+  queue.setSettings("big", {1, 1});
+  queue.push("big", 1);
+  queue.push("big", 2);
+  ASSERT_TRUE(queue.pop(item, group));
+  ASSERT_EQ(group, "big");
+  ASSERT_EQ(queue.blocked(), 1);
+  ASSERT_FALSE(queue.pop(item, group));
+  ASSERT_TRUE(queue.finished("big"));
+  ASSERT_EQ(queue.blocked(), 0);
+  ASSERT_TRUE(queue.pop(item, group));
+  ASSERT_EQ(item, 2);
+  ASSERT_FALSE(queue.finished("big"));
+  ASSERT_TRUE(queue.empty());
+}
+
+// A big fan-out with a concurrency limit never has more than that
+// many tasks running, and a small request enqueued behind it
+// doesn't have to wait for all of it.
+TEST(ThreadPoolTest, GroupLimitAndFairShare) {
+  for (auto mode : {SchedulerMode::SharedQueue, SchedulerMode::WorkStealing}) {
+    auto pool = std::make_shared<ThreadPool<WorkerThread>>(mode);
+    pool->setGroupLimit("big", 2);
+    ASSERT_EQ(pool->getGroupLimit("big"), 2);
+    pool->startThreads(4);
+    std::atomic<int> running = 0;
+    std::atomic<int> maxRunning = 0;
+    std::atomic<int> bigDone = 0;
+    auto big = std::make_shared<FunctionTask>([&](FunctionTask& task) {
+      for (int i = 0; i < 40; ++i) {
+        // Children join the parent's group
+        task.getOwner()->enqueue(std::make_shared<FunctionTask>([&](FunctionTask& child) {
+          EXPECT_EQ(child.getGroup(), "big");
+          int now = ++running;
+          int seen = maxRunning;
+          while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          --running;
+          ++bigDone;
+        }));
+      }
+    });
+    big->setGroup("big");
+    auto bigHandle = pool->enqueue(big);
+    bigHandle.waitFor(std::chrono::milliseconds(5));
+    auto small = std::make_shared<FunctionTask>([](FunctionTask&) {});
+    pool->enqueue(small).wait();
+    ASSERT_LT(bigDone, 40);
+    ASSERT_NE(small->getGroup(), "big");
+    bigHandle.wait();
+    ASSERT_EQ(bigDone, 40);
+    ASSERT_LE(maxRunning, 2);
+    pool->shutdown();
+    pool->join();
+  }
+}
+
+// Once capacity tasks are waiting, Reject throws, DropLowest throws
+// out the newest less urgent task and Block waits for room.
+TEST(ThreadPoolTest, BoundedQueueOverflow) {
+  FairQueue<int, 2> queue;
+  queue.push("big", 1, 1);
+  queue.push("big", 2, 1);
+  queue.push("small", 3, 1);
+  int item;
+  std::string group;
+  ASSERT_FALSE(queue.dropNewest(item, 0));
+  ASSERT_TRUE(queue.dropNewest(item, 1));
+  ASSERT_EQ(item, 2);
+  ASSERT_EQ(queue.size(), 2);
+
+  for (auto policy : {OverflowPolicy::Reject, OverflowPolicy::DropLowest, OverflowPolicy::Block}) {
+    auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+    pool->setCapacity(2);
+    pool->setOverflowPolicy(policy);
+    ASSERT_EQ(pool->getCapacity(), 2);
+    ASSERT_EQ(pool->getOverflowPolicy(), policy);
+    pool->startThreads(1);
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    auto blocker = pool->enqueue(std::make_shared<FunctionTask>([&](FunctionTask& task) {
+      started = true;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      // Running tasks can always enqueue
+      for (int i = 0; i < 4; ++i) {
+        task.getOwner()->enqueue(std::make_shared<FunctionTask>([](FunctionTask&) {}));
+      }
+    }));
+    while (!started) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto task = [](TaskPriority priority) {
+      auto ret = std::make_shared<FunctionTask>([](FunctionTask&) {});
+      ret->setPriority(priority);
+      return ret;
+    };
+    auto bulk = pool->enqueue(task(TaskPriority::Bulk));
+    auto normal = pool->enqueue(task(TaskPriority::Normal));
+    if (policy == OverflowPolicy::Reject) {
+      ASSERT_THROW(pool->enqueue(task(TaskPriority::Interactive)), QueueFullError);
+    } else if (policy == OverflowPolicy::DropLowest) {
+      auto interactive = pool->enqueue(task(TaskPriority::Interactive));
+      ASSERT_TRUE(bulk.done());
+      ASSERT_THROW(bulk.wait(), QueueFullError);
+      ASSERT_EQ(pool->depths(), (std::vector<size_t>{1, 1, 0}));
+      // Nothing less urgent to drop
+      ASSERT_THROW(pool->enqueue(task(TaskPriority::Bulk)), QueueFullError);
+    } else {
+      std::atomic<bool> enqueued = false;
+      std::thread waiter([&]() {
+        pool->enqueue(task(TaskPriority::Normal));
+        enqueued = true;
+      });
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      ASSERT_FALSE(enqueued);
+      release = true;
+      waiter.join();
+      ASSERT_TRUE(enqueued);
+    }
+    release = true;
+    blocker.wait();
+    normal.wait();
+    pool->shutdown();
+    pool->join();
+    ASSERT_FALSE(pool->hasWork());
+  }
+}
+
+// Fans out into children the way SaveNodesNode does
+class Spawner : public TaskNode<WorkerThread> {
+public:
+  std::atomic<int> ran = 0;
+
+  void run() override {
+    for (int i = 0; i < 10; ++i) {
+      auto child = std::make_shared<FunctionTask>([this](FunctionTask&) { ++ran; });
+      recordChild(child);
+      getOwner()->enqueue(child);
+    }
+  }
+};
+
+// Functions run as LightTasks without being Nodes, small captures
+// stay inline and big ones still work. TaskNodes only keep their
+// children if you ask them to.
+TEST(ThreadPoolTest, LightTasksAndAuditTrail) {
+  SmallFunction<> empty;
+  ASSERT_FALSE(empty);
+  int calls = 0;
+  SmallFunction<> small([&calls]() { ++calls; });
+  std::array<int, 64> big{};
+  big[63] = 5;
+  SmallFunction<> boxed([&calls, big]() { calls += big[63]; });
+  SmallFunction<> moved(std::move(small));
+  ASSERT_FALSE(small);
+  moved();
+  boxed = std::move(moved);
+  boxed();
+  ASSERT_EQ(calls, 2);
+
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>(SchedulerMode::WorkStealing);
+  pool->startThreads(4);
+  std::atomic<int> ran = 0;
+  std::vector<TaskHandle> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(pool->submit([&ran, &pool]() {
+      // Children of a light task join its subtree too
+      pool->submit([&ran]() { ++ran; });
+      ++ran;
+    }, TaskPriority::Bulk));
+  }
+  TaskHandle::whenAll(handles).wait();
+  ASSERT_EQ(ran, 200);
+
+  auto quiet = std::make_shared<Spawner>();
+  pool->enqueue(quiet).wait();
+  ASSERT_EQ(quiet->ran, 10);
+  ASSERT_TRUE(quiet->down.empty());
+
+  auto audited = std::make_shared<Spawner>();
+  audited->setAuditTrail(true);
+  pool->enqueue(audited).wait();
+  ASSERT_EQ(audited->ran, 10);
+  ASSERT_EQ(audited->down.size(), 10);
+  auto child = std::dynamic_pointer_cast<FunctionTask>(audited->down.front());
+  ASSERT_TRUE(child);
+  ASSERT_TRUE(child->getAuditTrail());
+  ASSERT_EQ(child->getGroup(), audited->getGroup());
+  pool->shutdown();
+  pool->join();
+}
+
+// Histograms bucket by powers of two and the pool files wait and
+// run times under each task's type
+TEST(ThreadPoolTest, Metrics) {
+  using namespace std::chrono_literals;
+  LatencyHistogram histogram;
+  ASSERT_EQ(histogram.percentile(0.5), 0ns);
+  histogram.record(500ns);
+  histogram.record(3us);
+  histogram.record(3us);
+  histogram.record(10ms);
+  ASSERT_EQ(histogram.count(), 4);
+  ASSERT_EQ(histogram.buckets()[0], 1);
+  ASSERT_EQ(histogram.buckets()[2], 2);
+  ASSERT_EQ(histogram.percentile(0.5), 4us);
+  ASSERT_EQ(histogram.percentile(1.0), 10ms);
+  ASSERT_EQ(histogram.max(), 10ms);
+
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(2);
+  std::vector<TaskHandle> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(pool->submit([]() { std::this_thread::sleep_for(2ms); }));
+  }
+  handles.push_back(pool->enqueue(std::make_shared<FunctionTask>([](FunctionTask&) {
+    throw std::runtime_error("nope");
+  })));
+  TaskHandle::whenAll(handles).waitFor(std::chrono::milliseconds(5000));
+  auto metrics = pool->metrics();
+  ASSERT_EQ(metrics.completed, 11);
+  ASSERT_GE(metrics.maxQueued, 1);
+  ASSERT_EQ(metrics.queued, 0);
+  ASSERT_EQ(metrics.workers.size(), 2);
+  auto& light = metrics.types.at("LightTask");
+  ASSERT_EQ(light.run.count(), 10);
+  ASSERT_EQ(light.wait.count(), 10);
+  ASSERT_GE(light.run.mean(), 2ms);
+  // With two workers most of them had to wait for another to finish
+  ASSERT_GE(light.wait.max(), 2ms);
+  ASSERT_EQ(metrics.types.at("TaskNode").errors, 1);
+  double busy = 0.0;
+  for (auto& worker : metrics.workers) {
+    busy += worker.busyRatio();
+    ASSERT_NEAR(worker.busyRatio() + worker.idleRatio(), 1.0, 1e-9);
+  }
+  ASSERT_GT(busy, 0.0);
+  ASSERT_GT(metrics.tasksPerSecond(), 0.0);
+
+  pool->resetMetrics();
+  metrics = pool->metrics();
+  ASSERT_EQ(metrics.completed, 0);
+  ASSERT_TRUE(metrics.types.empty());
+  pool->setMetricsEnabled(false);
+  pool->submit([]() {}).wait();
+  ASSERT_EQ(pool->metrics().completed, 0);
+  pool->shutdown();
+  pool->join();
+}
+
+// An elastic pool adds workers while tasks are stuck in the queue
+// and lets them go again once things are quiet
+TEST(ThreadPoolTest, ElasticSizing) {
+  using namespace std::chrono_literals;
+  for (auto mode : {SchedulerMode::SharedQueue, SchedulerMode::WorkStealing}) {
+    auto pool = std::make_shared<ThreadPool<WorkerThread>>(mode);
+    pool->startElastic({1, 4, 5ms, 50ms});
+    ASSERT_TRUE(pool->isElastic());
+    ASSERT_EQ(pool->getIdleTimeout(), 50ms);
+    ASSERT_EQ(pool->workerCount(), 1);
+    std::vector<TaskHandle> handles;
+    for (int i = 0; i < 40; ++i) {
+      handles.push_back(pool->submit([]() { std::this_thread::sleep_for(5ms); }));
+    }
+    size_t most = 0;
+    auto all = TaskHandle::whenAll(handles);
+    while (!all.waitFor(1ms)) {
+      most = std::max(most, pool->workerCount());
+    }
+    ASSERT_GT(most, 1);
+    ASSERT_LE(most, 4);
+    // Give everyone time to go idle and retire
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (pool->workerCount() > 1 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(10ms);
+    }
+    auto metrics = pool->metrics();
+    ASSERT_EQ(metrics.threads, 1);
+    ASSERT_EQ(pool->workerStatus().size(), 1);
+    ASSERT_GT(metrics.grown, 0);
+    ASSERT_EQ(metrics.retired, metrics.grown);
+    ASSERT_EQ(metrics.workers.size(), 1);
+    ASSERT_EQ(metrics.completed, 40);
+    // Still works with the workers it has left
+    pool->submit([]() {}).wait();
+    pool->shutdown();
+    pool->join();
+  }
+}
+
+// Stands in for a database query: finishes on another thread after
+// a while, the way PqReactor finishes queries
+class SleepOp : public AsyncOp {
+  std::chrono::milliseconds _duration;
+
+public:
+  SleepOp(std::chrono::milliseconds duration) : _duration(duration) {}
+
+  bool ready() {
+    return _duration.count() == 0;
+  }
+
+  void start(std::function<void()> done) override {
+    std::thread([duration = _duration, done]() {
+      std::this_thread::sleep_for(duration);
+      done();
+    }).detach();
+  }
+
+  int result() {
+    return static_cast<int>(_duration.count());
+  }
+};
+
+AsyncAwaiter<SleepOp> sleepFor(int ms) {
+  return {std::make_shared<SleepOp>(std::chrono::milliseconds(ms))};
+}
+
+class SleepyTask : public CoroutineTask<WorkerThread> {
+  std::atomic<int>& _finished;
+  bool _fail;
+
+protected:
+  TaskCoroutine body() override {
+    int slept = 0;
+    for (int i = 0; i < 3; ++i) {
+      slept += co_await sleepFor(20);
+    }
+    // Ready right away, so this doesn't suspend
+    slept += co_await sleepFor(0);
+    if (_fail) {
+      throw std::runtime_error("query failed");
+    }
+    if (slept == 60) {
+      ++_finished;
+    }
+  }
+
+public:
+  SleepyTask(std::atomic<int>& finished, bool fail = false) : _finished(finished), _fail(fail) {}
+};
+
+// Two workers keep fifty coroutine tasks in flight at once, so the
+// whole lot takes about as long as one of them instead of fifty.
+// Handles stay open while the tasks are suspended.
+TEST(ThreadPoolTest, CoroutineTasksMultiplex) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(2);
+  std::atomic<int> finished = 0;
+  std::vector<TaskHandle> handles;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 50; ++i) {
+    handles.push_back(pool->enqueue(std::make_shared<SleepyTask>(finished)));
+  }
+  TaskHandle::whenAll(handles).wait();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(finished, 50);
+  ASSERT_LT(elapsed, std::chrono::milliseconds(1000));
+
+  ASSERT_THROW(pool->enqueue(std::make_shared<SleepyTask>(finished, true)).wait(), std::runtime_error);
+
+  // Outside a pool it just blocks
+  auto direct = std::make_shared<SleepyTask>(finished);
+  direct->run();
+  ASSERT_TRUE(direct->finished());
+  ASSERT_EQ(finished, 51);
+  pool->shutdown();
+  pool->join();
+}
+
+// Only finishes when it's cancelled, like a query that would
+// otherwise run forever
+class StuckOp : public AsyncOp {
+  std::mutex _mutex;
+  std::function<void()> _done;
+  bool _cancelled = false;
+
+public:
+  bool ready() {
+    return false;
+  }
+
+  void start(std::function<void()> done) override {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_cancelled) {
+      lock.unlock();
+      done();
+      return;
+    }
+    _done = std::move(done);
+  }
+
+  void cancel() override {
+    std::function<void()> done;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _cancelled = true;
+      done = std::exchange(_done, nullptr);
+    }
+    if (done) {
+      done();
+    }
+  }
+
+  void result() {}
+};
+
+AsyncAwaiter<StuckOp> getStuck() {
+  return {std::make_shared<StuckOp>()};
+}
+
+class StuckTask : public CoroutineTask<WorkerThread> {
+protected:
+  TaskCoroutine body() override {
+    co_await getStuck();
+    ++reached;
+  }
+
+public:
+  std::atomic<int> reached = 0;
+};
+
+// Queued tasks with a cancelled token get skipped, children inherit
+// their parent's token, deadlines cancel on their own and a
+// suspended coroutine gets its op cancelled.
+TEST(ThreadPoolTest, Cancellation) {
+  CancellationToken none;
+  ASSERT_FALSE(none.valid());
+  none.cancel();
+  ASSERT_FALSE(none.cancelled());
+  auto token = CancellationToken::create();
+  ASSERT_FALSE(token.cancelled());
+  token.cancel();
+  ASSERT_TRUE(token.cancelled());
+  bool called = false;
+  auto callback = token.onCancel([&called]() { called = true; });
+  ASSERT_TRUE(called);
+
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>();
+  pool->startThreads(1);
+  std::atomic<bool> gate = false;
+  auto blocker = pool->enqueue(std::make_shared<FunctionTask>([&gate](FunctionTask&) {
+    while (!gate) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }));
+  auto queuedToken = CancellationToken::create();
+  std::atomic<int> ran = 0;
+  std::vector<TaskHandle> handles;
+  std::string type;
+  for (int i = 0; i < 10; ++i) {
+    auto task = std::make_shared<FunctionTask>([&ran](FunctionTask&) { ++ran; });
+    task->setCancellation(queuedToken);
+    type = task->taskType();
+    handles.push_back(pool->enqueue(task));
+  }
+  queuedToken.cancel();
+  gate = true;
+  blocker.wait();
+  for (auto& handle : handles) {
+    ASSERT_THROW(handle.wait(), TaskCancelled);
+  }
+  ASSERT_EQ(ran, 0);
+  ASSERT_EQ(pool->metrics().types[type].cancelled, 10);
+
+  // The parent cancels its own token once its children are queued
+  // up behind it on the one worker
+  auto parent = std::make_shared<FunctionTask>([&ran](FunctionTask& self) {
+    for (int i = 0; i < 5; ++i) {
+      auto child = std::make_shared<FunctionTask>([&ran](FunctionTask&) { ++ran; });
+      self.getOwner()->enqueue(child);
+      ASSERT_TRUE(child->getCancellation().valid());
+    }
+    self.getCancellation().cancel();
+  });
+  parent->setCancellation(CancellationToken::create());
+  ASSERT_THROW(pool->enqueue(parent).wait(), TaskCancelled);
+  ASSERT_EQ(ran, 0);
+
+  std::atomic<bool> expired = false;
+  auto deadline = CancellationToken::withTimeout(std::chrono::milliseconds(20));
+  auto onExpiry = deadline.onCancel([&expired]() { expired = true; });
+  ASSERT_FALSE(deadline.cancelled());
+  for (int i = 0; i < 1000 && !expired; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(expired);
+  ASSERT_TRUE(deadline.cancelled());
+
+  auto stuck = std::make_shared<StuckTask>();
+  stuck->setCancellation(CancellationToken::withTimeout(std::chrono::milliseconds(20)));
+  ASSERT_THROW(pool->enqueue(stuck).wait(), TaskCancelled);
+  ASSERT_EQ(stuck->reached, 0);
+  ASSERT_FALSE(stuck->finished());
+  pool->shutdown();
+  pool->join();
+}
+
+// A wide tree plus some cross links, walked by four workers. Every
+// node gets visited exactly once, and pruning, stopping and errors
+// all make it back to the caller.
+TEST(ThreadPoolTest, ParallelTraversal) {
+  auto pool = std::make_shared<ThreadPool<WorkerThread>>(SchedulerMode::WorkStealing);
+  pool->startThreads(4);
+  std::vector<Node::PtrType> nodes;
+  auto root = std::make_shared<Node>();
+  nodes.push_back(root);
+  for (size_t i = 1; i < 20000; ++i) {
+    auto node = std::make_shared<Node>();
+    // Leave some uninitted for the traversal to init
+    if (i % 3) {
+      node->init();
+    }
+    nodes[(i - 1) / 8]->down.push_back(node);
+    node->up.push_back(nodes[(i - 1) / 8]);
+    // And some links back across the tree
+    if (i % 7 == 0) {
+      node->down.push_back(nodes[i / 2]);
+    }
+    nodes.push_back(node);
+  }
+
+  std::mutex mutex;
+  std::unordered_set<const Node*> seen;
+  std::atomic<size_t> duplicates = 0;
+  ParallelTraverseOptions options;
+  options.grain = 16;
+  ParallelTraversal<WorkerThread> traversal(pool, options);
+  auto visited = traversal.run(root, [&](const Node::PtrType& node) {
+    node->changed = true;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!seen.insert(node.get()).second) {
+      ++duplicates;
+    }
+  });
+  ASSERT_EQ(visited, nodes.size());
+  ASSERT_EQ(seen.size(), nodes.size());
+  ASSERT_EQ(duplicates, 0);
+  UuidSet ids;
+  for (auto& node : nodes) {
+    ASSERT_TRUE(node->initted);
+    ASSERT_TRUE(node->changed);
+    ASSERT_TRUE(ids.insert(node->id));
+  }
+
+  // Down only, pruned below the root's first child
+  auto pruned = nodes[1];
+  std::atomic<size_t> count = 0;
+  ParallelTraversal<WorkerThread> down(pool, ParallelTraverseOptions{EdgeFilter::Down, 16});
+  down.run(root, [&](const Node::PtrType& node) {
+    ++count;
+    return node == pruned ? TraverseAction::Prune : TraverseAction::Continue;
+  });
+  ASSERT_LT(count, nodes.size());
+  ASSERT_GT(count, 1);
+
+  count = 0;
+  auto stopped = down.run(root, [&](const Node::PtrType&) {
+    return ++count >= 100 ? TraverseAction::Stop : TraverseAction::Continue;
+  });
+  ASSERT_LT(stopped, nodes.size());
+
+  ASSERT_THROW(down.run(root, [](const Node::PtrType& node) {
+    if (node->down.empty()) {
+      throw std::runtime_error("leaf");
+    }
+  }), std::runtime_error);
+
+  // A serial walk stopped partway and finished in parallel still
+  // visits everything exactly once
+  for (auto order : {TraverseOrder::DepthFirst, TraverseOrder::BreadthFirst}) {
+    seen.clear();
+    duplicates = 0;
+    auto visit = [&](const Node::PtrType& node) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!seen.insert(node.get()).second) {
+        ++duplicates;
+      }
+    };
+    Traversal<Node> serial(TraverseOptions{order});
+    std::vector<const Node*> walked;
+    serial.run(root, [&](const Node::PtrType& node) {
+      visit(node);
+      walked.push_back(node.get());
+      return walked.size() >= 500 ? TraverseAction::Stop : TraverseAction::Continue;
+    });
+    ASSERT_TRUE(serial.stopped());
+    auto rest = traversal.resume(serial.pending(), walked, visit);
+    ASSERT_EQ(walked.size() + rest, nodes.size());
+    ASSERT_EQ(seen.size(), nodes.size());
+    ASSERT_EQ(duplicates, 0);
+  }
+
+  for (auto& node : nodes) {
+    node->up.clear();
+    node->down.clear();
+  }
+  pool->shutdown();
+  pool->join();
+}